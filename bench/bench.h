@@ -0,0 +1,116 @@
+#ifndef CGL_BENCH_H_
+#define CGL_BENCH_H_
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "math/cgl_math.h"
+#include "util/obj_loader.h"
+
+namespace cgl
+{
+  namespace bench
+  {
+    /// Keeps the compiler from discarding a value that is otherwise unused.
+    template <typename T> inline void keep(const T& value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      asm volatile("" : : "r"(&value) : "memory");
+#else
+      static volatile const void* sink;
+      sink = &value;
+#endif
+    }
+
+    /// Returns a pseudo-random float in [lo, hi], from std::rand() so that
+    /// runs are repeatable.
+    inline float random(float lo, float hi)
+    {
+      return lo + (hi - lo) * (std::rand() / static_cast<float>(RAND_MAX));
+    }
+
+    /// Appends a bumpy sphere made of an n x n grid of quads (2n^2 triangles):
+    /// the generated mesh of the BVH and ray casting benchmarks.
+    inline void sphereGrid(int n, std::vector<Vec3>* positions, std::vector<int>* indices)
+    {
+      for (int i = 0; i <= n; ++i) {
+        for (int j = 0; j <= n; ++j) {
+          float u = i * 2 * PI / n;
+          float v = j * PI / n;
+          float r = 1 + 0.1f * std::sin(7 * u) * std::sin(5 * v);
+          positions->push_back(Vec3(std::cos(u) * std::sin(v), std::sin(u) * std::sin(v), std::cos(v)) * r);
+        }
+      }
+      for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+          int a = i * (n + 1) + j;
+          int b = a + 1;
+          int c = a + n + 1;
+          int d = c + 1;
+          int quad[6] = { a, b, c, b, d, c };
+          indices->insert(indices->end(), quad, quad + 6);
+        }
+      }
+    }
+
+    /// Appends a textured sphere of rings x segments quads with the given
+    /// radius, the texture seam at the first meridian and one vertex per
+    /// triangle at the poles.
+    inline void makeSphere(int rings, int segments, float radius, ObjModel* model)
+    {
+      for (int i = 0; i <= rings; ++i) {
+        for (int j = 0; j <= segments; ++j) {
+          float theta = PI * i / rings, phi = PI2 * (j % segments) / segments;
+          Vec3 n(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+          if (i == 0 || i == rings)
+            n = Vec3(0, i == 0 ? 1.0f : -1.0f, 0);
+          ObjVertex v;
+          v.position = n * radius;
+          v.texCoord = Vec2(j / float(segments), i / float(rings));
+          v.normal = n;
+          model->vertices.push_back(v);
+        }
+      }
+      int row = segments + 1;
+      for (int i = 0; i < rings; ++i) {
+        for (int j = 0; j < segments; ++j) {
+          int a = i * row + j, b = a + row;
+          int quad[6] = { a, b + 1, b, a, a + 1, b + 1 };
+          model->indices.insert(model->indices.end(), quad, quad + 6);
+        }
+      }
+      model->min = Vec3(-radius);
+      model->max = Vec3(radius);
+      model->textured = true;
+    }
+
+    /// Runs fn(i) for i in [0, n) and returns the average nanoseconds per
+    /// call, taking the best of several repetitions to filter out noise.
+    template <typename F> double measure(F fn, size_t n, int repetitions = 5)
+    {
+      typedef std::chrono::steady_clock Clock;
+      double best = 0;
+      for (int r = 0; r < repetitions; ++r) {
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < n; ++i)
+          fn(i);
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        if (r == 0 || ns < best)
+          best = ns;
+      }
+      return best / n;
+    }
+
+    /// Prints one result row: name, nanoseconds per operation, and the speedup
+    /// relative to a baseline time.
+    inline void report(const char* name, double ns, double baselineNs)
+    {
+      std::printf("%-28s %10.2f ns/op %8.2fx\n", name, ns, baselineNs / ns);
+    }
+  }
+}
+
+#endif // CGL_BENCH_H_
@@ -0,0 +1,52 @@
+// Measures Bvh build and refit times on a generated mesh (a bumpy sphere made
+// of a grid of quads). Usage: cgl_bvh_bench [triangles, default 10000000]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "math/cgl_math.h"
+#include "util/bvh.h"
+#include "bench.h"
+
+using namespace cgl;
+
+namespace
+{
+  typedef std::chrono::steady_clock Clock;
+
+  double seconds(Clock::time_point start)
+  {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+}
+
+int main(int argc, char** argv)
+{
+  size_t triangles = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 10000000;
+  int n = static_cast<int>(std::sqrt(triangles / 2.0));
+  std::vector<Vec3> positions;
+  std::vector<int> indices;
+  bench::sphereGrid(n, &positions, &indices);
+  size_t count = indices.size() / 3;
+  std::printf("%u triangles, %u hardware threads\n\n", unsigned(count), hardwareThreads());
+
+  Bvh bvh;
+  unsigned threadCounts[2] = { 1, 0 };
+  for (int k = 0; k < 2; ++k) {
+    Clock::time_point start = Clock::now();
+    bvh.build(&positions[0], sizeof(Vec3), &indices[0], count, threadCounts[k]);
+    std::printf("build (threads = %u)       %8.3f s   %u nodes\n",
+                threadCounts[k], seconds(start), unsigned(bvh.nodes().size()));
+  }
+
+  for (size_t i = 0; i < positions.size(); ++i)
+    positions[i] = positions[i] * 1.5f + Vec3(0.f, positions[i].x * positions[i].x, 0.f);
+  Clock::time_point start = Clock::now();
+  bvh.refit(&positions[0], sizeof(Vec3), &indices[0]);
+  std::printf("refit                       %8.3f s\n", seconds(start));
+  bench::keep(bvh.nodes()[0]);
+
+  return 0;
+}
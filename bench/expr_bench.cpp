@@ -0,0 +1,85 @@
+// Compares the expression templates in vector_expr.h with the regular vector
+// operators on loops over Vec3 arrays.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "math/cgl_math.h"
+#include "math/vector_expr.h"
+#include "bench.h"
+
+using namespace cgl;
+
+namespace
+{
+  float maxError(const std::vector<Vec3>& a, const std::vector<Vec3>& b)
+  {
+    float e = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+      e = std::max(e, (a[i] - b[i]).length());
+    return e;
+  }
+}
+
+int main()
+{
+  using namespace cgl::expr;
+
+  // small enough to stay in cache, so the arithmetic dominates
+  const size_t n = 4096;
+  const size_t repeat = 256;
+  std::srand(1);
+  std::vector<Vec3> a(n), b(n), c(n), ref(n), out(n);
+  for (size_t i = 0; i < n; ++i) {
+    a[i] = Vec3(bench::random(-1, 1), bench::random(-1, 1), bench::random(-1, 1));
+    b[i] = Vec3(bench::random(-1, 1), bench::random(-1, 1), bench::random(-1, 1));
+    c[i] = Vec3(bench::random(0.5f, 1), bench::random(0.5f, 1), bench::random(0.5f, 1));
+  }
+  const Vec3* pa = &a[0];
+  const Vec3* pb = &b[0];
+  const Vec3* pc = &c[0];
+  const float w = 0.25f;
+
+  std::printf("%-28s %10s %10s\n", "", "time", "speedup");
+
+  double base = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      ref[i] = a[i] + (b[i] - a[i]) * w;
+    bench::keep(ref[0]);
+  }, repeat) / n;
+  double fused = bench::measure([&](size_t) {
+    assign(&out[0], n, lazy(pa) + (lazy(pb) - lazy(pa)) * w);
+    bench::keep(out[0]);
+  }, repeat) / n;
+  std::printf("\nlerp a + (b - a) * w (max error %g)\n", maxError(ref, out));
+  bench::report("operators", base, base);
+  bench::report("expression templates", fused, base);
+
+  base = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      ref[i] = (a[i] * 2.f + b[i]) * c[i] - (a[i] - b[i]) / c[i];
+    bench::keep(ref[0]);
+  }, repeat) / n;
+  fused = bench::measure([&](size_t) {
+    assign(&out[0], n, (lazy(pa) * 2.f + lazy(pb)) * lazy(pc) - (lazy(pa) - lazy(pb)) / lazy(pc));
+    bench::keep(out[0]);
+  }, repeat) / n;
+  std::printf("\n(a * 2 + b) * c - (a - b) / c (max error %g)\n", maxError(ref, out));
+  bench::report("operators", base, base);
+  bench::report("expression templates", fused, base);
+
+  base = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      ref[i] = (b[i] - a[i]).cross(c[i] - a[i]);
+    bench::keep(ref[0]);
+  }, repeat) / n;
+  fused = bench::measure([&](size_t) {
+    assign(&out[0], n, cross(lazy(pb) - lazy(pa), lazy(pc) - lazy(pa)));
+    bench::keep(out[0]);
+  }, repeat) / n;
+  std::printf("\n(b - a).cross(c - a) (max error %g)\n", maxError(ref, out));
+  bench::report("operators", base, base);
+  bench::report("expression templates", fused, base);
+
+  return 0;
+}
@@ -0,0 +1,133 @@
+// Compares the approximate functions in fast_math.h (and the *Fast vector
+// members) with the exact versions, for speed and for the largest error over
+// the benchmark inputs.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "math/cgl_math.h"
+#include "math/vector_array.h"
+#include "bench.h"
+
+using namespace cgl;
+
+namespace
+{
+  // Largest deviation of the vector lengths from 1, computed in double.
+  double unitError(const std::vector<Vec3>& v)
+  {
+    double error = 0;
+    for (size_t i = 0; i < v.size(); ++i) {
+      double x = v[i].x, y = v[i].y, z = v[i].z;
+      error = std::max(error, std::fabs(std::sqrt(x * x + y * y + z * z) - 1));
+    }
+    return error;
+  }
+
+  // Largest absolute error of sines and cosines, computed in double.
+  double sinCosError(const std::vector<float>& radians, const std::vector<float>& sines,
+                     const std::vector<float>& cosines)
+  {
+    double error = 0;
+    for (size_t i = 0; i < radians.size(); ++i) {
+      error = std::max(error, std::fabs(sines[i] - std::sin(double(radians[i]))));
+      error = std::max(error, std::fabs(cosines[i] - std::cos(double(radians[i]))));
+    }
+    return error;
+  }
+
+  void row(const char* name, double ns, double baselineNs, double error)
+  {
+    std::printf("%-28s %10.2f ns/op %8.2fx %12.2e\n", name, ns, baselineNs / ns, error);
+  }
+}
+
+int main()
+{
+  // small enough to stay in cache, so the arithmetic dominates
+  const size_t n = 4096;
+  const size_t repeat = 256;
+  std::srand(1);
+  std::vector<Vec3> v(n), out(n);
+  std::vector<float> squares(n), roots(n), radians(n), sines(n), cosines(n);
+  for (size_t i = 0; i < n; ++i) {
+    v[i] = Vec3(bench::random(-10, 10), bench::random(-10, 10), bench::random(-10, 10));
+    squares[i] = v[i].lengthSquared();
+    radians[i] = bench::random(-2 * PI, 2 * PI);
+  }
+  Vec3Array array(&v[0], n), arrayOut(n);
+
+  std::printf("%-28s %10s %10s %12s\n", "", "time", "speedup", "max error");
+
+  std::printf("\n1 / sqrt (relative error)\n");
+  double base = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      roots[i] = 1.0f / std::sqrt(squares[i]);
+    bench::keep(roots[0]);
+  }, repeat) / n;
+  double error = 0;
+  for (size_t i = 0; i < n; ++i)
+    error = std::max(error, std::fabs(roots[i] * std::sqrt(double(squares[i])) - 1));
+  row("1 / std::sqrt", base, base, error);
+  double ns = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      roots[i] = rsqrtFast(squares[i]);
+    bench::keep(roots[0]);
+  }, repeat) / n;
+  error = 0;
+  for (size_t i = 0; i < n; ++i)
+    error = std::max(error, std::fabs(roots[i] * std::sqrt(double(squares[i])) - 1));
+  row("rsqrtFast", ns, base, error);
+
+  std::printf("\nnormalize (|length - 1|)\n");
+  base = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      out[i] = v[i].normal();
+    bench::keep(out[0]);
+  }, repeat) / n;
+  row("Vec3::normal", base, base, unitError(out));
+  ns = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      out[i] = v[i].normalFast();
+    bench::keep(out[0]);
+  }, repeat) / n;
+  row("Vec3::normalFast", ns, base, unitError(out));
+  ns = bench::measure([&](size_t) {
+    arrayOut = array;
+    normalize(&arrayOut);
+    bench::keep(arrayOut);
+  }, repeat) / n;
+  arrayOut.scatter(&out[0]);
+  row("normalize (Vec3Array)", ns, base, unitError(out));
+  ns = bench::measure([&](size_t) {
+    arrayOut = array;
+    normalizeFast(&arrayOut);
+    bench::keep(arrayOut);
+  }, repeat) / n;
+  arrayOut.scatter(&out[0]);
+  row("normalizeFast (Vec3Array)", ns, base, unitError(out));
+
+  std::printf("\nsin and cos in [-2pi, 2pi] (absolute error)\n");
+  base = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i) {
+      sines[i] = std::sin(radians[i]);
+      cosines[i] = std::cos(radians[i]);
+    }
+    bench::keep(sines[0]);
+  }, repeat) / n;
+  row("std::sin + std::cos", base, base, sinCosError(radians, sines, cosines));
+  ns = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      fastSinCos(radians[i], &sines[i], &cosines[i]);
+    bench::keep(sines[0]);
+  }, repeat) / n;
+  row("fastSinCos", ns, base, sinCosError(radians, sines, cosines));
+  ns = bench::measure([&](size_t) {
+    fastSinCos(&radians[0], &sines[0], &cosines[0], n);
+    bench::keep(sines[0]);
+  }, repeat) / n;
+  row("fastSinCos (array)", ns, base, sinCosError(radians, sines, cosines));
+
+  return 0;
+}
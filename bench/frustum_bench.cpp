@@ -0,0 +1,89 @@
+// Compares the batched frustum culling functions with calling
+// Frustum::intersectsBox/intersectsSphere once per object.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "math/cgl_math.h"
+#include "math/frustum.h"
+#include "bench.h"
+
+using namespace cgl;
+
+int main()
+{
+  const size_t n = 10000;
+  const size_t repeat = 200;
+  std::srand(1);
+  std::vector<Vec3> mins(n), maxs(n), centers(n);
+  std::vector<Vec4> spheres(n);
+  std::vector<float> radii(n);
+  for (size_t i = 0; i < n; ++i) {
+    Vec3 c(bench::random(-100, 100), bench::random(-100, 100), bench::random(-100, 100));
+    Vec3 e(bench::random(0, 2), bench::random(0, 2), bench::random(0, 2));
+    mins[i] = c - e;
+    maxs[i] = c + e;
+    centers[i] = c;
+    radii[i] = e.length();
+    spheres[i] = Vec4(c.x, c.y, c.z, radii[i]);
+  }
+  Vec3Array minArray(&mins[0], n), maxArray(&maxs[0], n), centerArray(&centers[0], n);
+  std::vector<uint32_t> mask((n + 31) / 32), indices(n);
+  Frustum frustum(perspective(1.f, 1.5f, 0.1f, 150.f) *
+    lookAt(Vec3(0.f, 0.f, 0.f), Vec3(1.f, 0.2f, -1.f), Vec3(0.f, 1.f, 0.f)));
+
+  std::printf("%-28s %10s %10s\n", "", "time", "speedup");
+
+  size_t visible = 0;
+  double base = bench::measure([&](size_t) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i)
+      if (frustum.intersectsBox(mins[i], maxs[i]))
+        indices[count++] = static_cast<uint32_t>(i);
+    visible = count;
+    bench::keep(indices[0]);
+  }, repeat) / n;
+  std::printf("\nboxes (%u of %u visible)\n", unsigned(visible), unsigned(n));
+  bench::report("intersectsBox loop", base, base);
+  bench::report("boxMask (Vec3*)", bench::measure([&](size_t) {
+    frustum.boxMask(&mins[0], &maxs[0], n, &mask[0]);
+    bench::keep(mask[0]);
+  }, repeat) / n, base);
+  bench::report("visibleBoxes (Vec3*)", bench::measure([&](size_t) {
+    bench::keep(frustum.visibleBoxes(&mins[0], &maxs[0], n, &indices[0]));
+  }, repeat) / n, base);
+  bench::report("boxMask (Vec3Array)", bench::measure([&](size_t) {
+    frustum.boxMask(minArray, maxArray, &mask[0]);
+    bench::keep(mask[0]);
+  }, repeat) / n, base);
+  bench::report("visibleBoxes (Vec3Array)", bench::measure([&](size_t) {
+    bench::keep(frustum.visibleBoxes(minArray, maxArray, &indices[0]));
+  }, repeat) / n, base);
+
+  base = bench::measure([&](size_t) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i)
+      if (frustum.intersectsSphere(centers[i], radii[i]))
+        indices[count++] = static_cast<uint32_t>(i);
+    visible = count;
+    bench::keep(indices[0]);
+  }, repeat) / n;
+  std::printf("\nspheres (%u of %u visible)\n", unsigned(visible), unsigned(n));
+  bench::report("intersectsSphere loop", base, base);
+  bench::report("sphereMask (Vec4*)", bench::measure([&](size_t) {
+    frustum.sphereMask(&spheres[0], n, &mask[0]);
+    bench::keep(mask[0]);
+  }, repeat) / n, base);
+  bench::report("visibleSpheres (Vec4*)", bench::measure([&](size_t) {
+    bench::keep(frustum.visibleSpheres(&spheres[0], n, &indices[0]));
+  }, repeat) / n, base);
+  bench::report("sphereMask (Vec3Array)", bench::measure([&](size_t) {
+    frustum.sphereMask(centerArray, &radii[0], &mask[0]);
+    bench::keep(mask[0]);
+  }, repeat) / n, base);
+  bench::report("visibleSpheres (Vec3Array)", bench::measure([&](size_t) {
+    bench::keep(frustum.visibleSpheres(centerArray, &radii[0], &indices[0]));
+  }, repeat) / n, base);
+
+  return 0;
+}
@@ -0,0 +1,97 @@
+// Compares the specialized Matrix4 inverse paths against the general
+// (MESA-derived) inverse() on rigid, affine and projective matrices. Mat4
+// uses the SIMD kernels when they are enabled; Mat4d always runs the scalar
+// templates.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "math/cgl_math.h"
+#include "bench.h"
+
+using namespace cgl;
+
+namespace
+{
+  Vec3 randomVec3(float lo, float hi)
+  {
+    return Vec3(bench::random(lo, hi), bench::random(lo, hi), bench::random(lo, hi));
+  }
+
+  Mat4 randomRigid()
+  {
+    return translation(randomVec3(-100, 100)) * rotation(bench::random(-PI, PI), randomVec3(-1, 1));
+  }
+
+  Mat4 randomAffine()
+  {
+    return randomRigid() * scale(randomVec3(0.5f, 4));
+  }
+
+  Mat4 randomProjective()
+  {
+    return perspective(bench::random(0.5f, 1.5f), bench::random(1, 2), 0.1f, 100.f) * randomAffine();
+  }
+
+  template <typename T> Matrix4<T> convert(const Mat4& M)
+  {
+    T a[16];
+    for (int i = 0; i < 16; ++i)
+      a[i] = M[i];
+    return Matrix4<T>(a);
+  }
+
+  template <typename T> T maxError(const Matrix4<T>& a, const Matrix4<T>& b)
+  {
+    T e = 0;
+    for (int i = 0; i < 16; ++i)
+      e = std::max(e, std::abs(a[i] - b[i]));
+    return e;
+  }
+
+  template <typename T> void run(const char* label, Mat4 (*make)(), bool rigid, bool affine)
+  {
+    const size_t n = 4096;
+    std::vector<Matrix4<T> > input(n);
+    for (size_t i = 0; i < n; ++i)
+      input[i] = convert<T>(make());
+
+    T errAffine = 0, errRigid = 0, errFast = 0;
+    for (size_t i = 0; i < n; ++i) {
+      Matrix4<T> ref = input[i].inverse();
+      if (affine)
+        errAffine = std::max(errAffine, maxError(ref, input[i].inverseAffine()));
+      if (rigid)
+        errRigid = std::max(errRigid, maxError(ref, input[i].inverseRigid()));
+      errFast = std::max(errFast, maxError(ref, input[i].inverseFast()));
+    }
+
+    std::printf("\n%s (max abs error vs inverse(): affine %g, rigid %g, fast %g)\n",
+      label, double(errAffine), double(errRigid), double(errFast));
+
+    const size_t iterations = 1 << 20;
+    double base = bench::measure([&](size_t i) {
+      bench::keep(input[i % n].inverse()); }, iterations);
+    bench::report("inverse()", base, base);
+    if (affine)
+      bench::report("inverseAffine()", bench::measure([&](size_t i) {
+        bench::keep(input[i % n].inverseAffine()); }, iterations), base);
+    if (rigid)
+      bench::report("inverseRigid()", bench::measure([&](size_t i) {
+        bench::keep(input[i % n].inverseRigid()); }, iterations), base);
+    bench::report("inverseFast()", bench::measure([&](size_t i) {
+      bench::keep(input[i % n].inverseFast()); }, iterations), base);
+  }
+}
+
+int main()
+{
+  std::srand(1);
+  run<float>("Mat4, rigid", randomRigid, true, true);
+  run<float>("Mat4, affine", randomAffine, false, true);
+  run<float>("Mat4, projective", randomProjective, false, false);
+  run<double>("Mat4d, rigid", randomRigid, true, true);
+  run<double>("Mat4d, affine", randomAffine, false, true);
+  run<double>("Mat4d, projective", randomProjective, false, false);
+  return 0;
+}
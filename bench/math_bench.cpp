@@ -0,0 +1,325 @@
+// Throughput and latency of the math templates, in float and double, so that
+// runs before and after a change to math/*.h can be compared.
+//
+//   cgl_math_bench [--csv | --json] [filter]
+//
+// Throughput is the average time per operation over arrays of independent
+// inputs; latency is the time per step of a chain where each result is the
+// input of the next operation. Only benchmarks whose "group/name" contains
+// filter are run. The default output is a table; --csv and --json print one
+// record per benchmark with the fields group, name, type, mode and ns.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "math/cgl_math.h"
+#include "math/aligned.h"
+#include "math/batch_transform.h"
+#include "bench.h"
+
+using namespace cgl;
+
+namespace
+{
+  const size_t count = 1024;
+  const size_t repeat = 256;
+
+  struct Result
+  {
+    std::string group;
+    std::string name;
+    const char* type;
+    const char* mode;
+    double ns;
+  };
+
+  std::vector<Result> results;
+  const char* filter = "";
+
+  template <typename T> const char* typeName();
+  template <> const char* typeName<float>() { return "float"; }
+  template <> const char* typeName<double>() { return "double"; }
+
+  bool selected(const char* group, const char* name)
+  {
+    return (std::string(group) + "/" + name).find(filter) != std::string::npos;
+  }
+
+  void record(const char* group, const char* name, const char* type, const char* mode, double ns)
+  {
+    Result r = { group, name, type, mode, ns };
+    results.push_back(r);
+  }
+
+  template <typename T> void random(Vector2<T>* v) { *v = Vector2<T>(bench::random(-1, 1), bench::random(-1, 1)); }
+  template <typename T> void random(Vector3<T>* v) { *v = Vector3<T>(bench::random(-1, 1), bench::random(-1, 1), bench::random(-1, 1)); }
+  template <typename T> void random(Vector4<T>* v)
+  {
+    *v = Vector4<T>(bench::random(-1, 1), bench::random(-1, 1), bench::random(-1, 1), bench::random(-1, 1));
+  }
+
+  // Random matrices with a dominant diagonal, so that they are invertible.
+  template <typename T, typename M, int N> void randomMatrix(M* m)
+  {
+    T values[N * N];
+    for (int i = 0; i < N * N; ++i)
+      values[i] = bench::random(-1, 1) + (i % (N + 1) == 0 ? N : 0);
+    *m = M(values);
+  }
+
+  template <typename T> void random(Matrix2<T>* m) { randomMatrix<T, Matrix2<T>, 2>(m); }
+  template <typename T> void random(Matrix3<T>* m) { randomMatrix<T, Matrix3<T>, 3>(m); }
+  template <typename T> void random(Matrix4<T>* m) { randomMatrix<T, Matrix4<T>, 4>(m); }
+
+  template <typename V> std::vector<V> randomArray()
+  {
+    std::vector<V> v(count);
+    for (size_t i = 0; i < count; ++i)
+      random(&v[i]);
+    return v;
+  }
+
+  // Measures out[i] = op(a[i], b[i]) over the arrays.
+  template <typename R, typename A, typename B, typename F>
+  void throughput(const char* group, const char* name, const char* type,
+                  const std::vector<A>& a, const std::vector<B>& b, F op)
+  {
+    if (!selected(group, name))
+      return;
+    std::vector<R> out(count);
+    double ns = bench::measure([&](size_t) {
+      for (size_t i = 0; i < count; ++i)
+        out[i] = op(a[i], b[i]);
+      bench::keep(out[0]);
+    }, repeat) / count;
+    record(group, name, type, "throughput", ns);
+  }
+
+  // Measures x = op(x, b) starting from x = a.
+  template <typename A, typename B, typename F>
+  void latency(const char* group, const char* name, const char* type, const A& a, const B& b, F op)
+  {
+    if (!selected(group, name))
+      return;
+    A x = a;
+    double ns = bench::measure([&](size_t) {
+      x = op(x, b);
+    }, count * repeat);
+    bench::keep(x);
+    record(group, name, type, "latency", ns);
+  }
+
+  // Both measurements, for operations whose result has the type of a.
+  template <typename A, typename B, typename F>
+  void both(const char* group, const char* name, const char* type,
+            const std::vector<A>& a, const std::vector<B>& b, F op)
+  {
+    throughput<A>(group, name, type, a, b, op);
+    latency(group, name, type, a[0], b[0], op);
+  }
+
+  template <typename T, typename V> void vectorBenches(const char* group)
+  {
+    const char* type = typeName<T>();
+    std::vector<V> a = randomArray<V>(), b = randomArray<V>();
+    both(group, "add", type, a, b, [](const V& x, const V& y) { return x + y; });
+    // chains of products with |y| < 1 would end up in denormals
+    throughput<V>(group, "multiply", type, a, b, [](const V& x, const V& y) { return x * y; });
+    latency(group, "multiply", type, a[0], V(T(-1)), [](const V& x, const V& y) { return x * y; });
+    both(group, "normal", type, a, b, [](const V& x, const V& y) { return (x + y).normal(); });
+    throughput<T>(group, "dot", type, a, b, [](const V& x, const V& y) { return x.dot(y); });
+    throughput<T>(group, "length", type, a, b, [](const V& x, const V&) { return x.length(); });
+  }
+
+  // Cyclic permutation matrices: orthonormal and exact, so chains of
+  // products neither overflow nor produce denormals.
+  template <typename T> Matrix2<T> permutation(Matrix2<T>*) { return Matrix2<T>(0, 1, 1, 0); }
+  template <typename T> Matrix3<T> permutation(Matrix3<T>*) { return Matrix3<T>(0, 1, 0, 0, 0, 1, 1, 0, 0); }
+  template <typename T> Matrix4<T> permutation(Matrix4<T>*)
+  {
+    return Matrix4<T>(0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 1, 0, 0, 0);
+  }
+
+  template <typename T, typename M, typename V> void matrixBenches(const char* group)
+  {
+    const char* type = typeName<T>();
+    std::vector<M> a = randomArray<M>(), b = randomArray<M>();
+    std::vector<V> v = randomArray<V>();
+    std::vector<M> p(count, permutation(static_cast<M*>(0)));
+    throughput<M>(group, "multiply", type, a, b, [](const M& x, const M& y) { return x * y; });
+    latency(group, "multiply", type, a[0], p[0], [](const M& x, const M& y) { return x * y; });
+    both(group, "multiply vector", type, v, a, [](const V& x, const M& y) { return y * x; });
+    both(group, "inverse", type, a, b, [](const M& x, const M&) { return x.inverse(); });
+    both(group, "transpose", type, a, b, [](const M& x, const M&) { return x.transpose(); });
+  }
+
+  // The builders and batch transforms only exist for float.
+  void builderBenches()
+  {
+    const char* group = "Builders";
+    std::vector<Vec3> a = randomArray<Vec3>(), b = randomArray<Vec3>();
+    throughput<Mat4>(group, "rotationX", "float", a, b,
+                     [](const Vec3& x, const Vec3&) { return rotationX(x.x); });
+    throughput<Mat4>(group, "rotation axis", "float", a, b,
+                     [](const Vec3& x, const Vec3& y) { return rotation(x.x, y); });
+    throughput<Mat4>(group, "translation", "float", a, b,
+                     [](const Vec3& x, const Vec3&) { return translation(x); });
+    throughput<Mat4>(group, "perspective", "float", a, b,
+                     [](const Vec3& x, const Vec3&) { return perspective(1 + x.x * 0.5f, 1.5f, 0.1f, 100.0f); });
+    throughput<Mat4>(group, "ortho", "float", a, b, [](const Vec3& x, const Vec3& y) {
+      return ortho(x.x - 2, x.y + 2, y.x - 2, y.y + 2, 0.1f, 100.0f);
+    });
+    throughput<Mat4>(group, "lookAt", "float", a, b,
+                     [](const Vec3& x, const Vec3& y) { return lookAt(x, y, Vec3(0, 1, 0)); });
+  }
+
+  void batchBenches()
+  {
+    const char* group = "Batch";
+    const size_t n = 4096;
+    std::vector<Vec3> points(n), out(n);
+    std::vector<Vec4> vectors(n), out4(n);
+    Vec4AVector aligned(n), outA(n);
+    for (size_t i = 0; i < n; ++i) {
+      random(&points[i]);
+      random(&vectors[i]);
+      aligned[i] = vectors[i];
+    }
+
+    // Vec4 arrays 4 bytes off 16-byte alignment, so every fourth vector
+    // crosses a cache line
+    std::vector<float> storage(8 * (n + 1) + 16);
+    float* base = &storage[0];
+    while (reinterpret_cast<size_t>(base) % 64 != 4)
+      ++base;
+    Vec4* shifted = reinterpret_cast<Vec4*>(base);
+    Vec4* shiftedOut = shifted + n + 1;
+    std::copy(vectors.begin(), vectors.end(), shifted);
+    Mat4 M = perspective(1.0f, 1.5f, 0.1f, 100.0f) * translation(0, 0, -5) * rotation(0.3f, Vec3(1, 1, 0));
+
+    struct Case { const char* name; int op; };
+    const Case cases[] = {
+      { "transformPoints", 0 }, { "projectPoints", 1 }, { "transformDirections", 2 },
+      { "transformNormals", 3 }, { "transform Vec4", 4 }, { "transform Vec4 unaligned", 5 },
+      { "transform Vec4A", 6 },
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c) {
+      if (!selected(group, cases[c].name))
+        continue;
+      int op = cases[c].op;
+      double ns = bench::measure([&](size_t) {
+        switch (op) {
+        case 0: transformPoints(M, &points[0], &out[0], n); break;
+        case 1: projectPoints(M, &points[0], &out[0], n); break;
+        case 2: transformDirections(M, &points[0], &out[0], n); break;
+        case 3: transformNormals(M, &points[0], &out[0], n); break;
+        case 4: transform(M, &vectors[0], &out4[0], n); break;
+        case 5: transform(M, shifted, shiftedOut, n); break;
+        case 6: transform(M, &aligned[0], &outA[0], n); break;
+        }
+        bench::keep(out[0]);
+        bench::keep(out4[0]);
+        bench::keep(shiftedOut[0]);
+        bench::keep(outA[0]);
+      }, repeat / 4) / n;
+      record(group, cases[c].name, "float", "throughput", ns);
+    }
+
+    // normal matrices, against copying out the upper 3x3 and inverting it
+    std::vector<Mat4> models(count);
+    std::vector<Mat3> normals(count);
+    std::vector<Std140Mat3> padded(count);
+    for (size_t i = 0; i < count; ++i) {
+      Vec3 axis, offset;
+      random(&axis);
+      random(&offset);
+      models[i] = translation(offset) * rotation(bench::random(-PI, PI), axis) * scale(1.5f, 0.5f, 2.0f);
+    }
+    throughput<Mat3>(group, "Mat3 inverse transpose", "float", models, models, [](const Mat4& x, const Mat4&) {
+      const float* m = x;
+      return Mat3(m[0], m[1], m[2], m[4], m[5], m[6], m[8], m[9], m[10]).inverse().transpose();
+    });
+    if (selected(group, "normalMatrices")) {
+      record(group, "normalMatrices", "float", "throughput", bench::measure([&](size_t) {
+        normalMatrices(&models[0], &normals[0], count);
+        bench::keep(normals[0]);
+      }, repeat) / count);
+      record(group, "normalMatrices std140", "float", "throughput", bench::measure([&](size_t) {
+        normalMatrices(&models[0], &padded[0], count);
+        bench::keep(padded[0]);
+      }, repeat) / count);
+    }
+  }
+
+  void printTable()
+  {
+    std::printf("%-10s %-24s %-7s %-11s %10s\n", "group", "name", "type", "mode", "ns/op");
+    for (size_t i = 0; i < results.size(); ++i) {
+      const Result& r = results[i];
+      std::printf("%-10s %-24s %-7s %-11s %10.3f\n", r.group.c_str(), r.name.c_str(), r.type, r.mode, r.ns);
+    }
+  }
+
+  void printCsv()
+  {
+    std::printf("group,name,type,mode,ns\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+      const Result& r = results[i];
+      std::printf("%s,%s,%s,%s,%.4f\n", r.group.c_str(), r.name.c_str(), r.type, r.mode, r.ns);
+    }
+  }
+
+  void printJson()
+  {
+    std::printf("[\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+      const Result& r = results[i];
+      std::printf("  {\"group\": \"%s\", \"name\": \"%s\", \"type\": \"%s\", \"mode\": \"%s\", \"ns\": %.4f}%s\n",
+                  r.group.c_str(), r.name.c_str(), r.type, r.mode, r.ns, i + 1 < results.size() ? "," : "");
+    }
+    std::printf("]\n");
+  }
+}
+
+int main(int argc, char** argv)
+{
+  enum { TABLE, CSV, JSON } format = TABLE;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--csv") == 0)
+      format = CSV;
+    else if (std::strcmp(argv[i], "--json") == 0)
+      format = JSON;
+    else if (argv[i][0] == '-') {
+      std::fprintf(stderr, "usage: %s [--csv | --json] [filter]\n", argv[0]);
+      return 1;
+    } else
+      filter = argv[i];
+  }
+
+  std::srand(1);
+  vectorBenches<float, Vec2>("Vector2");
+  vectorBenches<double, Vec2d>("Vector2");
+  vectorBenches<float, Vec3>("Vector3");
+  vectorBenches<double, Vec3d>("Vector3");
+  vectorBenches<float, Vec4>("Vector4");
+  vectorBenches<double, Vec4d>("Vector4");
+  matrixBenches<float, Mat2, Vec2>("Matrix2");
+  matrixBenches<double, Mat2d, Vec2d>("Matrix2");
+  matrixBenches<float, Mat3, Vec3>("Matrix3");
+  matrixBenches<double, Mat3d, Vec3d>("Matrix3");
+  matrixBenches<float, Mat4, Vec4>("Matrix4");
+  matrixBenches<double, Mat4d, Vec4d>("Matrix4");
+  builderBenches();
+  batchBenches();
+
+  if (format == CSV)
+    printCsv();
+  else if (format == JSON)
+    printJson();
+  else
+    printTable();
+  return 0;
+}
@@ -0,0 +1,114 @@
+// Builds a grid of triangles in row order (as most exporters write it) and
+// in random order, and reports the vertex cache statistics of each before
+// and after optimizeMesh(), along with the time the optimization takes and
+// the time to read the vertices in index order, which shows the fetch
+// locality on the CPU.
+//
+//   cgl_mesh_optimizer_bench [grid size]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "math/cgl_math.h"
+#include "util/mesh_optimizer.h"
+#include "bench.h"
+
+using namespace cgl;
+
+namespace
+{
+  // A size x size grid of quads, two triangles each, row by row.
+  void makeGrid(int size, ObjModel* model)
+  {
+    int row = size + 1;
+    model->vertices.resize(row * row);
+    for (int i = 0; i <= size; ++i) {
+      for (int j = 0; j <= size; ++j) {
+        ObjVertex& v = model->vertices[i * row + j];
+        v.position = Vec3(j * 0.01f, 0, i * 0.01f);
+        v.texCoord = Vec2(j / float(size), i / float(size));
+        v.normal = Vec3(0, 1, 0);
+      }
+    }
+    model->indices.clear();
+    for (int i = 0; i < size; ++i) {
+      for (int j = 0; j < size; ++j) {
+        int a = i * row + j, b = a + row;
+        int quad[6] = { a, b, b + 1, a, b + 1, a + 1 };
+        model->indices.insert(model->indices.end(), quad, quad + 6);
+      }
+    }
+    model->min = Vec3(0, 0, 0);
+    model->max = Vec3(size * 0.01f, 0, size * 0.01f);
+    model->textured = true;
+  }
+
+  // Shuffles the triangles and the vertices, like a mesh whose exporter
+  // wrote them in no particular order.
+  void shuffle(ObjModel* model)
+  {
+    size_t triangles = model->indices.size() / 3;
+    for (size_t t = triangles - 1; t > 0; --t) {
+      size_t u = std::rand() % (t + 1);
+      for (int k = 0; k < 3; ++k)
+        std::swap(model->indices[3 * t + k], model->indices[3 * u + k]);
+    }
+    std::vector<int> order(model->vertices.size());
+    for (size_t i = 0; i < order.size(); ++i)
+      order[i] = static_cast<int>(i);
+    for (size_t i = order.size() - 1; i > 0; --i)
+      std::swap(order[i], order[std::rand() % (i + 1)]);
+    std::vector<ObjVertex> vertices(order.size());
+    for (size_t i = 0; i < order.size(); ++i)
+      vertices[order[i]] = model->vertices[i];
+    model->vertices.swap(vertices);
+    for (size_t i = 0; i < model->indices.size(); ++i)
+      model->indices[i] = order[model->indices[i]];
+  }
+
+  float gather(const ObjModel& model)
+  {
+    float sum = 0;
+    for (size_t i = 0; i < model.indices.size(); ++i)
+      sum += model.vertices[model.indices[i]].position.x;
+    return sum;
+  }
+
+  void run(const char* name, const ObjModel& source)
+  {
+    size_t n = source.indices.size();
+    ObjModel model = source;
+    VertexCacheStats before, after;
+    optimizeMesh(&model, &before, &after);
+
+    double optimize = bench::measure([&](size_t) {
+      ObjModel copy = source;
+      optimizeMesh(&copy);
+      bench::keep(copy.indices[0]);
+    }, 1, 3);
+    double gatherBefore = bench::measure([&](size_t) { bench::keep(gather(source)); }, 1, 5) / n;
+    double gatherAfter = bench::measure([&](size_t) { bench::keep(gather(model)); }, 1, 5) / n;
+
+    std::printf("\n%s (%zu triangles, optimized in %.1f ms)\n", name, n / 3, optimize * 1e-6);
+    std::printf("%-10s %8s %8s %10s %12s\n", "", "ACMR", "ATVR", "overfetch", "ns/index");
+    std::printf("%-10s %8.3f %8.3f %10.3f %12.2f\n", "before", before.acmr, before.atvr,
+                before.overfetch, gatherBefore);
+    std::printf("%-10s %8.3f %8.3f %10.3f %12.2f\n", "after", after.acmr, after.atvr,
+                after.overfetch, gatherAfter);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int size = argc > 1 ? std::atoi(argv[1]) : 500;
+  std::srand(1);
+  std::printf("FIFO cache of 16 vertices, %zu-byte vertices\n", sizeof(ObjVertex));
+
+  ObjModel grid;
+  makeGrid(size, &grid);
+  run("grid in row order", grid);
+  shuffle(&grid);
+  run("grid in random order", grid);
+  return 0;
+}
@@ -0,0 +1,85 @@
+// Builds LOD chains for a bumpy terrain grid (with open borders) and a
+// textured sphere (with a UV seam and poles), and reports the triangles and
+// error of each level, the time to build the chain, and the level that
+// selectLod() picks at a few distances for a 1080-pixel-high viewport.
+//
+//   cgl_mesh_simplifier_bench [grid size]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "math/cgl_math.h"
+#include "util/camera.h"
+#include "util/mesh_simplifier.h"
+#include "bench.h"
+
+using namespace cgl;
+
+namespace
+{
+  // A size x size grid of quads over [0, 1] x [0, 1] with smooth bumps.
+  void makeTerrain(int size, ObjModel* model)
+  {
+    int row = size + 1;
+    for (int i = 0; i <= size; ++i) {
+      for (int j = 0; j <= size; ++j) {
+        float x = j / float(size), z = i / float(size);
+        ObjVertex v;
+        v.position = Vec3(x, 0.05f * std::sin(x * 12.0f) * std::cos(z * 9.0f), z);
+        v.texCoord = Vec2(x, z);
+        v.normal = Vec3(0, 1, 0);
+        model->vertices.push_back(v);
+      }
+    }
+    for (int i = 0; i < size; ++i) {
+      for (int j = 0; j < size; ++j) {
+        int a = i * row + j, b = a + row;
+        int quad[6] = { a, b, b + 1, a, b + 1, a + 1 };
+        model->indices.insert(model->indices.end(), quad, quad + 6);
+      }
+    }
+    model->min = Vec3(0, -0.05f, 0);
+    model->max = Vec3(1, 0.05f, 1);
+    model->textured = true;
+  }
+
+  void run(const char* name, const ObjModel& model)
+  {
+    LodChain chain;
+    double ns = bench::measure([&](size_t) {
+      buildLodChain(model, 8, 0.5f, &chain);
+    }, 1, 1);
+
+    std::printf("\n%s: %zu levels in %.1f ms\n", name, chain.levels.size(), ns * 1e-6);
+    std::printf("%-6s %10s %10s %12s\n", "level", "triangles", "vertices", "error");
+    for (size_t i = 0; i < chain.levels.size(); ++i) {
+      const LodLevel& level = chain.levels[i];
+      std::printf("%-6zu %10zu %10zu %12.6f\n", i, level.model.indices.size() / 3,
+                  level.model.vertices.size(), level.error);
+    }
+
+    Camera camera;
+    camera.setProjection(perspective(1.0f, 16.0f / 9.0f, 0.1f, 1000.0f));
+    std::printf("selectLod at 1 pixel:");
+    const float distances[] = { 2, 5, 10, 20, 50, 100 };
+    for (int i = 0; i < 6; ++i) {
+      camera.setView(translation(0, 0, -distances[i]) * translation(-chain.center));
+      std::printf(" %g -> %zu", distances[i], selectLod(chain, camera, Mat4(), 1080));
+    }
+    std::printf("\n");
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int size = argc > 1 ? std::atoi(argv[1]) : 300;
+
+  ObjModel terrain;
+  makeTerrain(size, &terrain);
+  run("terrain", terrain);
+
+  ObjModel sphere;
+  bench::makeSphere(size / 2, size, 1.0f, &sphere);
+  run("sphere", sphere);
+  return 0;
+}
@@ -0,0 +1,97 @@
+// Splits a dense sphere into meshlets, in the row order it is built in and
+// after optimizeMesh(), and reports the size of the meshlets and the time to
+// build them. Then culls them for a few views and reports the time per
+// meshlet and the triangles left after the frustum and after the normal
+// cones, next to the triangles drawn when the model is culled as a whole.
+//
+//   cgl_meshlet_bench [segments]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "math/cgl_math.h"
+#include "util/camera.h"
+#include "util/mesh_optimizer.h"
+#include "util/meshlet.h"
+#include "bench.h"
+
+using namespace cgl;
+
+namespace
+{
+  void build(const char* name, const ObjModel& model, MeshletMesh* mesh)
+  {
+    double ns = bench::measure([&](size_t) {
+      buildMeshlets(model, mesh);
+    }, 1, 3);
+    size_t triangles = model.indices.size() / 3;
+    double n = double(mesh->meshlets.size());
+    std::printf("%-10s %10zu %10.1f %10.1f %10.1f\n", name, mesh->meshlets.size(),
+                mesh->vertices.size() / n, triangles / n, ns * 1e-6);
+  }
+
+  size_t countTriangles(const MeshletMesh& mesh, const uint32_t* visible, size_t n)
+  {
+    size_t triangles = 0;
+    for (size_t i = 0; i < n; ++i)
+      triangles += mesh.meshlets[visible[i]].triangleCount;
+    return triangles;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int segments = argc > 1 ? std::atoi(argv[1]) : 1000;
+
+  ObjModel model;
+  bench::makeSphere(segments / 2, segments, 1.0f, &model);
+  size_t triangles = model.indices.size() / 3;
+  std::printf("sphere: %zu triangles\n\n", triangles);
+
+  std::printf("%-10s %10s %10s %10s %10s\n", "order", "meshlets", "vertices", "triangles", "build ms");
+  MeshletMesh mesh;
+  build("rows", model, &mesh);
+  optimizeMesh(&model);
+  build("optimized", model, &mesh);
+
+  struct View
+  {
+    const char* name;
+    Vec3 eye, target;
+  };
+  const View views[] = {
+    { "outside", Vec3(0, 0, 3), Vec3(0.0f) },
+    { "near", Vec3(0, 0, 1.3f), Vec3(0.0f) },
+    { "grazing", Vec3(0, 0, 1.1f), Vec3(1, 0, 1.1f) },
+    { "away", Vec3(0, 0, 3), Vec3(0, 0, 6) },
+  };
+
+  Camera camera;
+  camera.setProjection(perspective(1.0f, 16.0f / 9.0f, 0.01f, 100.0f));
+  std::vector<uint32_t> visible(mesh.meshlets.size());
+  size_t n = mesh.meshlets.size();
+  std::printf("\n%-10s %10s %10s %10s %10s %12s\n", "view", "model", "frustum", "cones", "visible",
+              "ns/meshlet");
+  for (size_t v = 0; v < sizeof(views) / sizeof(views[0]); ++v) {
+    const View& view = views[v];
+    camera.setView(lookAt(view.eye, view.target, Vec3(0, 1, 0)));
+
+    // the whole model, culled by its bounding sphere
+    Frustum frustum(camera.projection() * camera.view());
+    bool drawn = frustum.intersectsSphere(Vec3(0.0f), 1.0f);
+
+    size_t inFrustum = frustum.visibleSpheres(&mesh.spheres[0], n, &visible[0]);
+    size_t frustumTriangles = countTriangles(mesh, &visible[0], inFrustum);
+    size_t count = cullMeshlets(mesh, camera, Mat4(), &visible[0]);
+    size_t coneTriangles = countTriangles(mesh, &visible[0], count);
+
+    double ns = bench::measure([&](size_t) {
+      bench::keep(cullMeshlets(mesh, camera, Mat4(), &visible[0]));
+    }, 100);
+
+    std::printf("%-10s %9.1f%% %9.1f%% %9.1f%% %10zu %12.2f\n", view.name, drawn ? 100.0 : 0.0,
+                100.0 * frustumTriangles / triangles, 100.0 * coneTriangles / triangles, count, ns / n);
+  }
+  return 0;
+}
@@ -0,0 +1,201 @@
+// Writes a generated OBJ file (a grid of textured quads) and measures how
+// fast ObjLoader reads it, on one thread and on all hardware threads,
+// against tokenizing the same file with std::getline and
+// std::istringstream, as ObjLoader used to, and reading it back through the
+// binary mesh cache (in MB/s of OBJ text replaced). ObjLoader::stream is
+// measured with its default chunk size. Also compares the vertex
+// deduplication of the face corners through ObjVertexTable with the
+// std::map of triplet strings ObjLoader used before.
+//
+//   cgl_obj_loader_bench [grid size] [file]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "math/cgl_math.h"
+#include "util/mesh_cache.h"
+#include "util/obj_loader.h"
+#include "bench.h"
+
+using namespace cgl;
+
+namespace
+{
+  // Writes a size x size grid of quads with per-vertex positions, texture
+  // coordinates and normals. Returns the file size in bytes.
+  size_t writeGrid(const char* fileName, int size)
+  {
+    FILE* f = std::fopen(fileName, "wb");
+    if (!f)
+      return 0;
+    for (int i = 0; i <= size; ++i) {
+      for (int j = 0; j <= size; ++j) {
+        Vec3 n = Vec3(bench::random(-0.2f, 0.2f), 1, bench::random(-0.2f, 0.2f)).normalize();
+        std::fprintf(f, "v %.6f %.6f %.6f\n", j * 0.01f, bench::random(-0.05f, 0.05f), i * 0.01f);
+        std::fprintf(f, "vt %.6f %.6f\n", j / float(size), i / float(size));
+        std::fprintf(f, "vn %.6f %.6f %.6f\n", n.x, n.y, n.z);
+      }
+    }
+    int row = size + 1;
+    for (int i = 0; i < size; ++i) {
+      for (int j = 0; j < size; ++j) {
+        int a = i * row + j + 1, b = a + row;
+        std::fprintf(f, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n",
+                     a, a, a, b, b, b, b + 1, b + 1, b + 1, a + 1, a + 1, a + 1);
+      }
+    }
+    size_t bytes = static_cast<size_t>(std::ftell(f));
+    std::fclose(f);
+    return bytes;
+  }
+
+  // Reads every record the way the old loader did, without building a model.
+  size_t tokenizeWithStreams(const char* fileName)
+  {
+    std::ifstream in(fileName);
+    std::string line, prefix, triplet;
+    size_t count = 0;
+    while (std::getline(in, line)) {
+      std::istringstream iss(line);
+      iss >> prefix;
+      if (prefix == "v" || prefix == "vn") {
+        float x, y, z;
+        iss >> x >> y >> z;
+        count += x != 0;
+      } else if (prefix == "vt") {
+        float x, y;
+        iss >> x >> y;
+        count += x != 0;
+      } else if (prefix == "f") {
+        while (iss >> triplet)
+          count += std::atoi(triplet.substr(0, triplet.find('/')).c_str());
+      }
+    }
+    return count;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int size = argc > 1 ? std::atoi(argv[1]) : 1000;
+  const char* fileName = argc > 2 ? argv[2] : "cgl_obj_loader_bench.obj";
+  std::srand(1);
+  size_t bytes = writeGrid(fileName, size);
+  if (!bytes) {
+    std::printf("cannot write %s\n", fileName);
+    return 1;
+  }
+  double mb = bytes / 1e6;
+  std::printf("%s: %.1f MB, %d x %d quads\n\n", fileName, mb, size, size);
+  std::printf("%-28s %10s %10s\n", "", "MB/s", "speedup");
+
+  double base = bench::measure([&](size_t) {
+    bench::keep(tokenizeWithStreams(fileName));
+  }, 1, 3);
+  std::printf("%-28s %10.1f %9.2fx\n", "getline + istringstream", mb * 1e9 / base, 1.0);
+
+  ObjLoader loader;
+  ObjModel model;
+  double ns = bench::measure([&](size_t) {
+    loader.load(fileName, &model);
+    bench::keep(model.vertices[0]);
+  }, 1, 3);
+  std::printf("%-28s %10.1f %9.2fx\n", "ObjLoader::load", mb * 1e9 / ns, base / ns);
+
+  unsigned threads = hardwareThreads();
+  ns = bench::measure([&](size_t) {
+    loader.load(fileName, &model, threads);
+    bench::keep(model.vertices[0]);
+  }, 1, 3);
+  char name[64];
+  std::snprintf(name, sizeof(name), "ObjLoader::load (%u threads)", threads);
+  std::printf("%-28s %10.1f %9.2fx\n", name, mb * 1e9 / ns, base / ns);
+
+  // chunks of the default size, each touched as a consumer would
+  size_t chunks = 0, chunkVertices = 0;
+  ns = bench::measure([&](size_t) {
+    chunks = 0;
+    loader.stream(fileName, [&](const ObjModel& chunk) {
+      ++chunks;
+      chunkVertices = std::max(chunkVertices, chunk.vertices.size());
+      bench::keep(chunk.vertices[0]);
+      return true;
+    });
+  }, 1, 3);
+  std::printf("%-28s %10.1f %9.2fx\n", "ObjLoader::stream", mb * 1e9 / ns, base / ns);
+  
+  // the first call writes the cache, the measured ones read it
+  std::string cacheName = std::string(fileName) + ".cglmesh";
+  loader.loadCached(fileName, &model);
+  ns = bench::measure([&](size_t) {
+    loader.loadCached(fileName, &model);
+    bench::keep(model.vertices[0]);
+  }, 1, 3);
+  std::printf("%-28s %10.1f %9.2fx\n", "loadCached (ObjModel)", mb * 1e9 / ns, base / ns);
+  MeshCache cache;
+  ns = bench::measure([&](size_t) {
+    loader.loadCached(fileName, &cache);
+    bench::keep(cache.vertices()[0]);
+  }, 1, 3);
+  std::printf("%-28s %10.1f %9.2fx\n", "loadCached (MeshCache view)", mb * 1e9 / ns, base / ns);
+  cache.close();
+  std::printf("\n%zu vertices, %zu indices; streamed in %zu chunks of up to %zu vertices\n",
+              model.vertices.size(), model.indices.size(), chunks, chunkVertices);
+
+  std::remove(fileName);
+  std::remove(cacheName.c_str());
+
+  // the corners of the grid faces in file order, each vertex shared by up
+  // to four quads
+  std::vector<int> corners;
+  std::vector<std::string> triplets;
+  int row = size + 1;
+  for (int i = 0; i < size; ++i) {
+    for (int j = 0; j < size; ++j) {
+      int a = i * row + j + 1, b = a + row;
+      int quad[4] = { a, b, b + 1, a + 1 };
+      for (int k = 0; k < 4; ++k) {
+        char triplet[48];
+        std::snprintf(triplet, sizeof(triplet), "%d/%d/%d", quad[k], quad[k], quad[k]);
+        corners.push_back(quad[k]);
+        triplets.push_back(triplet);
+      }
+    }
+  }
+  size_t n = corners.size();
+  std::printf("\ndeduplication of %zu face corners\n", n);
+  std::printf("%-28s %10s %10s\n", "", "ns/corner", "speedup");
+
+  base = bench::measure([&](size_t) {
+    std::map<int, std::map<std::string, int> > vertexMaps;
+    std::map<std::string, int>* vertexMap = &vertexMaps[1];
+    int count = 0;
+    for (size_t i = 0; i < n; ++i) {
+      if (vertexMap->find(triplets[i]) == vertexMap->end())
+        (*vertexMap)[triplets[i]] = count++;
+      else
+        bench::keep((*vertexMap)[triplets[i]]);
+    }
+    bench::keep(count);
+  }, 1, 3) / n;
+  std::printf("%-28s %10.2f %9.2fx\n", "std::map of triplets", base, 1.0);
+
+  ObjVertexTable table;
+  ns = bench::measure([&](size_t) {
+    table.clear(bytes / 128);
+    int count = 0;
+    for (size_t i = 0; i < n; ++i) {
+      int v = corners[i] - 1;
+      if (table.insert(1, v, v, v, count) == count)
+        ++count;
+    }
+    bench::keep(count);
+  }, 1, 3) / n;
+  std::printf("%-28s %10.2f %9.2fx\n", "ObjVertexTable", ns, base / ns);
+  return 0;
+}
@@ -0,0 +1,104 @@
+// Compares ray casting with the BVH one ray at a time and in packets, for
+// nearest-hit and any-hit queries, against testing every triangle. The rays
+// come from a pinhole camera looking at a generated mesh (a bumpy sphere made
+// of a grid of quads) and are ordered in square tiles so that consecutive
+// rays are coherent. Usage: cgl_raycast_bench [triangles, default 1000000]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "math/cgl_math.h"
+#include "util/raycast.h"
+#include "bench.h"
+
+using namespace cgl;
+
+namespace
+{
+  // Moller-Trumbore against every triangle, one at a time.
+  RayHit bruteForce(const Ray& ray, const std::vector<Vec3>& positions, const std::vector<int>& indices)
+  {
+    RayHit hit = { 1e30f, -1, 0.0f, 0.0f };
+    for (size_t t = 0; t < indices.size() / 3; ++t) {
+      const Vec3& a = positions[indices[3 * t]];
+      Vec3 e1 = positions[indices[3 * t + 1]] - a;
+      Vec3 e2 = positions[indices[3 * t + 2]] - a;
+      Vec3 p = ray.direction.cross(e2);
+      float det = e1.dot(p);
+      if (det == 0)
+        continue;
+      Vec3 s = ray.origin - a;
+      Vec3 q = s.cross(e1);
+      float u = s.dot(p) / det;
+      float v = ray.direction.dot(q) / det;
+      float d = e2.dot(q) / det;
+      if (u >= 0 && v >= 0 && u + v <= 1 && d > 0 && d < hit.t) {
+        RayHit h = { d, static_cast<int>(t), u, v };
+        hit = h;
+      }
+    }
+    return hit;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  size_t triangles = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 1000000;
+  int n = static_cast<int>(std::sqrt(triangles / 2.0));
+  std::vector<Vec3> positions;
+  std::vector<int> indices;
+  bench::sphereGrid(n, &positions, &indices);
+  RayCaster caster;
+  caster.build(&positions[0], sizeof(Vec3), &indices[0], indices.size() / 3);
+
+  const int size = 512;
+  const int tile = 8;
+  Mat4 viewProjection = perspective(0.8f, 1.0f, 0.1f, 100.0f) *
+    lookAt(Vec3(0.5f, 1.0f, 3.0f), Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f));
+  std::vector<Ray> rays;
+  for (int ty = 0; ty < size; ty += tile)
+    for (int tx = 0; tx < size; tx += tile)
+      for (int y = ty; y < ty + tile; ++y)
+        for (int x = tx; x < tx + tile; ++x)
+          rays.push_back(pickRay(viewProjection, x + 0.5f, y + 0.5f, size, size));
+  size_t count = rays.size();
+  std::vector<RayHit> hits(count);
+
+  size_t found = 0;
+  caster.cast(&rays[0], count, &hits[0]);
+  for (size_t i = 0; i < count; ++i)
+    found += hits[i].hit();
+  std::printf("%u triangles, %u rays (%u hit), %d rays per packet\n\n",
+              unsigned(indices.size() / 3), unsigned(count), unsigned(found), RayCaster::packetSize);
+  std::printf("%-28s %10s %10s\n", "", "time", "speedup");
+
+  double base = bench::measure([&](size_t) {
+    for (size_t i = 0; i < count; ++i)
+      hits[i] = caster.cast(rays[i]);
+    bench::keep(hits[0]);
+  }, 1) / count;
+
+  // brute force is far too slow for every ray; sample some
+  size_t step = count / 32;
+  bench::report("brute force", bench::measure([&](size_t i) {
+    bench::keep(bruteForce(rays[i * step], positions, indices));
+  }, 32, 1), base);
+
+  bench::report("nearest, single rays", base, base);
+  bench::report("nearest, packets", bench::measure([&](size_t) {
+    caster.cast(&rays[0], count, &hits[0]);
+    bench::keep(hits[0]);
+  }, 1) / count, base);
+  bench::report("any hit, single rays", bench::measure([&](size_t) {
+    for (size_t i = 0; i < count; ++i)
+      hits[i] = caster.cast(rays[i], ANY_HIT);
+    bench::keep(hits[0]);
+  }, 1) / count, base);
+  bench::report("any hit, packets", bench::measure([&](size_t) {
+    caster.cast(&rays[0], count, &hits[0], ANY_HIT);
+    bench::keep(hits[0]);
+  }, 1) / count, base);
+
+  return 0;
+}
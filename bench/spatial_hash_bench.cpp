@@ -0,0 +1,104 @@
+// Builds a SpatialHashGrid over random points and measures the build, the
+// incremental updates and the queries, with a brute-force scan over the
+// points as the baseline for the queries.
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+#include "math/cgl_math.h"
+#include "util/spatial_hash.h"
+#include "bench.h"
+
+using namespace cgl;
+
+namespace
+{
+  Vec3 randomVec3(float lo, float hi)
+  {
+    return Vec3(bench::random(lo, hi), bench::random(lo, hi), bench::random(lo, hi));
+  }
+}
+
+int main()
+{
+  // 1M points in a 100^3 box: one point per unit cube on average
+  const size_t n = 1000000;
+  const size_t queries = 1000;
+  const float radius = 2.0f;
+  std::srand(1);
+  std::vector<Vec3> points(n), centers(queries);
+  for (size_t i = 0; i < n; ++i)
+    points[i] = randomVec3(0, 100);
+  for (size_t i = 0; i < queries; ++i)
+    centers[i] = randomVec3(0, 100);
+
+  SpatialHashGrid grid(radius);
+  std::printf("%-28s %10s %10s\n", "", "time", "speedup");
+
+  std::printf("\nbuild %zu points (per point)\n", n);
+  double base = bench::measure([&](size_t) {
+    grid.build(&points[0], n, 1);
+  }, 1, 3) / n;
+  bench::report("build, 1 thread", base, base);
+  bench::report("build, all threads", bench::measure([&](size_t) {
+    grid.build(&points[0], n);
+  }, 1, 3) / n, base);
+
+  std::vector<uint32_t> ids(n);
+  std::printf("\nradius %.0f query (per query)\n", radius);
+  base = bench::measure([&](size_t q) {
+    size_t found = 0;
+    float r2 = radius * radius;
+    for (size_t i = 0; i < n; ++i)
+      if ((points[i] - centers[q]).lengthSquared() <= r2)
+        ids[found++] = static_cast<uint32_t>(i);
+    bench::keep(found);
+  }, 20, 1);
+  bench::report("brute force", base, base);
+  double queryNs = bench::measure([&](size_t q) {
+    bench::keep(grid.queryRadius(centers[q], radius, &ids[0], ids.size()));
+  }, queries);
+  bench::report("queryRadius", queryNs, base);
+  size_t total = 0;
+  for (size_t q = 0; q < queries; ++q)
+    total += grid.queryRadius(centers[q], radius, &ids[0], ids.size());
+  std::printf("%.1f points per query\n", double(total) / queries);
+
+  std::printf("\n8 nearest neighbours (per query)\n");
+  std::vector<SpatialHashGrid::Neighbor> neighbors(8);
+  base = bench::measure([&](size_t q) {
+    size_t found = 0;
+    for (size_t i = 0; i < n; ++i) {
+      SpatialHashGrid::Neighbor c = { static_cast<uint32_t>(i), (points[i] - centers[q]).lengthSquared() };
+      if (found < 8) {
+        neighbors[found++] = c;
+        std::push_heap(neighbors.begin(), neighbors.begin() + found);
+      } else if (c < neighbors[0]) {
+        std::pop_heap(neighbors.begin(), neighbors.end());
+        neighbors[7] = c;
+        std::push_heap(neighbors.begin(), neighbors.end());
+      }
+    }
+    bench::keep(neighbors[0]);
+  }, 20, 1);
+  bench::report("brute force", base, base);
+  bench::report("queryNearest", bench::measure([&](size_t q) {
+    bench::keep(grid.queryNearest(centers[q], 8, &neighbors[0]));
+  }, queries), base);
+
+  std::printf("\nincremental updates (per operation)\n");
+  grid.build(&points[0], n);
+  base = bench::measure([&](size_t i) {
+    bench::keep(grid.insert(points[i]));
+  }, n / 4, 1);
+  bench::report("insert", base, base);
+  bench::report("remove", bench::measure([&](size_t i) {
+    bench::keep(grid.remove(static_cast<uint32_t>(i)));
+  }, n / 4, 1), base);
+  bench::report("queryRadius after updates", bench::measure([&](size_t q) {
+    bench::keep(grid.queryRadius(centers[q], radius, &ids[0], ids.size()));
+  }, queries), queryNs);
+
+  return 0;
+}
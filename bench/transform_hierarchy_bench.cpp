@@ -0,0 +1,83 @@
+// Compares TransformHierarchy::update with a serial loop that recomputes
+// every world matrix, on a generated scene of many small trees.
+// Usage: cgl_transform_hierarchy_bench [nodes, default 50000]
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "math/cgl_math.h"
+#include "math/parallel.h"
+#include "util/transform_hierarchy.h"
+#include "bench.h"
+
+using namespace cgl;
+
+namespace
+{
+  Mat4 randomTransform()
+  {
+    return translation(bench::random(-1, 1), bench::random(-1, 1), bench::random(-1, 1)) *
+      rotation(bench::random(-PI, PI), Vec3(bench::random(-1, 1), bench::random(-1, 1), bench::random(0.1f, 1)));
+  }
+}
+
+int main(int argc, char** argv)
+{
+  size_t n = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 50000;
+  const uint32_t none = TransformHierarchy::none;
+
+  // trees of up to ~250 nodes, each node attached to a random earlier node of
+  // its tree, created in a shuffled order the way a scene loader might
+  std::srand(1);
+  std::vector<uint32_t> parents(n);
+  std::vector<Mat4> locals(n);
+  for (size_t i = 0; i < n; ++i) {
+    size_t treeStart = i - i % 250;
+    parents[i] = i == treeStart ? none : static_cast<uint32_t>(treeStart + std::rand() % (i - treeStart));
+    locals[i] = randomTransform();
+  }
+  TransformHierarchy hierarchy;
+  for (size_t i = 0; i < n; ++i)
+    hierarchy.add(parents[i], locals[i]);
+  hierarchy.update();
+  std::printf("%u nodes, %u levels, %u hardware threads\n\n",
+              unsigned(n), unsigned(hierarchy.levels()), hardwareThreads());
+  std::printf("%-28s %10s %10s\n", "", "time", "speedup");
+
+  // parents precede children here, so one pass in index order is enough
+  std::vector<Mat4> worlds(n);
+  double base = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      worlds[i] = parents[i] == none ? locals[i] : worlds[parents[i]] * locals[i];
+    bench::keep(worlds[0]);
+  }, 20) / n;
+  std::printf("\nall nodes changed\n");
+  bench::report("serial loop", base, base);
+
+  const size_t roots = (n + 249) / 250;
+  unsigned threadCounts[2] = { 1, 0 };
+  const char* names[2] = { "update (threads = 1)", "update (threads = 0)" };
+  for (int k = 0; k < 2; ++k) {
+    bench::report(names[k], bench::measure([&](size_t) {
+      for (size_t r = 0; r < roots; ++r)
+        hierarchy.setLocal(static_cast<uint32_t>(r * 250), locals[r * 250]);
+      bench::keep(hierarchy.update(threadCounts[k]));
+    }, 20) / n, base);
+  }
+
+  // a few moving objects: 1% of the nodes, and their subtrees
+  std::vector<uint32_t> moving;
+  for (size_t i = 0; i < n / 100; ++i)
+    moving.push_back(static_cast<uint32_t>(std::rand() % n));
+  size_t updated = 0;
+  double ns = bench::measure([&](size_t) {
+    for (size_t i = 0; i < moving.size(); ++i)
+      hierarchy.setLocal(moving[i], locals[moving[i]]);
+    updated = hierarchy.update();
+  }, 20) / n;
+  std::printf("\n1%% of the nodes changed (%u world matrices recomputed)\n", unsigned(updated));
+  bench::report("serial loop", base, base);
+  bench::report("update", ns, base);
+
+  return 0;
+}
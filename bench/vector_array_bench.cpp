@@ -0,0 +1,115 @@
+// Compares the structure-of-arrays kernels in vector_array.h with loops over
+// arrays of Vec3 (array-of-structs) doing the same work.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "math/cgl_math.h"
+#include "math/batch_transform.h"
+#include "math/vector_array.h"
+#include "bench.h"
+
+using namespace cgl;
+
+namespace
+{
+  void row(const char* name, double aos, double soa)
+  {
+    std::printf("\n%s\n", name);
+    bench::report("array of Vec3", aos, aos);
+    bench::report("Vec3Array", soa, aos);
+  }
+}
+
+int main()
+{
+  // small enough to stay in cache, so the arithmetic dominates
+  const size_t n = 4096;
+  const size_t repeat = 256;
+  std::srand(1);
+  std::vector<Vec3> a(n), b(n), out(n);
+  for (size_t i = 0; i < n; ++i) {
+    a[i] = Vec3(bench::random(-1, 1), bench::random(-1, 1), bench::random(-1, 1));
+    b[i] = Vec3(bench::random(-1, 1), bench::random(-1, 1), bench::random(-1, 1));
+  }
+  Vec3Array sa(&a[0], n), sb(&b[0], n), sout(n);
+  std::vector<float> dots(n);
+  Mat4 M = translation(1.f, 2.f, 3.f) * rotation(0.5f, Vec3(1.f, 1.f, 0.f)) * scale(2.f);
+
+  std::printf("%-28s %10s %10s\n", "", "time", "speedup");
+
+  double aos = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      dots[i] = a[i].dot(b[i]);
+    bench::keep(dots[0]);
+  }, repeat) / n;
+  double soa = bench::measure([&](size_t) {
+    dot(sa, sb, &dots[0]);
+    bench::keep(dots[0]);
+  }, repeat) / n;
+  row("dot", aos, soa);
+
+  aos = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      out[i] = a[i].cross(b[i]);
+    bench::keep(out[0]);
+  }, repeat) / n;
+  soa = bench::measure([&](size_t) {
+    cross(sa, sb, &sout);
+    bench::keep(sout);
+  }, repeat) / n;
+  row("cross", aos, soa);
+
+  aos = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      out[i] = a[i].normal();
+    bench::keep(out[0]);
+  }, repeat) / n;
+  soa = bench::measure([&](size_t) {
+    sout = sa;
+    normalize(&sout);
+    bench::keep(sout);
+  }, repeat) / n;
+  row("normalize (Vec3Array copies)", aos, soa);
+
+  Vec3 lo, hi;
+  aos = bench::measure([&](size_t) {
+    lo = a[0];
+    hi = a[0];
+    for (size_t i = 1; i < n; ++i) {
+      lo = Vec3(std::min(lo.x, a[i].x), std::min(lo.y, a[i].y), std::min(lo.z, a[i].z));
+      hi = Vec3(std::max(hi.x, a[i].x), std::max(hi.y, a[i].y), std::max(hi.z, a[i].z));
+    }
+    bench::keep(lo);
+    bench::keep(hi);
+  }, repeat) / n;
+  soa = bench::measure([&](size_t) {
+    bounds(sa, &lo, &hi);
+    bench::keep(lo);
+    bench::keep(hi);
+  }, repeat) / n;
+  row("min/max", aos, soa);
+
+  aos = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      out[i] = a[i] + (b[i] - a[i]) * 0.25f;
+    bench::keep(out[0]);
+  }, repeat) / n;
+  soa = bench::measure([&](size_t) {
+    lerp(sa, sb, 0.25f, &sout);
+    bench::keep(sout);
+  }, repeat) / n;
+  row("lerp", aos, soa);
+
+  aos = bench::measure([&](size_t) {
+    transformPoints(M, &a[0], &out[0], n);
+    bench::keep(out[0]);
+  }, repeat) / n;
+  soa = bench::measure([&](size_t) {
+    transformPoints(M, sa, &sout);
+    bench::keep(sout);
+  }, repeat) / n;
+  row("transformPoints (both SIMD)", aos, soa);
+
+  return 0;
+}
@@ -0,0 +1,140 @@
+// Compares the single-value and array versions of the encodings in
+// vertex_packing.h, and quantizes a generated sphere with compact() to show
+// the memory saved and the error introduced.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "math/cgl_math.h"
+#include "math/vertex_packing.h"
+#include "util/obj_loader.h"
+#include "bench.h"
+
+using namespace cgl;
+
+int main()
+{
+  const size_t n = 4096;
+  const size_t repeat = 256;
+  std::srand(1);
+  std::vector<float> values(n), unit(n), decoded(n);
+  std::vector<Vec3> normals(n), decodedNormals(n);
+  std::vector<Vec4> vectors(n), decodedVectors(n);
+  for (size_t i = 0; i < n; ++i) {
+    values[i] = bench::random(-1000, 1000);
+    unit[i] = bench::random(-1, 1);
+    normals[i] = Vec3(bench::random(-1, 1), bench::random(-1, 1), bench::random(-1, 1)).normalize();
+    vectors[i] = Vec4(bench::random(-1, 1), bench::random(-1, 1), bench::random(-1, 1), bench::random(-1, 1));
+  }
+  std::vector<uint16_t> halves(n), shorts(n);
+  std::vector<int16_t> snorms(n);
+  std::vector<uint32_t> packed(n);
+
+  std::printf("%-28s %10s %10s\n", "", "time", "speedup");
+
+  std::printf("\nhalf\n");
+  double base = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      halves[i] = packHalf(values[i]);
+    bench::keep(halves[0]);
+  }, repeat) / n;
+  bench::report("packHalf", base, base);
+  bench::report("packHalf (array)", bench::measure([&](size_t) {
+    packHalf(&values[0], &halves[0], n);
+    bench::keep(halves[0]);
+  }, repeat) / n, base);
+  base = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      decoded[i] = unpackHalf(halves[i]);
+    bench::keep(decoded[0]);
+  }, repeat) / n;
+  bench::report("unpackHalf", base, base);
+  bench::report("unpackHalf (array)", bench::measure([&](size_t) {
+    unpackHalf(&halves[0], &decoded[0], n);
+    bench::keep(decoded[0]);
+  }, repeat) / n, base);
+
+  std::printf("\nsnorm16 / unorm16\n");
+  base = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      snorms[i] = packSnorm16(unit[i]);
+    bench::keep(snorms[0]);
+  }, repeat) / n;
+  bench::report("packSnorm16", base, base);
+  bench::report("packSnorm16 (array)", bench::measure([&](size_t) {
+    packSnorm16(&unit[0], &snorms[0], n);
+    bench::keep(snorms[0]);
+  }, repeat) / n, base);
+  base = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      shorts[i] = packUnorm16(unit[i]);
+    bench::keep(shorts[0]);
+  }, repeat) / n;
+  bench::report("packUnorm16", base, base);
+  bench::report("packUnorm16 (array)", bench::measure([&](size_t) {
+    packUnorm16(&unit[0], &shorts[0], n);
+    bench::keep(shorts[0]);
+  }, repeat) / n, base);
+
+  std::printf("\noctahedral normals\n");
+  base = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      packed[i] = packOctahedral(normals[i]);
+    bench::keep(packed[0]);
+  }, repeat) / n;
+  bench::report("packOctahedral", base, base);
+  bench::report("packOctahedral (array)", bench::measure([&](size_t) {
+    packOctahedral(&normals[0], &packed[0], n);
+    bench::keep(packed[0]);
+  }, repeat) / n, base);
+  base = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      decodedNormals[i] = unpackOctahedral(packed[i]);
+    bench::keep(decodedNormals[0]);
+  }, repeat) / n;
+  bench::report("unpackOctahedral", base, base);
+  bench::report("unpackOctahedral (array)", bench::measure([&](size_t) {
+    unpackOctahedral(&packed[0], &decodedNormals[0], n);
+    bench::keep(decodedNormals[0]);
+  }, repeat) / n, base);
+
+  std::printf("\n10-10-10-2\n");
+  base = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      packed[i] = packSnorm1010102(vectors[i]);
+    bench::keep(packed[0]);
+  }, repeat) / n;
+  bench::report("packSnorm1010102", base, base);
+  bench::report("packSnorm1010102 (array)", bench::measure([&](size_t) {
+    packSnorm1010102(&vectors[0], &packed[0], n);
+    bench::keep(packed[0]);
+  }, repeat) / n, base);
+  base = bench::measure([&](size_t) {
+    for (size_t i = 0; i < n; ++i)
+      decodedVectors[i] = unpackSnorm1010102(packed[i]);
+    bench::keep(decodedVectors[0]);
+  }, repeat) / n;
+  bench::report("unpackSnorm1010102", base, base);
+  bench::report("unpackSnorm1010102 (array)", bench::measure([&](size_t) {
+    unpackSnorm1010102(&packed[0], &decodedVectors[0], n);
+    bench::keep(decodedVectors[0]);
+  }, repeat) / n, base);
+
+  std::printf("\ncompact() of a sphere with radius 10\n");
+  ObjModel model;
+  bench::makeSphere(256, 512, 10.0f, &model);
+  CompactModel compactModel;
+  double ns = bench::measure([&](size_t) {
+    compact(model, &compactModel);
+    bench::keep(compactModel.vertices[0]);
+  }, 1);
+  std::printf("%zu vertices, %.2f ns/vertex, %zu -> %zu bytes\n", model.vertices.size(),
+              ns / model.vertices.size(), model.vertices.size() * sizeof(ObjVertex),
+              compactModel.vertices.size() * sizeof(CompactVertex));
+  std::printf("max error: position %.2e, texCoord %.2e, normal %.4f degrees\n",
+              compactModel.error.position, compactModel.error.texCoord,
+              compactModel.error.normalDegrees);
+
+  return 0;
+}
@@ -13,6 +13,13 @@
 #endif
 
 #include "math/cgl_math.h"
+#include "math/batch_transform.h"
+#include "math/aligned.h"
+#include "math/quaternion.h"
+#include "math/dual_quaternion.h"
+#include "math/vector_array.h"
+#include "math/frustum.h"
+#include "math/vertex_packing.h"
 
 #include "gl/program.h"
 #include "gl/shader.h"
@@ -0,0 +1,70 @@
+#ifndef CGL_ALIGNED_H_
+#define CGL_ALIGNED_H_
+
+#include <cstddef>
+#include "aligned_allocator.h"
+#include "batch_transform.h"
+#include "cgl_math.h"
+#include "parallel.h"
+#include "simd.h"
+
+// Aligned math types for the SIMD kernels. Vector4 and Matrix4 only have the
+// alignment of their components, so a std::vector<Mat4> may put a matrix
+// across two cache lines and cannot be read with aligned loads. Vec4A and
+// Mat4A are the same types with 16 and 64 byte alignment; they convert to and
+// from Vec4 and Mat4 for free, since they add no members. Store them in an
+// AlignedVector (aligned_allocator.h) to keep that alignment on the heap.
+
+namespace cgl
+{
+  /// Vec4 aligned to 16 bytes, for aligned SSE loads and stores.
+  class alignas(16) Vec4A : public Vec4
+  {
+  public:
+    using Vec4::Vec4;
+
+    /// Constructs a zero vector.
+    constexpr Vec4A() : Vec4() {}
+
+    /// Constructs an aligned copy of v.
+    constexpr Vec4A(const Vec4& v) : Vec4(v) {}
+  };
+
+  /// Mat4 aligned to 64 bytes, so each matrix fills exactly one cache line.
+  class alignas(64) Mat4A : public Mat4
+  {
+  public:
+    using Mat4::Mat4;
+
+    /// Constructs an identity matrix.
+    constexpr Mat4A() : Mat4() {}
+
+    /// Constructs an aligned copy of M.
+    constexpr Mat4A(const Mat4& M) : Mat4(M) {}
+  };
+
+  static_assert(sizeof(Vec4A) == sizeof(Vec4), "Vec4A must have the layout of Vec4");
+  static_assert(sizeof(Mat4A) == sizeof(Mat4), "Mat4A must have the layout of Mat4");
+
+  typedef AlignedVector<Vec4A> Vec4AVector;
+  typedef AlignedVector<Mat4A> Mat4AVector;
+
+  /// Multiplies M with each of the n vectors in src, like transform() for
+  /// Vec4, but with aligned loads and stores.
+  inline void transform(const Mat4& M, const Vec4A* src, Vec4A* dst, size_t n, unsigned threads = 1)
+  {
+#ifdef CGL_SIMD_SSE
+    const float* m = M;
+    __m128 c0 = _mm_loadu_ps(m), c1 = _mm_loadu_ps(m + 4), c2 = _mm_loadu_ps(m + 8), c3 = _mm_loadu_ps(m + 12);
+    parallelFor(n, threads, [=](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i)
+        _mm_store_ps(&dst[i].x, simd::combine(c0, c1, c2, c3, _mm_load_ps(&src[i].x)));
+    });
+#else
+    transform(M, static_cast<const Vec4*>(src), static_cast<Vec4*>(dst), n, threads);
+#endif
+  }
+
+} // namespace cgl
+
+#endif // CGL_ALIGNED_H_
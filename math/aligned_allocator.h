@@ -0,0 +1,91 @@
+#ifndef CGL_ALIGNED_ALLOCATOR_H_
+#define CGL_ALIGNED_ALLOCATOR_H_
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+// std::allocator only honours alignments above that of max_align_t from
+// C++17 on, so containers of over-aligned types (Vec4A, Mat4A) or of floats
+// for aligned SIMD loads use AlignedAllocator instead.
+
+namespace cgl
+{
+  namespace detail
+  {
+    /// Allocates size bytes aligned to alignment (a power of two, at least
+    /// sizeof(void*)). Returns NULL on failure.
+    inline void* alignedMalloc(size_t size, size_t alignment)
+    {
+#ifdef _MSC_VER
+      return _aligned_malloc(size, alignment);
+#else
+      void* p;
+      return posix_memalign(&p, alignment, size) == 0 ? p : NULL;
+#endif
+    }
+
+    /// Frees memory from alignedMalloc().
+    inline void alignedFree(void* p)
+    {
+#ifdef _MSC_VER
+      _aligned_free(p);
+#else
+      std::free(p);
+#endif
+    }
+  }
+
+  /// STL allocator that aligns every allocation to Alignment bytes, or to
+  /// alignof(T) if that is larger.
+  template <typename T, size_t Alignment = 16> class AlignedAllocator
+  {
+  public:
+
+    typedef T value_type;
+
+    template <typename U> struct rebind
+    {
+      typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator() {}
+
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    /// Allocates room for n objects; throws std::bad_alloc on failure, as the
+    /// containers expect.
+    T* allocate(size_t n)
+    {
+      if (n == 0)
+        return NULL;
+      size_t alignment = Alignment > alignof(T) ? Alignment : alignof(T);
+      if (alignment < sizeof(void*))
+        alignment = sizeof(void*);
+      void* p = detail::alignedMalloc(n * sizeof(T), alignment);
+      if (!p)
+        throw std::bad_alloc();
+      return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t)
+    {
+      detail::alignedFree(p);
+    }
+
+    template <typename U> bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+  };
+
+  /// std::vector whose storage is aligned to Alignment bytes (and to the
+  /// alignment of T).
+  template <typename T, size_t Alignment = 16> using AlignedVector = std::vector<T, AlignedAllocator<T, Alignment>>;
+
+}
+
+#endif // CGL_ALIGNED_ALLOCATOR_H_
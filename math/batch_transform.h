@@ -0,0 +1,316 @@
+#ifndef CGL_BATCH_TRANSFORM_H_
+#define CGL_BATCH_TRANSFORM_H_
+
+#include <cstddef>
+#include "cgl_math.h"
+#include "parallel.h"
+#include "simd.h"
+
+// Transforms arrays of vectors through a Mat4. Every Vec3 function has two
+// forms: one for contiguous Vec3 arrays, and one for strided arrays where src
+// and dst point at the first float of the first vector and each following
+// vector starts stride bytes after the previous one (e.g. the position field
+// of an ObjVertex array with stride sizeof(ObjVertex)). src and dst may alias
+// for in-place transforms. The threads argument splits large batches across
+// threads (0 = one per hardware thread); the default runs on the caller.
+
+namespace cgl
+{
+  namespace detail
+  {
+    enum TransformMode
+    {
+      TRANSFORM_POINT,      // w = 1
+      TRANSFORM_DIRECTION,  // w = 0
+      TRANSFORM_NORMAL,     // w = 0, result normalized
+      TRANSFORM_PROJECT     // w = 1, result divided by w
+    };
+
+    template <int Mode>
+    void transformRange(const float* m, const char* src, size_t srcStride,
+      char* dst, size_t dstStride, size_t begin, size_t end)
+    {
+      const bool hasW = (Mode == TRANSFORM_POINT || Mode == TRANSFORM_PROJECT);
+      size_t i = begin;
+
+#ifdef CGL_SIMD_SSE
+      // four vectors per iteration in structure-of-arrays form
+      __m128 M[16];
+      for (int k = 0; k < 16; ++k)
+        M[k] = _mm_set1_ps(m[k]);
+
+      for (; i + 4 <= end; i += 4) {
+        const float* p0 = reinterpret_cast<const float*>(src + srcStride * i);
+        const float* p1 = reinterpret_cast<const float*>(src + srcStride * (i + 1));
+        const float* p2 = reinterpret_cast<const float*>(src + srcStride * (i + 2));
+        const float* p3 = reinterpret_cast<const float*>(src + srcStride * (i + 3));
+        __m128 x = _mm_setr_ps(p0[0], p1[0], p2[0], p3[0]);
+        __m128 y = _mm_setr_ps(p0[1], p1[1], p2[1], p3[1]);
+        __m128 z = _mm_setr_ps(p0[2], p1[2], p2[2], p3[2]);
+
+        __m128 r[3];
+        for (int c = 0; c < 3; ++c) {
+          r[c] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(M[c], x), _mm_mul_ps(M[c + 4], y)),
+                            _mm_mul_ps(M[c + 8], z));
+          if (hasW)
+            r[c] = _mm_add_ps(r[c], M[c + 12]);
+        }
+
+        if (Mode == TRANSFORM_PROJECT) {
+          __m128 w = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(M[3], x),
+            _mm_mul_ps(M[7], y)), _mm_mul_ps(M[11], z)), M[15]);
+          for (int c = 0; c < 3; ++c)
+            r[c] = _mm_div_ps(r[c], w);
+        } else if (Mode == TRANSFORM_NORMAL) {
+          __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r[0], r[0]),
+            _mm_mul_ps(r[1], r[1])), _mm_mul_ps(r[2], r[2])));
+          for (int c = 0; c < 3; ++c)
+            r[c] = _mm_div_ps(r[c], len);
+        }
+
+        float out[3][4];
+        for (int c = 0; c < 3; ++c)
+          _mm_storeu_ps(out[c], r[c]);
+        for (int k = 0; k < 4; ++k) {
+          float* q = reinterpret_cast<float*>(dst + dstStride * (i + k));
+          q[0] = out[0][k];
+          q[1] = out[1][k];
+          q[2] = out[2][k];
+        }
+      }
+#endif
+
+      for (; i < end; ++i) {
+        const float* p = reinterpret_cast<const float*>(src + srcStride * i);
+        float x = p[0], y = p[1], z = p[2];
+        float r[3];
+        for (int c = 0; c < 3; ++c) {
+          r[c] = m[c] * x + m[c + 4] * y + m[c + 8] * z;
+          if (hasW)
+            r[c] += m[c + 12];
+        }
+
+        if (Mode == TRANSFORM_PROJECT) {
+          float w = m[3] * x + m[7] * y + m[11] * z + m[15];
+          for (int c = 0; c < 3; ++c)
+            r[c] /= w;
+        } else if (Mode == TRANSFORM_NORMAL) {
+          float len = std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+          for (int c = 0; c < 3; ++c)
+            r[c] /= len;
+        }
+
+        float* q = reinterpret_cast<float*>(dst + dstStride * i);
+        q[0] = r[0];
+        q[1] = r[1];
+        q[2] = r[2];
+      }
+    }
+
+    template <int Mode>
+    void transformStrided(const Mat4& M, const void* src, size_t srcStride,
+      void* dst, size_t dstStride, size_t n, unsigned threads)
+    {
+      const float* m = M;
+      const char* s = static_cast<const char*>(src);
+      char* d = static_cast<char*>(dst);
+      parallelFor(n, threads, [=](size_t begin, size_t end) {
+        transformRange<Mode>(m, s, srcStride, d, dstStride, begin, end);
+      });
+    }
+
+    // The columns of the inverse-transpose of a 3x3 matrix with columns c0,
+    // c1 and c2 are its cofactors c1 x c2, c2 x c0 and c0 x c1 divided by
+    // the determinant c0 . (c1 x c2).
+
+    // Writes the normal matrix of M to dst, whose columns are Stride floats
+    // apart (3 for Mat3, 4 for std140). Singular matrices give the identity,
+    // like Matrix3::inverse().
+    template <int Stride> void normalMatrixScalar(const Mat4& M, float* dst)
+    {
+      const float* m = M;
+      float r[9] = {
+        m[5] * m[10] - m[6] * m[9], m[6] * m[8] - m[4] * m[10], m[4] * m[9] - m[5] * m[8],
+        m[9] * m[2] - m[10] * m[1], m[10] * m[0] - m[8] * m[2], m[8] * m[1] - m[9] * m[0],
+        m[1] * m[6] - m[2] * m[5], m[2] * m[4] - m[0] * m[6], m[0] * m[5] - m[1] * m[4]
+      };
+      float det = (m[0] * r[0] + m[2] * r[2]) + m[1] * r[1];
+      if (!(det < 0 || det > 0)) {
+        r[0] = r[4] = r[8] = det = 1;
+        r[1] = r[2] = r[3] = r[5] = r[6] = r[7] = 0;
+      }
+      float s = 1.0f / det;
+      for (int c = 0; c < 3; ++c) {
+        dst[Stride * c] = r[3 * c] * s;
+        dst[Stride * c + 1] = r[3 * c + 1] * s;
+        dst[Stride * c + 2] = r[3 * c + 2] * s;
+        if (Stride == 4)
+          dst[4 * c + 3] = 0;
+      }
+    }
+
+#ifdef CGL_SIMD_SSE
+    // Rotates the x, y and z lanes to y, z and x.
+    inline __m128 rotateXYZ(__m128 v)
+    {
+      return _mm_shuffle_ps(v, v, CGL_SHUFFLE(1, 2, 0, 3));
+    }
+
+    // normalMatrixScalar() with the columns in SSE registers. The w lanes of
+    // the cofactors are c.w * d.w - c.w * d.w = 0, which is the std140
+    // padding. With Stride 3 each column is written with a 4-float store
+    // that spills into the next column (or matrix) unless last is true, so
+    // the matrices must be written in order.
+    template <int Stride> void normalMatrixSSE(const Mat4& M, float* dst, bool last)
+    {
+      const float* m = M;
+      __m128 c0 = _mm_loadu_ps(m), c1 = _mm_loadu_ps(m + 4), c2 = _mm_loadu_ps(m + 8);
+      __m128 s0 = rotateXYZ(c0), s1 = rotateXYZ(c1), s2 = rotateXYZ(c2);
+      __m128 r0 = rotateXYZ(_mm_sub_ps(_mm_mul_ps(c1, s2), _mm_mul_ps(s1, c2)));
+      __m128 r1 = rotateXYZ(_mm_sub_ps(_mm_mul_ps(c2, s0), _mm_mul_ps(s2, c0)));
+      __m128 r2 = rotateXYZ(_mm_sub_ps(_mm_mul_ps(c0, s1), _mm_mul_ps(s0, c1)));
+
+      // (x + z) + (y + w), where w = 0
+      __m128 d = _mm_mul_ps(c0, r0);
+      d = _mm_add_ps(d, _mm_movehl_ps(d, d));
+      d = _mm_add_ps(d, _mm_shuffle_ps(d, d, CGL_SHUFFLE(1, 1, 1, 1)));
+      float det = _mm_cvtss_f32(d);
+      if (!(det < 0 || det > 0)) {
+        normalMatrixScalar<Stride>(M, dst);
+        return;
+      }
+
+      __m128 s = _mm_div_ps(_mm_set1_ps(1.0f), _mm_shuffle_ps(d, d, CGL_SHUFFLE(0, 0, 0, 0)));
+      r0 = _mm_mul_ps(r0, s);
+      r1 = _mm_mul_ps(r1, s);
+      r2 = _mm_mul_ps(r2, s);
+      _mm_storeu_ps(dst, r0);
+      _mm_storeu_ps(dst + Stride, r1);
+      if (Stride == 4 || !last) {
+        _mm_storeu_ps(dst + 2 * Stride, r2);
+      } else {
+        _mm_storel_pi(reinterpret_cast<__m64*>(dst + 6), r2);
+        _mm_store_ss(dst + 8, _mm_movehl_ps(r2, r2));
+      }
+    }
+#endif
+
+    // Normal matrices of M[begin, end).
+    template <int Stride> void normalMatrixRange(const Mat4* M, float* dst, size_t begin, size_t end)
+    {
+      for (size_t i = begin; i < end; ++i) {
+#ifdef CGL_SIMD_SSE
+        normalMatrixSSE<Stride>(M[i], dst + 3 * Stride * i, i + 1 == end);
+#else
+        normalMatrixScalar<Stride>(M[i], dst + 3 * Stride * i);
+#endif
+      }
+    }
+
+    /// Returns the inverse-transpose of the upper 3x3 of M as a Mat4 with no
+    /// translation, so that normals can be transformed as directions.
+    inline Mat4 normalMatrix(const Mat4& M)
+    {
+      const float* m = M;
+      Mat3 N = Mat3(m[0], m[1], m[2], m[4], m[5], m[6], m[8], m[9], m[10]).inverse().transpose();
+      const float* n = N;
+      return Mat4(n[0], n[1], n[2], 0,   n[3], n[4], n[5], 0,   n[6], n[7], n[8], 0,   0, 0, 0, 1);
+    }
+  }
+
+  /// Transforms n points (w = 1) by M without a perspective divide.
+  inline void transformPoints(const Mat4& M, const void* src, size_t srcStride,
+    void* dst, size_t dstStride, size_t n, unsigned threads = 1)
+  {
+    detail::transformStrided<detail::TRANSFORM_POINT>(M, src, srcStride, dst, dstStride, n, threads);
+  }
+
+  /// Transforms n points (w = 1) by M without a perspective divide.
+  inline void transformPoints(const Mat4& M, const Vec3* src, Vec3* dst, size_t n, unsigned threads = 1)
+  {
+    transformPoints(M, src, sizeof(Vec3), dst, sizeof(Vec3), n, threads);
+  }
+
+  /// Transforms n points (w = 1) by M and divides the results by w.
+  inline void projectPoints(const Mat4& M, const void* src, size_t srcStride,
+    void* dst, size_t dstStride, size_t n, unsigned threads = 1)
+  {
+    detail::transformStrided<detail::TRANSFORM_PROJECT>(M, src, srcStride, dst, dstStride, n, threads);
+  }
+
+  /// Transforms n points (w = 1) by M and divides the results by w.
+  inline void projectPoints(const Mat4& M, const Vec3* src, Vec3* dst, size_t n, unsigned threads = 1)
+  {
+    projectPoints(M, src, sizeof(Vec3), dst, sizeof(Vec3), n, threads);
+  }
+
+  /// Transforms n directions (w = 0) by M; translation is ignored.
+  inline void transformDirections(const Mat4& M, const void* src, size_t srcStride,
+    void* dst, size_t dstStride, size_t n, unsigned threads = 1)
+  {
+    detail::transformStrided<detail::TRANSFORM_DIRECTION>(M, src, srcStride, dst, dstStride, n, threads);
+  }
+
+  /// Transforms n directions (w = 0) by M; translation is ignored.
+  inline void transformDirections(const Mat4& M, const Vec3* src, Vec3* dst, size_t n, unsigned threads = 1)
+  {
+    transformDirections(M, src, sizeof(Vec3), dst, sizeof(Vec3), n, threads);
+  }
+
+  /// Transforms n normals by the inverse-transpose of the upper 3x3 of M and
+  /// normalizes the results.
+  inline void transformNormals(const Mat4& M, const void* src, size_t srcStride,
+    void* dst, size_t dstStride, size_t n, unsigned threads = 1)
+  {
+    detail::transformStrided<detail::TRANSFORM_NORMAL>(detail::normalMatrix(M), src, srcStride, dst, dstStride, n, threads);
+  }
+
+  /// Transforms n normals by the inverse-transpose of the upper 3x3 of M and
+  /// normalizes the results.
+  inline void transformNormals(const Mat4& M, const Vec3* src, Vec3* dst, size_t n, unsigned threads = 1)
+  {
+    transformNormals(M, src, sizeof(Vec3), dst, sizeof(Vec3), n, threads);
+  }
+
+  /// A Mat3 laid out as a member of a std140 uniform block: each column is
+  /// padded to four floats (the padding is written as 0).
+  struct Std140Mat3
+  {
+    float m[12];
+  };
+
+  /// Computes the normal matrix (the inverse-transpose of the upper 3x3) of
+  /// each of the n matrices in M, from the cofactors of the upper 3x3 only,
+  /// which is all an affine matrix needs, rather than a full inverse. With
+  /// SSE the three columns are computed together. Singular matrices give the
+  /// identity, like Matrix3::inverse().
+  inline void normalMatrices(const Mat4* M, Mat3* N, size_t n, unsigned threads = 1)
+  {
+    float* dst = reinterpret_cast<float*>(N);
+    parallelFor(n, threads, [=](size_t begin, size_t end) {
+      detail::normalMatrixRange<3>(M, dst, begin, end);
+    });
+  }
+
+  /// Computes normal matrices as above, in the std140 layout for uniform
+  /// buffers.
+  inline void normalMatrices(const Mat4* M, Std140Mat3* N, size_t n, unsigned threads = 1)
+  {
+    float* dst = N->m;
+    parallelFor(n, threads, [=](size_t begin, size_t end) {
+      detail::normalMatrixRange<4>(M, dst, begin, end);
+    });
+  }
+
+  /// Multiplies M with each of the n vectors in src.
+  inline void transform(const Mat4& M, const Vec4* src, Vec4* dst, size_t n, unsigned threads = 1)
+  {
+    parallelFor(n, threads, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i)
+        dst[i] = M * src[i];
+    });
+  }
+
+} // namespace cgl
+
+#endif // CGL_BATCH_TRANSFORM_H_
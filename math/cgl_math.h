@@ -6,30 +6,32 @@
 
 namespace cgl
 {
-  static const float PI          = 3.1415926536f;
-  static const float PI2         = 2.0f * PI;
-  static const float DEG_TO_RAD  = 0.0174532925f;
-  static const float RAD_TO_DEG  = 57.295779513f;
+  constexpr float PI          = 3.1415926536f;
+  constexpr float PI2         = 2.0f * PI;
+  constexpr float DEG_TO_RAD  = 0.0174532925f;
+  constexpr float RAD_TO_DEG  = 57.295779513f;
 }
 
+#include "fast_math.h"
 #include "vector2.h"
 #include "vector3.h"
 #include "vector4.h"
 #include "matrix2.h"
 #include "matrix3.h"
 #include "matrix4.h"
+#include "matrix4_simd.h"
 
 namespace cgl {
   
   /// Returns the value clamped to be in [min, max].
-  template <typename T> T clamp(T value, T min, T max)
+  template <typename T> constexpr T clamp(T value, T min, T max)
   {
     return std::min(std::max(value, min), max);
   }
 
   /// Returns the linear interpolation of a and b given a weight w. Returns a
   /// when w == 0, and b when w == 1; if w is not in [0,1] it extrapolates.
-  template <typename T> T lerp(const T& a, const T& b, float w)
+  template <typename T> constexpr T lerp(const T& a, const T& b, float w)
   {
     return a + (b - a) * w;
   }
@@ -93,31 +95,31 @@ namespace cgl {
   }
   
   /// Creates a translation matrix.
-  inline  Mat4 translation(float x, float y, float z)
+  constexpr Mat4 translation(float x, float y, float z)
   {
     return Mat4(1, 0, 0, 0,   0, 1, 0, 0,   0, 0, 1, 0,   x, y, z, 1);
   }
   
   /// Creates a translation matrix.
-  inline  Mat4 translation(const Vec3& t)
+  constexpr Mat4 translation(const Vec3& t)
   {
     return Mat4(1, 0, 0, 0,   0, 1, 0, 0,   0, 0, 1, 0,   t.x, t.y, t.z, 1);
   }
   
   /// Creates a scale matrix.
-  inline  Mat4 scale(float x, float y, float z)
+  constexpr Mat4 scale(float x, float y, float z)
   {
     return Mat4(x, 0, 0, 0,   0, y, 0, 0,   0, 0, z, 0,   0, 0, 0, 1);
   }
   
   /// Creates a scale matrix.
-  inline Mat4 scale(const Vec3& s)
+  constexpr Mat4 scale(const Vec3& s)
   {
     return Mat4(s.x, 0, 0, 0,   0, s.y, 0, 0,   0, 0, s.z, 0,   0, 0, 0, 1);
   }
   
   /// Creates a perspective projection matrix.
-  inline Mat4 perspective(float left, float right, float bottom, float top, float zNear, float zFar)
+  constexpr Mat4 perspective(float left, float right, float bottom, float top, float zNear, float zFar)
   {
     float w = right - left;
     float h = top - bottom;
@@ -141,7 +143,7 @@ namespace cgl {
   }
   
   /// Creates an orthographic projection matrix.
-  inline Mat4 ortho(float left, float right, float bottom, float top, float zNear, float zFar)
+  constexpr Mat4 ortho(float left, float right, float bottom, float top, float zNear, float zFar)
   {
     float w = right - left;
     float h = top - bottom;
@@ -155,7 +157,7 @@ namespace cgl {
   }
   
   /// Creates a 2D orthographic projection matrix (zNear = -1, zFar = +1).
-  inline Mat4 ortho2D(float left, float right, float bottom, float top)
+  constexpr Mat4 ortho2D(float left, float right, float bottom, float top)
   {
     return ortho(left, right, bottom, top, -1.f, 1.f);
   }
@@ -179,6 +181,13 @@ namespace cgl {
     return lookAt(Vec3(eyeX, eyeY, eyeZ), Vec3(centerX, centerY, centerZ), Vec3(upX, upY, upZ));
   }
 
+  // The builders compose in constant expressions in every build: the SIMD
+  // Mat4 kernels are only called at run time.
+  static_assert((ortho2D(0, 2, 0, 2) * translation(1, 1, 0) * Vec4(0, 0, 0, 1)).x == 0,
+                "Mat4 products must be constexpr");
+  static_assert((translation(1, 2, 3).transpose() * translation(1, 2, 3).inverse().transpose()).trace() == 4,
+                "Mat4 inverse() and transpose() must be constexpr");
+
 } // namespace cgl
 
 #endif
@@ -0,0 +1,160 @@
+#ifndef CGL_DUAL_QUATERNION_H_
+#define CGL_DUAL_QUATERNION_H_
+
+#include <iostream>
+#include "cgl_math.h"
+#include "quaternion.h"
+
+namespace cgl
+{
+  template <typename T> class DualQuaternion;
+  typedef DualQuaternion<float> DualQuat;
+  typedef DualQuaternion<double> DualQuatd;
+
+  /// Dual quaternion real + dual * e (e^2 = 0). Unit dual quaternions represent
+  /// rigid transforms (rotation followed by translation); the real part is the
+  /// rotation and the dual part is translation * real / 2.
+  template <typename T> class DualQuaternion
+  {
+  public:
+
+    /// The real part (rotation).
+    Quaternion<T> real;
+
+    /// The dual part (encodes the translation).
+    Quaternion<T> dual;
+
+    /// Constructs the identity transform.
+    constexpr DualQuaternion<T>() : real(), dual(0, 0, 0, 0) {}
+
+    /// Constructs a dual quaternion from its real and dual parts.
+    constexpr DualQuaternion<T>(const Quaternion<T>& real, const Quaternion<T>& dual)
+      : real(real), dual(dual) {}
+
+    /// Constructs the transform that rotates by r and then translates by t.
+    constexpr DualQuaternion<T>(const Quaternion<T>& r, const Vector3<T>& t)
+      : real(r), dual(Quaternion<T>(t, 0) * r * T(0.5)) {}
+
+    /// Constructs the transform represented by the rigid matrix M (see
+    /// Matrix4::isRigid()).
+    explicit DualQuaternion<T>(const Matrix4<T>& M)
+      : real(M)
+    {
+      const T* m = M;
+      dual = Quaternion<T>(m[12], m[13], m[14], 0) * real * T(0.5);
+    }
+
+    /// Returns the rotation.
+    constexpr const Quaternion<T>& rotation() const
+    {
+      return real;
+    }
+
+    /// Returns the translation (assumes a unit dual quaternion).
+    constexpr Vector3<T> translation() const
+    {
+      return (dual * real.conjugate()).vec() * 2;
+    }
+
+    /// Returns a copy normalized so that the real part has unit length.
+    DualQuaternion<T> normal() const
+    {
+      T s = 1 / real.length();
+      Quaternion<T> r = real * s;
+      Quaternion<T> d = dual * s;
+      // remove the component of the dual part that is not orthogonal to real
+      return DualQuaternion<T>(r, d - r * r.dot(d));
+    }
+
+    /// Normalizes this dual quaternion (see normal()).
+    DualQuaternion<T>& normalize()
+    {
+      return (*this) = normal();
+    }
+
+    /// Returns the inverse of a unit dual quaternion.
+    constexpr DualQuaternion<T> conjugate() const
+    {
+      return DualQuaternion<T>(real.conjugate(), dual.conjugate());
+    }
+
+    /// Transforms the point p (rotation then translation).
+    constexpr Vector3<T> transformPoint(const Vector3<T>& p) const
+    {
+      return real.rotate(p) + translation();
+    }
+
+    /// Transforms the direction v (rotation only).
+    constexpr Vector3<T> transformDirection(const Vector3<T>& v) const
+    {
+      return real.rotate(v);
+    }
+
+    /// Converts the (unit) dual quaternion to a rigid transform matrix.
+    constexpr Matrix4<T> toMat4() const
+    {
+      Matrix4<T> R = real.toMat4();
+      Vector3<T> t = translation();
+      const T* r = R;
+      return Matrix4<T>(r[0], r[1], r[2], 0,
+        r[4], r[5], r[6], 0,
+        r[8], r[9], r[10], 0,
+        t.x, t.y, t.z, 1);
+    }
+
+    /// Component-wise addition (used for blending).
+    constexpr DualQuaternion<T> operator+(const DualQuaternion<T>& q) const
+    {
+      return DualQuaternion<T>(real + q.real, dual + q.dual);
+    }
+
+    /// Multiplies both parts by the scalar s.
+    constexpr DualQuaternion<T> operator*(T s) const
+    {
+      return DualQuaternion<T>(real * s, dual * s);
+    }
+
+    /// Composes the transforms; the result applies q first, then this.
+    constexpr DualQuaternion<T> operator*(const DualQuaternion<T>& q) const
+    {
+      return DualQuaternion<T>(real * q.real, real * q.dual + dual * q.real);
+    }
+
+    /// Returns the identity transform.
+    static constexpr DualQuaternion<T> identity()
+    {
+      return DualQuaternion<T>();
+    }
+
+    /// Prints the dual quaternion to an output stream.
+    friend std::ostream& operator<<(std::ostream& os, const DualQuaternion<T>& q)
+    {
+      return os << q.real << " + e" << q.dual;
+    }
+  };
+
+  /// Dual quaternion linear blending: the normalized weighted sum, taking the
+  /// shorter arc. This is the usual blend for skinning.
+  template <typename T> DualQuaternion<T> nlerp(const DualQuaternion<T>& a, const DualQuaternion<T>& b, T w)
+  {
+    T wb = a.real.dot(b.real) < 0 ? -w : w;
+    return (a * (1 - w) + b * wb).normalize();
+  }
+
+  /// Interpolates the rotation of a and b with slerp and the translation
+  /// linearly. Returns a when w == 0, and b when w == 1.
+  template <typename T> DualQuaternion<T> slerp(const DualQuaternion<T>& a, const DualQuaternion<T>& b, T w)
+  {
+    return DualQuaternion<T>(slerp(a.real, b.real, w), lerp(a.translation(), b.translation(), w));
+  }
+
+  /// Transforms n points by the unit dual quaternion q. The transform is
+  /// expanded to a matrix once, and the points go through the batch kernels.
+  inline void transformPoints(const DualQuat& q, const Vec3* src, Vec3* dst, size_t n, unsigned threads = 1)
+  {
+    transformPoints(q.toMat4(), src, dst, n, threads);
+  }
+
+} // namespace cgl
+
+#endif // CGL_DUAL_QUATERNION_H_
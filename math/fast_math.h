@@ -0,0 +1,93 @@
+#ifndef CGL_FAST_MATH_H_
+#define CGL_FAST_MATH_H_
+
+#include <cstddef>
+#include <cmath>
+#include "simd_float.h"
+
+// Approximate versions of functions that show up in per-vertex and per-frame
+// loops. They have their own names (rsqrtFast, fastSinCos, and the *Fast
+// members of the vector types) so that callers opt in where the error is
+// acceptable; the exact versions are unchanged. The error bounds below were
+// measured with bench/fast_math_bench.cpp.
+
+namespace cgl
+{
+  /// Returns an approximation of 1 / sqrt(x) for positive, finite x with a
+  /// relative error below 3e-7 (exact when SSE is disabled). Zero gives NaN
+  /// rather than infinity.
+  inline float rsqrtFast(float x)
+  {
+    return rsqrt(simd::Float1(x)).v;
+  }
+
+  /// Returns 1 / sqrt(x); double precision has no fast path.
+  inline double rsqrtFast(double x)
+  {
+    return 1.0 / std::sqrt(x);
+  }
+
+  namespace detail
+  {
+    // Computes sin(x) and cos(x) in the lanes of P. x is reduced to
+    // t = x - k * pi / 2 with |t| <= pi / 4, and sin(t) and cos(t) are
+    // evaluated with the minimax polynomials of the Cephes library. The
+    // result is rotated by the quadrant j = k mod 4, written as sums of
+    // products with sin(j * pi / 2) and cos(j * pi / 2) so that no lane
+    // needs a branch.
+    template <typename P> void sinCos(P x, P* sine, P* cosine)
+    {
+      // adding and subtracting 1.5 * 2^23 rounds to the nearest integer
+      const P magic(12582912.0f);
+      P k = (x * P(0.636619772f) + magic) - magic;
+      P j = k - P(4.0f) * ((k * P(0.25f) + magic) - magic);
+
+      // pi / 2 in three parts; k times the first part is exact for |k| < 2^16
+      P t = x - k * P(1.5703125f);
+      t = t - k * P(4.837512969970703125e-4f);
+      t = t - k * P(7.54978995489188216e-8f);
+
+      P z = t * t;
+      P s = t + t * z * ((P(-1.9515295891e-4f) * z + P(8.3321608736e-3f)) * z + P(-1.6666654611e-1f));
+      P c = P(1.0f) - P(0.5f) * z +
+        z * z * ((P(2.443315711809948e-5f) * z + P(-1.388731625493765e-3f)) * z + P(4.166664568298827e-2f));
+
+      // j is in [-2, 2]; these are exactly 0, 1 or -1
+      P j2 = j * j;
+      P sj = j * (P(4.0f) - j2) * P(1.0f / 3.0f);
+      P cj = (P(6.0f) - P(7.0f) * j2 + j2 * j2) * P(1.0f / 6.0f);
+      *sine = sj * c + cj * s;
+      *cosine = cj * c - sj * s;
+    }
+  }
+
+  /// Computes approximations of sin(radians) and cos(radians). The absolute
+  /// error is below 1e-7 for |radians| <= 8192 and below 2e-6 up to 65536;
+  /// past that the argument reduction loses precision quickly.
+  inline void fastSinCos(float radians, float* sine, float* cosine)
+  {
+    simd::Float1 s, c;
+    detail::sinCos(simd::Float1(radians), &s, &c);
+    *sine = s.v;
+    *cosine = c.v;
+  }
+
+  /// Computes fastSinCos() of n angles. The results are identical to the
+  /// single-value version.
+  inline void fastSinCos(const float* radians, float* sines, float* cosines, size_t n)
+  {
+    typedef simd::FloatN P;
+    size_t blocks = n / P::width;
+    for (size_t b = 0; b < blocks; ++b) {
+      P s, c;
+      detail::sinCos(P::load(radians + b * P::width), &s, &c);
+      s.store(sines + b * P::width);
+      c.store(cosines + b * P::width);
+    }
+    for (size_t i = blocks * P::width; i < n; ++i)
+      fastSinCos(radians[i], sines + i, cosines + i);
+  }
+
+} // namespace cgl
+
+#endif // CGL_FAST_MATH_H_
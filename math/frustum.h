@@ -0,0 +1,280 @@
+#ifndef CGL_FRUSTUM_H_
+#define CGL_FRUSTUM_H_
+
+#include <cstddef>
+#include <stdint.h>
+#include "cgl_math.h"
+#include "simd_float.h"
+#include "vector_array.h"
+
+namespace cgl
+{
+  namespace detail
+  {
+    /// Calls emit(i, bits) for each group of up to 32 objects starting at
+    /// index i, where bit k of bits is set if object i + k is visible.
+    /// Objects are spheres (center, radius) or boxes (min, max) in SoA form.
+    template <typename P, typename F>
+    size_t cullRange(const Vec4* planes, const float* const* a, const float* const* b,
+      bool boxes, size_t i, size_t n, F& emit)
+    {
+      // for boxes, the corner furthest along each plane normal decides
+      const float* px[6];
+      const float* py[6];
+      const float* pz[6];
+      P nx[6], ny[6], nz[6], d[6];
+      for (int k = 0; k < 6; ++k) {
+        const Vec4& p = planes[k];
+        px[k] = (boxes && p.x >= 0) ? b[0] : a[0];
+        py[k] = (boxes && p.y >= 0) ? b[1] : a[1];
+        pz[k] = (boxes && p.z >= 0) ? b[2] : a[2];
+        nx[k] = P(p.x);
+        ny[k] = P(p.y);
+        nz[k] = P(p.z);
+        d[k] = P(p.w);
+      }
+
+      P zero(0.f);
+      for (; i + P::width <= n; i += P::width) {
+        // signed distance of the sphere surface / nearest-to-inside corner
+        P dist = boxes ? d[0] : d[0] + P::load(b[0] + i);
+        dist = dist + nx[0] * P::load(px[0] + i) + ny[0] * P::load(py[0] + i) + nz[0] * P::load(pz[0] + i);
+        for (int k = 1; k < 6; ++k) {
+          P dk = boxes ? d[k] : d[k] + P::load(b[0] + i);
+          dk = dk + nx[k] * P::load(px[k] + i) + ny[k] * P::load(py[k] + i) + nz[k] * P::load(pz[k] + i);
+          dist = min(dist, dk);
+        }
+        int culled = lessMask(dist, zero);
+        emit(i, static_cast<uint32_t>(~culled & ((1 << P::width) - 1)));
+      }
+      return i;
+    }
+
+    template <typename F>
+    void cullArrays(const Vec4* planes, const float* const* a, const float* const* b,
+      bool boxes, size_t n, F& emit)
+    {
+      size_t i = cullRange<simd::FloatN>(planes, a, b, boxes, 0, n, emit);
+      cullRange<simd::Float1>(planes, a, b, boxes, i, n, emit);
+    }
+
+    /// Converts interleaved objects to SoA form in blocks, then culls them.
+    template <typename F>
+    void cullInterleaved(const Vec4* planes, const float* a, size_t aStride, const float* b,
+      size_t bStride, int bComponents, bool boxes, size_t n, F& emit)
+    {
+      const size_t block = 256;
+      float soa[6][block];
+      const float* pa[3] = { soa[0], soa[1], soa[2] };
+      const float* pb[3] = { soa[3], soa[4], soa[5] };
+      for (size_t begin = 0; begin < n; begin += block) {
+        size_t count = std::min(block, n - begin);
+        for (size_t j = 0; j < count; ++j) {
+          const float* va = a + (begin + j) * aStride;
+          const float* vb = b + (begin + j) * bStride;
+          for (int c = 0; c < 3; ++c)
+            soa[c][j] = va[c];
+          for (int c = 0; c < bComponents; ++c)
+            soa[3 + c][j] = vb[c];
+        }
+        struct Offset
+        {
+          F& emit;
+          size_t begin;
+          void operator()(size_t i, uint32_t bits) { emit(begin + i, bits); }
+        } offset = { emit, begin };
+        cullArrays(planes, pa, pb, boxes, count, offset);
+      }
+    }
+
+    /// Sets the bits of visible objects in a bit mask.
+    struct CullMask
+    {
+      uint32_t* mask;
+
+      void operator()(size_t i, uint32_t bits)
+      {
+        // packets are at most 32 wide and start at multiples of their width,
+        // so they never straddle two words
+        mask[i / 32] |= bits << (i % 32);
+      }
+    };
+
+    /// Appends the indices of visible objects to a list.
+    struct CullIndices
+    {
+      uint32_t* indices;
+      size_t count;
+
+      void operator()(size_t i, uint32_t bits)
+      {
+        for (uint32_t k = 0; bits; ++k, bits >>= 1)
+          if (bits & 1)
+            indices[count++] = static_cast<uint32_t>(i + k);
+      }
+    };
+  }
+
+  /// View frustum as six planes (a, b, c, d) with a*x + b*y + c*z + d >= 0
+  /// inside. The planes are normalized so that plane distances are in world
+  /// units.
+  ///
+  /// The batch functions test many bounding volumes at once, 8 (AVX) or 4
+  /// (SSE) per instruction. They report the visible ones either as a bit mask
+  /// (bit i % 32 of word i / 32 set if object i is visible; the mask must
+  /// have room for (n + 31) / 32 words) or as a compacted list of visible
+  /// indices (returning the count; the list must have room for n indices).
+  /// The tests are conservative: a box that is outside the frustum but not
+  /// entirely outside any single plane (near a frustum corner) is reported
+  /// visible.
+  class Frustum
+  {
+  public:
+
+    /// The order of the planes.
+    enum Plane { LEFT_PLANE, RIGHT_PLANE, BOTTOM_PLANE, TOP_PLANE, NEAR_PLANE, FAR_PLANE };
+
+    /// Constructs a frustum that contains everything.
+    Frustum()
+    {
+      for (int i = 0; i < 6; ++i)
+        planes_[i] = Vec4(0, 0, 0, 1);
+    }
+
+    /// Extracts the planes from a view-projection matrix (projection * view);
+    /// the planes are then in world coordinates. Pass projection * view *
+    /// model to get them in object coordinates instead.
+    explicit Frustum(const Mat4& viewProjection)
+    {
+      const float* m = viewProjection;
+      Vec4 row0(m[0], m[4], m[8], m[12]);
+      Vec4 row1(m[1], m[5], m[9], m[13]);
+      Vec4 row2(m[2], m[6], m[10], m[14]);
+      Vec4 row3(m[3], m[7], m[11], m[15]);
+      planes_[LEFT_PLANE] = row3 + row0;
+      planes_[RIGHT_PLANE] = row3 - row0;
+      planes_[BOTTOM_PLANE] = row3 + row1;
+      planes_[TOP_PLANE] = row3 - row1;
+      planes_[NEAR_PLANE] = row3 + row2;
+      planes_[FAR_PLANE] = row3 - row2;
+      for (int i = 0; i < 6; ++i) {
+        Vec4& p = planes_[i];
+        p /= Vec3(p.x, p.y, p.z).length();
+      }
+    }
+
+    /// Returns one of the planes (see Plane).
+    const Vec4& plane(int i) const
+    {
+      return planes_[i];
+    }
+
+    /// Returns true if the sphere is at least partially inside.
+    bool intersectsSphere(const Vec3& center, float radius) const
+    {
+      for (int i = 0; i < 6; ++i) {
+        const Vec4& p = planes_[i];
+        if (p.x * center.x + p.y * center.y + p.z * center.z + p.w + radius < 0)
+          return false;
+      }
+      return true;
+    }
+
+    /// Returns true if the axis-aligned box is (possibly) at least partially
+    /// inside.
+    bool intersectsBox(const Vec3& min, const Vec3& max) const
+    {
+      for (int i = 0; i < 6; ++i) {
+        const Vec4& p = planes_[i];
+        float x = p.x >= 0 ? max.x : min.x;
+        float y = p.y >= 0 ? max.y : min.y;
+        float z = p.z >= 0 ? max.z : min.z;
+        if (p.x * x + p.y * y + p.z * z + p.w < 0)
+          return false;
+      }
+      return true;
+    }
+
+    /// Tests n spheres given as (center, radius) and writes a visibility bit mask.
+    void sphereMask(const Vec4* spheres, size_t n, uint32_t* mask) const
+    {
+      detail::CullMask emit = { clear(mask, n) };
+      detail::cullInterleaved(planes_, &spheres->x, 4, &spheres->w, 4, 1, false, n, emit);
+    }
+
+    /// Tests n spheres given as (center, radius) and writes the visible indices.
+    size_t visibleSpheres(const Vec4* spheres, size_t n, uint32_t* indices) const
+    {
+      detail::CullIndices emit = { indices, 0 };
+      detail::cullInterleaved(planes_, &spheres->x, 4, &spheres->w, 4, 1, false, n, emit);
+      return emit.count;
+    }
+
+    /// Tests spheres given as separate center and radius arrays and writes a
+    /// visibility bit mask.
+    void sphereMask(const Vec3Array& centers, const float* radii, uint32_t* mask) const
+    {
+      detail::ConstComponentPointers<3> c(centers);
+      const float* r[1] = { radii };
+      detail::CullMask emit = { clear(mask, centers.size()) };
+      detail::cullArrays(planes_, c.p, r, false, centers.size(), emit);
+    }
+
+    /// Tests spheres given as separate center and radius arrays and writes the
+    /// visible indices.
+    size_t visibleSpheres(const Vec3Array& centers, const float* radii, uint32_t* indices) const
+    {
+      detail::ConstComponentPointers<3> c(centers);
+      const float* r[1] = { radii };
+      detail::CullIndices emit = { indices, 0 };
+      detail::cullArrays(planes_, c.p, r, false, centers.size(), emit);
+      return emit.count;
+    }
+
+    /// Tests n axis-aligned boxes and writes a visibility bit mask.
+    void boxMask(const Vec3* mins, const Vec3* maxs, size_t n, uint32_t* mask) const
+    {
+      detail::CullMask emit = { clear(mask, n) };
+      detail::cullInterleaved(planes_, &mins->x, 3, &maxs->x, 3, 3, true, n, emit);
+    }
+
+    /// Tests n axis-aligned boxes and writes the visible indices.
+    size_t visibleBoxes(const Vec3* mins, const Vec3* maxs, size_t n, uint32_t* indices) const
+    {
+      detail::CullIndices emit = { indices, 0 };
+      detail::cullInterleaved(planes_, &mins->x, 3, &maxs->x, 3, 3, true, n, emit);
+      return emit.count;
+    }
+
+    /// Tests axis-aligned boxes given as min and max arrays and writes a
+    /// visibility bit mask.
+    void boxMask(const Vec3Array& mins, const Vec3Array& maxs, uint32_t* mask) const
+    {
+      detail::ConstComponentPointers<3> lo(mins), hi(maxs);
+      detail::CullMask emit = { clear(mask, mins.size()) };
+      detail::cullArrays(planes_, lo.p, hi.p, true, mins.size(), emit);
+    }
+
+    /// Tests axis-aligned boxes given as min and max arrays and writes the
+    /// visible indices.
+    size_t visibleBoxes(const Vec3Array& mins, const Vec3Array& maxs, uint32_t* indices) const
+    {
+      detail::ConstComponentPointers<3> lo(mins), hi(maxs);
+      detail::CullIndices emit = { indices, 0 };
+      detail::cullArrays(planes_, lo.p, hi.p, true, mins.size(), emit);
+      return emit.count;
+    }
+
+  private:
+    Vec4 planes_[6];
+
+    static uint32_t* clear(uint32_t* mask, size_t n)
+    {
+      std::fill(mask, mask + (n + 31) / 32, 0u);
+      return mask;
+    }
+  };
+
+} // namespace cgl
+
+#endif // CGL_FRUSTUM_H_
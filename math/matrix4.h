@@ -3,7 +3,9 @@
 
 #include <iostream>
 #include <iomanip>
+#include <type_traits>
 #include "cgl_math.h"
+#include "simd.h"
 
 namespace cgl
 {
@@ -21,109 +23,78 @@ namespace cgl
   {
     T m[16];
 
+    // Matrix4<float> has SIMD kernels for the products, transpose and
+    // inverses when SSE is enabled. The constexpr functions below call them
+    // except at compile time, where intrinsics cannot be evaluated.
+#ifdef CGL_SIMD_SSE
+    static constexpr bool simd = std::is_same<T, float>::value;
+#else
+    static constexpr bool simd = false;
+#endif
+
+    // The kernels, specialized for float in matrix4_simd.h; the generic
+    // versions are never called.
+    Vector4<T> multiplySimd(const Vector4<T>& v) const { return v; }
+    Matrix4<T> multiplySimd(const Matrix4<T>& B) const { return B; }
+    Matrix4<T> transposeSimd() const { return *this; }
+    Matrix4<T> inverseSimd() const { return *this; }
+    Matrix4<T> inverseAffineSimd() const { return *this; }
+    Matrix4<T> inverseRigidSimd() const { return *this; }
+
   public:
 
     /// Constructs a new identity matrix.
-    Matrix4<T>()
-    {
-      for (int i = 0; i < 16; ++i)
-        m[i] = 0;
-      m[0] = m[5] = m[10] = m[15] = 1;
-    }
+    constexpr Matrix4<T>() : m{1, 0, 0, 0,   0, 1, 0, 0,   0, 0, 1, 0,   0, 0, 0, 1} {}
 
     /// Constructs a new matrix given the column vectors (a,b,c,d), (e,f,g,h),
     /// (i, j, k, l), and (m, n, o, p).
-    Matrix4<T>(T a, T b, T c, T d,
+    constexpr Matrix4<T>(T a, T b, T c, T d,
       T e, T f, T g, T h,
       T i, T j, T k, T l,
       T m, T n, T o, T p)
-    {
-      this->m[0] = a;
-      this->m[1] = b;
-      this->m[2] = c;
-      this->m[3] = d;
-
-      this->m[4] = e;
-      this->m[5] = f;
-      this->m[6] = g;
-      this->m[7] = h;
-
-      this->m[8] = i;
-      this->m[9] = j;
-      this->m[10] = k;
-      this->m[11] = l;
-
-      this->m[12] = m;
-      this->m[13] = n;
-      this->m[14] = o;
-      this->m[15] = p;
-    }
+      : m{a, b, c, d,   e, f, g, h,   i, j, k, l,   m, n, o, p} {}
 
     /// Constructs a new matrix given the column vectors x, y, z, and w.
-    Matrix4<T>(const Vector4<T>& x, const Vector4<T>& y, const Vector4<T>& z,
+    constexpr Matrix4<T>(const Vector4<T>& x, const Vector4<T>& y, const Vector4<T>& z,
       const Vector4<T>& w)
-    {
-      m[0] = x.x;
-      m[1] = x.y;
-      m[2] = x.z;
-      m[3] = x.w;
-
-      m[4] = y.x;
-      m[5] = y.y;
-      m[6] = y.z;
-      m[7] = y.w;
-
-      m[8] = z.x;
-      m[9] = z.y;
-      m[10] = z.z;
-      m[11] = z.w;
-
-      m[12] = w.x;
-      m[13] = w.y;
-      m[14] = w.z;
-      m[15] = w.w;
-    }
+      : m{x.x, x.y, x.z, x.w,   y.x, y.y, y.z, y.w,   z.x, z.y, z.z, z.w,   w.x, w.y, w.z, w.w} {}
 
     /// Constructs a new matrix by copying the values in an array.
-    Matrix4<T>(const T* a)
+    constexpr Matrix4<T>(const T* a) : m()
     {
       for (int i = 0; i < 16; ++i)
         m[i] = a[i];
     }
 
     /// Constructs a copy of the matrix B.
-    Matrix4<T>(const Matrix4<T>& B)
-    {
-      for (int i = 0; i < 16; ++i)
-        m[i] = B.m[i];
-    }
+    Matrix4<T>(const Matrix4<T>& B) = default;
 
     /// Returns a copy of the row vector at index i.
-    Vector4<T> row(int i) const
+    constexpr Vector4<T> row(int i) const
     {
       return Vector4<T>(m[i], m[i+4], m[i+8], m[i+12]);
     }
 
     /// Returns a copy of the column vector at index i.
-    Vector4<T> col(int i) const
+    constexpr Vector4<T> col(int i) const
     {
       int j = i * 4;
       return Vector4<T>(m[j], m[j+1], m[j+2], m[j+3]);
     }
 
     /// Computes the sum of the diagonal.
-    T trace() const
+    constexpr T trace() const
     {
       return m[0] + m[5] + m[10] + m[15];
     }
 
     /// Computes the inverse of the matrix; returns identity if none exists.
-    Matrix4<T> inverse() const
+    constexpr Matrix4<T> inverse() const
     {
+      if (simd && !CGL_IS_CONSTANT_EVALUATED())
+        return inverseSimd();
       // adapted from MESA implementation of gluInvertMatrix
-      T invOut[16];
-      T inv[16], det;
-      int i;
+      T inv[16] = {};
 
       inv[0] = m[5]  * m[10] * m[15] -
         m[5]  * m[11] * m[14] -
@@ -237,22 +208,114 @@ namespace cgl
         m[8] * m[1] * m[6] -
         m[8] * m[2] * m[5];
 
-      det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+      T det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
 
       if (det == 0)
         return Matrix4<T>();
 
       det = 1.0 / det;
 
-      for (i = 0; i < 16; i++)
-        invOut[i] = inv[i] * det;
+      for (int i = 0; i < 16; i++)
+        inv[i] *= det;
 
-      return Matrix4<T>(invOut);
+      return Matrix4<T>(inv);
+    }
+
+    /// Returns true if the bottom row is exactly (0, 0, 0, 1).
+    constexpr bool isAffine() const
+    {
+      return m[3] == 0 && m[7] == 0 && m[11] == 0 && m[15] == 1;
+    }
+
+    /// Returns true if the matrix is affine and its upper 3x3 is orthonormal
+    /// (a rotation or reflection) within epsilon.
+    bool isRigid(T epsilon = T(1e-5)) const
+    {
+      // the entries of R^T R - I, which is zero for an orthonormal R
+      T d[6] = {
+        m[0] * m[0] + m[1] * m[1] + m[2] * m[2] - 1,
+        m[4] * m[4] + m[5] * m[5] + m[6] * m[6] - 1,
+        m[8] * m[8] + m[9] * m[9] + m[10] * m[10] - 1,
+        m[0] * m[4] + m[1] * m[5] + m[2] * m[6],
+        m[0] * m[8] + m[1] * m[9] + m[2] * m[10],
+        m[4] * m[8] + m[5] * m[9] + m[6] * m[10]
+      };
+      T e = 0;
+      for (int i = 0; i < 6; ++i)
+        e = std::max(e, std::abs(d[i]));
+      return e <= epsilon && isAffine();
+    }
+
+    /// Computes the inverse of an affine matrix (see isAffine()) from the
+    /// inverse of its upper 3x3; returns identity if none exists. The result
+    /// is undefined if the matrix is not affine.
+    constexpr Matrix4<T> inverseAffine() const
+    {
+      if (simd && !CGL_IS_CONSTANT_EVALUATED())
+        return inverseAffineSimd();
+      // cofactors of the upper 3x3
+      T a = m[5] * m[10] - m[6] * m[9];
+      T b = m[2] * m[9] - m[1] * m[10];
+      T c = m[1] * m[6] - m[2] * m[5];
+      T det = m[0] * a + m[4] * b + m[8] * c;
+      if (det == 0)
+        return Matrix4<T>();
+
+      T s = 1 / det;
+      T r[9] = {
+        a * s,
+        b * s,
+        c * s,
+        (m[6] * m[8] - m[4] * m[10]) * s,
+        (m[0] * m[10] - m[2] * m[8]) * s,
+        (m[2] * m[4] - m[0] * m[6]) * s,
+        (m[4] * m[9] - m[5] * m[8]) * s,
+        (m[1] * m[8] - m[0] * m[9]) * s,
+        (m[0] * m[5] - m[1] * m[4]) * s
+      };
+
+      T x = m[12], y = m[13], z = m[14];
+      return Matrix4<T>(r[0], r[1], r[2], 0,
+        r[3], r[4], r[5], 0,
+        r[6], r[7], r[8], 0,
+        -(r[0] * x + r[3] * y + r[6] * z),
+        -(r[1] * x + r[4] * y + r[7] * z),
+        -(r[2] * x + r[5] * y + r[8] * z),
+        1);
+    }
+
+    /// Computes the inverse of a rigid-body matrix (see isRigid()) by
+    /// transposing the rotation. The result is undefined if the matrix is not
+    /// rigid.
+    constexpr Matrix4<T> inverseRigid() const
+    {
+      if (simd && !CGL_IS_CONSTANT_EVALUATED())
+        return inverseRigidSimd();
+      T x = m[12], y = m[13], z = m[14];
+      return Matrix4<T>(m[0], m[4], m[8], 0,
+        m[1], m[5], m[9], 0,
+        m[2], m[6], m[10], 0,
+        -(m[0] * x + m[1] * y + m[2] * z),
+        -(m[4] * x + m[5] * y + m[6] * z),
+        -(m[8] * x + m[9] * y + m[10] * z),
+        1);
+    }
+
+    /// Computes the inverse with inverseAffine() if the matrix is affine, or
+    /// with the general inverse() otherwise. Returns identity if none exists.
+    /// Testing for a rigid matrix costs about as much as the affine inverse
+    /// itself, so call inverseRigid() directly when the matrix is known to be
+    /// rigid.
+    constexpr Matrix4<T> inverseFast() const
+    {
+      return isAffine() ? inverseAffine() : inverse();
     }
 
     /// Computes the transpose of the matrix.
-    Matrix4<T> transpose() const
+    constexpr Matrix4<T> transpose() const
     {
+      if (simd && !CGL_IS_CONSTANT_EVALUATED())
+        return transposeSimd();
       return Matrix4<T>(m[0], m[4], m[8], m[12],
         m[1], m[5], m[9], m[13],
         m[2], m[6], m[10], m[14],
@@ -260,28 +323,40 @@ namespace cgl
     }
 
     /// Converts the matrix to an array.
-    operator const T*() const
+    constexpr operator const T*() const
     {
       return m;
     }
 
     /// Multiplies this matrix with a column vector v.
-    Vector4<T> operator*(const Vector4<T>& v) const
+    constexpr Vector4<T> operator*(const Vector4<T>& v) const
     {
-      return Vector4<T>(row(0).dot(v), row(1).dot(v), row(2).dot(v), row(3).dot(v));
+      if (simd && !CGL_IS_CONSTANT_EVALUATED())
+        return multiplySimd(v);
+      return Vector4<T>(m[0] * v.x + m[4] * v.y + m[8] * v.z + m[12] * v.w,
+        m[1] * v.x + m[5] * v.y + m[9] * v.z + m[13] * v.w,
+        m[2] * v.x + m[6] * v.y + m[10] * v.z + m[14] * v.w,
+        m[3] * v.x + m[7] * v.y + m[11] * v.z + m[15] * v.w);
     }
 
     /// Multiplies this matrix with another matrix B.
-    Matrix4<T> operator*(const Matrix4<T>& B) const
+    constexpr Matrix4<T> operator*(const Matrix4<T>& B) const
     {
-      return Matrix4<T>((*this) * B.col(0),
-        (*this) * B.col(1),
-        (*this) * B.col(2),
-        (*this) * B.col(3));
+      if (simd && !CGL_IS_CONSTANT_EVALUATED())
+        return multiplySimd(B);
+      // each product is summed in the same order as row(i).dot(B.col(j)), so
+      // the result matches the vector formulation exactly
+      T r[16] = {};
+      for (int j = 0; j < 16; j += 4) {
+        const T* b = B.m + j;
+        for (int i = 0; i < 4; ++i)
+          r[j + i] = m[i] * b[0] + m[i + 4] * b[1] + m[i + 8] * b[2] + m[i + 12] * b[3];
+      }
+      return Matrix4<T>(r);
     }
 
     /// Multiplies this matrix by a scalar.
-    Matrix4<T> operator*(T s) const
+    constexpr Matrix4<T> operator*(T s) const
     {
       return Matrix4<T>(m[0] * s, m[1] * s, m[2] * s, m[3] * s,
         m[4] * s, m[5] * s, m[6] * s, m[7] * s,
@@ -290,7 +365,7 @@ namespace cgl
     }
 
     /// Adds the matrix B to this matrix.
-    Matrix4<T> operator+(const Matrix4<T>& B) const
+    constexpr Matrix4<T> operator+(const Matrix4<T>& B) const
     {
       return Matrix4<T>(col(0) + B.col(0),
         col(1) + B.col(1),
@@ -309,6 +384,18 @@ namespace cgl
     }
   };
 
+#ifdef CGL_SIMD_SSE
+  // The SIMD kernels, defined in matrix4_simd.h. cgl_math.h includes it once
+  // Vector4 is complete; declaring them here keeps earlier uses from
+  // instantiating the generic versions.
+  template <> inline Vector4<float> Matrix4<float>::multiplySimd(const Vector4<float>& v) const;
+  template <> inline Matrix4<float> Matrix4<float>::multiplySimd(const Matrix4<float>& B) const;
+  template <> inline Matrix4<float> Matrix4<float>::transposeSimd() const;
+  template <> inline Matrix4<float> Matrix4<float>::inverseSimd() const;
+  template <> inline Matrix4<float> Matrix4<float>::inverseAffineSimd() const;
+  template <> inline Matrix4<float> Matrix4<float>::inverseRigidSimd() const;
+#endif
+
 } // namespace cgl
 
 #endif
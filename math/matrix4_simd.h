@@ -0,0 +1,273 @@
+#ifndef CGL_MATRIX4_SIMD_H_
+#define CGL_MATRIX4_SIMD_H_
+
+// SIMD kernels for the Matrix4<float> products, transpose and inverses. The
+// implementation is chosen at compile time (see simd.h); without SSE the
+// generic templates in matrix4.h are the scalar fallback. The intrinsics
+// cannot be evaluated at compile time, so the constexpr functions in matrix4.h
+// call these kernels only at run time and use their scalar code in constant
+// expressions (see CGL_IS_CONSTANT_EVALUATED). A Mat4 composed from the
+// builders in cgl_math.h therefore folds at compile time in every build.
+//
+// Accuracy relative to the scalar templates:
+//
+//   operator*(Vector4)  : identical (0 ULP); the products are summed in the same
+//   operator*(Matrix4)    order as the scalar code. This holds as long as the
+//                         compiler does not contract the scalar code into FMAs.
+//   transpose()         : identical (pure data movement).
+//   inverse()           : block-wise 2x2 adjugate method instead of the full
+//                         cofactor expansion, so the results differ from the
+//                         scalar path. Neither is exact: the error of both
+//                         grows with the condition number, and the SIMD error
+//                         is about the same at the 99th percentile but up to
+//                         ~1.5x larger in the worst case. Measured on 1e6
+//                         random matrices (entries in [-1, 1]) against a double
+//                         inverse, in ULP of the largest element of the
+//                         inverse, by 1-norm condition number:
+//
+//                           condition      SIMD p99 / max    scalar p99 / max
+//                           <= 20            3.7 / 14           4.0 / 19
+//                           <= 100           9.3 / 128          9.5 / 86
+//                           <= 1e3          28 / 1145          29 / 753
+//
+//                         SIMD and scalar results differ from each other by
+//                         up to 29, 214 and 1220 ULP in the same ranges.
+//                         Singular matrices still return identity.
+//                         A constant-evaluated inverse() takes the scalar
+//                         path, so it can differ from the same call at run
+//                         time by these amounts.
+//   inverseAffine()     : 3x3 inverse from column cross products; matches the
+//   inverseRigid()        scalar result within a few ULP of the largest
+//                         element. Both assume the bottom row is (0, 0, 0, 1).
+
+#include "cgl_math.h"
+#include "simd.h"
+
+#ifdef CGL_SIMD_SSE
+
+namespace cgl
+{
+  namespace simd
+  {
+    /// Linear combination of the columns a0..a3 weighted by the lanes of b.
+    inline __m128 combine(__m128 a0, __m128 a1, __m128 a2, __m128 a3, __m128 b)
+    {
+      __m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(b, b, CGL_SHUFFLE(0, 0, 0, 0)));
+      r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(b, b, CGL_SHUFFLE(1, 1, 1, 1))));
+      r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(b, b, CGL_SHUFFLE(2, 2, 2, 2))));
+      r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(b, b, CGL_SHUFFLE(3, 3, 3, 3))));
+      return r;
+    }
+
+    /// 2x2 matrix product A * B (each 2x2 packed as a b c d in one register).
+    inline __m128 mat2Mul(__m128 a, __m128 b)
+    {
+      return _mm_add_ps(
+        _mm_mul_ps(a, _mm_shuffle_ps(b, b, CGL_SHUFFLE(0, 3, 0, 3))),
+        _mm_mul_ps(_mm_shuffle_ps(a, a, CGL_SHUFFLE(1, 0, 3, 2)),
+                   _mm_shuffle_ps(b, b, CGL_SHUFFLE(2, 1, 2, 1))));
+    }
+
+    /// 2x2 matrix product adj(A) * B.
+    inline __m128 mat2AdjMul(__m128 a, __m128 b)
+    {
+      return _mm_sub_ps(
+        _mm_mul_ps(_mm_shuffle_ps(a, a, CGL_SHUFFLE(3, 3, 0, 0)), b),
+        _mm_mul_ps(_mm_shuffle_ps(a, a, CGL_SHUFFLE(1, 1, 2, 2)),
+                   _mm_shuffle_ps(b, b, CGL_SHUFFLE(2, 3, 0, 1))));
+    }
+
+    /// 2x2 matrix product A * adj(B).
+    inline __m128 mat2MulAdj(__m128 a, __m128 b)
+    {
+      return _mm_sub_ps(
+        _mm_mul_ps(a, _mm_shuffle_ps(b, b, CGL_SHUFFLE(3, 0, 3, 0))),
+        _mm_mul_ps(_mm_shuffle_ps(a, a, CGL_SHUFFLE(1, 0, 3, 2)),
+                   _mm_shuffle_ps(b, b, CGL_SHUFFLE(2, 1, 2, 1))));
+    }
+  }
+
+  template <> inline Vector4<float> Matrix4<float>::multiplySimd(const Vector4<float>& v) const
+  {
+    float r[4];
+    _mm_storeu_ps(r, simd::combine(_mm_loadu_ps(m), _mm_loadu_ps(m + 4),
+      _mm_loadu_ps(m + 8), _mm_loadu_ps(m + 12), _mm_loadu_ps(&v.x)));
+    return Vector4<float>(r);
+  }
+
+  template <> inline Matrix4<float> Matrix4<float>::multiplySimd(const Matrix4<float>& B) const
+  {
+    Matrix4<float> R;
+#ifdef CGL_SIMD_AVX
+    // two result columns per iteration; each 128-bit lane holds one column
+    __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m));
+    __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 4));
+    __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 8));
+    __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 12));
+    for (int j = 0; j < 16; j += 8) {
+      __m256 b = _mm256_loadu_ps(B.m + j);
+      __m256 r = _mm256_mul_ps(a0, _mm256_shuffle_ps(b, b, CGL_SHUFFLE(0, 0, 0, 0)));
+      r = _mm256_add_ps(r, _mm256_mul_ps(a1, _mm256_shuffle_ps(b, b, CGL_SHUFFLE(1, 1, 1, 1))));
+      r = _mm256_add_ps(r, _mm256_mul_ps(a2, _mm256_shuffle_ps(b, b, CGL_SHUFFLE(2, 2, 2, 2))));
+      r = _mm256_add_ps(r, _mm256_mul_ps(a3, _mm256_shuffle_ps(b, b, CGL_SHUFFLE(3, 3, 3, 3))));
+      _mm256_storeu_ps(R.m + j, r);
+    }
+#else
+    __m128 a0 = _mm_loadu_ps(m);
+    __m128 a1 = _mm_loadu_ps(m + 4);
+    __m128 a2 = _mm_loadu_ps(m + 8);
+    __m128 a3 = _mm_loadu_ps(m + 12);
+    for (int j = 0; j < 16; j += 4)
+      _mm_storeu_ps(R.m + j, simd::combine(a0, a1, a2, a3, _mm_loadu_ps(B.m + j)));
+#endif
+    return R;
+  }
+
+  template <> inline Matrix4<float> Matrix4<float>::transposeSimd() const
+  {
+    __m128 c0 = _mm_loadu_ps(m);
+    __m128 c1 = _mm_loadu_ps(m + 4);
+    __m128 c2 = _mm_loadu_ps(m + 8);
+    __m128 c3 = _mm_loadu_ps(m + 12);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    Matrix4<float> R;
+    _mm_storeu_ps(R.m, c0);
+    _mm_storeu_ps(R.m + 4, c1);
+    _mm_storeu_ps(R.m + 8, c2);
+    _mm_storeu_ps(R.m + 12, c3);
+    return R;
+  }
+
+  template <> inline Matrix4<float> Matrix4<float>::inverseSimd() const
+  {
+    // Block inverse with 2x2 sub-matrices:
+    //
+    //   M = | A B |   inv(M) = 1/|M| * | X Y |
+    //       | C D |                    | Z W |
+    //
+    // The routine is written for rows; feeding it columns yields the rows of
+    // inv(M)^T, which are exactly the columns of inv(M).
+    __m128 c0 = _mm_loadu_ps(m);
+    __m128 c1 = _mm_loadu_ps(m + 4);
+    __m128 c2 = _mm_loadu_ps(m + 8);
+    __m128 c3 = _mm_loadu_ps(m + 12);
+
+    __m128 A = _mm_movelh_ps(c0, c1);
+    __m128 B = _mm_movehl_ps(c1, c0);
+    __m128 C = _mm_movelh_ps(c2, c3);
+    __m128 D = _mm_movehl_ps(c3, c2);
+
+    // determinants of the sub-matrices as (|A| |B| |C| |D|)
+    __m128 detSub = _mm_sub_ps(
+      _mm_mul_ps(_mm_shuffle_ps(c0, c2, CGL_SHUFFLE(0, 2, 0, 2)),
+                 _mm_shuffle_ps(c1, c3, CGL_SHUFFLE(1, 3, 1, 3))),
+      _mm_mul_ps(_mm_shuffle_ps(c0, c2, CGL_SHUFFLE(1, 3, 1, 3)),
+                 _mm_shuffle_ps(c1, c3, CGL_SHUFFLE(0, 2, 0, 2))));
+    __m128 detA = _mm_shuffle_ps(detSub, detSub, CGL_SHUFFLE(0, 0, 0, 0));
+    __m128 detB = _mm_shuffle_ps(detSub, detSub, CGL_SHUFFLE(1, 1, 1, 1));
+    __m128 detC = _mm_shuffle_ps(detSub, detSub, CGL_SHUFFLE(2, 2, 2, 2));
+    __m128 detD = _mm_shuffle_ps(detSub, detSub, CGL_SHUFFLE(3, 3, 3, 3));
+
+    __m128 DC = simd::mat2AdjMul(D, C);
+    __m128 AB = simd::mat2AdjMul(A, B);
+    __m128 X = _mm_sub_ps(_mm_mul_ps(detD, A), simd::mat2Mul(B, DC));
+    __m128 W = _mm_sub_ps(_mm_mul_ps(detA, D), simd::mat2Mul(C, AB));
+    __m128 Y = _mm_sub_ps(_mm_mul_ps(detB, C), simd::mat2MulAdj(D, AB));
+    __m128 Z = _mm_sub_ps(_mm_mul_ps(detC, B), simd::mat2MulAdj(A, DC));
+
+    // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+    __m128 tr = _mm_mul_ps(AB, _mm_shuffle_ps(DC, DC, CGL_SHUFFLE(0, 2, 1, 3)));
+    tr = _mm_add_ps(tr, _mm_shuffle_ps(tr, tr, CGL_SHUFFLE(1, 0, 3, 2)));
+    tr = _mm_add_ps(tr, _mm_shuffle_ps(tr, tr, CGL_SHUFFLE(2, 3, 0, 1)));
+    __m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+
+    if (_mm_cvtss_f32(detM) == 0)
+      return Matrix4<float>();
+
+    __m128 rDetM = _mm_div_ps(_mm_setr_ps(1.f, -1.f, -1.f, 1.f), detM);
+    X = _mm_mul_ps(X, rDetM);
+    Y = _mm_mul_ps(Y, rDetM);
+    Z = _mm_mul_ps(Z, rDetM);
+    W = _mm_mul_ps(W, rDetM);
+
+    // the adjugate of each block is folded into the final shuffle
+    Matrix4<float> R;
+    _mm_storeu_ps(R.m, _mm_shuffle_ps(X, Y, CGL_SHUFFLE(3, 1, 3, 1)));
+    _mm_storeu_ps(R.m + 4, _mm_shuffle_ps(X, Y, CGL_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(R.m + 8, _mm_shuffle_ps(Z, W, CGL_SHUFFLE(3, 1, 3, 1)));
+    _mm_storeu_ps(R.m + 12, _mm_shuffle_ps(Z, W, CGL_SHUFFLE(2, 0, 2, 0)));
+    return R;
+  }
+
+  namespace simd
+  {
+    /// 3D cross product of the first three lanes; the last lane is zero when
+    /// the last lanes of a and b are equal.
+    inline __m128 cross(__m128 a, __m128 b)
+    {
+      __m128 a1 = _mm_shuffle_ps(a, a, CGL_SHUFFLE(1, 2, 0, 3));
+      __m128 b1 = _mm_shuffle_ps(b, b, CGL_SHUFFLE(1, 2, 0, 3));
+      __m128 c = _mm_sub_ps(_mm_mul_ps(a, b1), _mm_mul_ps(a1, b));
+      return _mm_shuffle_ps(c, c, CGL_SHUFFLE(1, 2, 0, 3));
+    }
+
+    /// Stores the affine matrix with upper 3x3 columns c0, c1, c2 (last lanes
+    /// zero) and translation -(c0 * t.x + c1 * t.y + c2 * t.z).
+    inline void storeAffineInverse(float* r, __m128 c0, __m128 c1, __m128 c2, const float* t)
+    {
+      __m128 tr = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(t[0])),
+        _mm_mul_ps(c1, _mm_set1_ps(t[1]))), _mm_mul_ps(c2, _mm_set1_ps(t[2])));
+      _mm_storeu_ps(r, c0);
+      _mm_storeu_ps(r + 4, c1);
+      _mm_storeu_ps(r + 8, c2);
+      _mm_storeu_ps(r + 12, _mm_sub_ps(_mm_setr_ps(0, 0, 0, 1), tr));
+    }
+  }
+
+  template <> inline Matrix4<float> Matrix4<float>::inverseAffineSimd() const
+  {
+    // the rows of the inverse 3x3 are the cross products of the columns
+    __m128 a = _mm_loadu_ps(m);
+    __m128 b = _mm_loadu_ps(m + 4);
+    __m128 c = _mm_loadu_ps(m + 8);
+    __m128 r0 = simd::cross(b, c);
+    __m128 r1 = simd::cross(c, a);
+    __m128 r2 = simd::cross(a, b);
+
+    __m128 d = _mm_mul_ps(a, r0);
+    float det = _mm_cvtss_f32(d) + _mm_cvtss_f32(_mm_shuffle_ps(d, d, CGL_SHUFFLE(1, 1, 1, 1))) +
+      _mm_cvtss_f32(_mm_movehl_ps(d, d));
+    if (det == 0)
+      return Matrix4<float>();
+
+    __m128 s = _mm_set1_ps(1.f / det);
+    r0 = _mm_mul_ps(r0, s);
+    r1 = _mm_mul_ps(r1, s);
+    r2 = _mm_mul_ps(r2, s);
+    __m128 r3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    Matrix4<float> R;
+    simd::storeAffineInverse(R.m, r0, r1, r2, m + 12);
+    return R;
+  }
+
+  template <> inline Matrix4<float> Matrix4<float>::inverseRigidSimd() const
+  {
+    __m128 c0 = _mm_loadu_ps(m);
+    __m128 c1 = _mm_loadu_ps(m + 4);
+    __m128 c2 = _mm_loadu_ps(m + 8);
+    __m128 c3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    Matrix4<float> R;
+    simd::storeAffineInverse(R.m, c0, c1, c2, m + 12);
+    return R;
+  }
+
+} // namespace cgl
+
+#endif // CGL_SIMD_SSE
+
+#endif // CGL_MATRIX4_SIMD_H_
@@ -0,0 +1,54 @@
+#ifndef CGL_PARALLEL_H_
+#define CGL_PARALLEL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace cgl
+{
+  /// Returns the number of threads used when a batch function is given
+  /// threads == 0 (one per hardware thread).
+  inline unsigned hardwareThreads()
+  {
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+  }
+
+  /// Splits [0, n) into contiguous ranges and calls fn(begin, end) for each
+  /// range, using up to threads threads (0 = one per hardware thread). The
+  /// calling thread handles the first range. No range is made smaller than
+  /// minGrain, so small batches run entirely on the calling thread.
+  template <typename F>
+  void parallelFor(size_t n, unsigned threads, F fn, size_t minGrain = 4096)
+  {
+    if (n == 0)
+      return;
+    if (threads == 0)
+      threads = hardwareThreads();
+
+    size_t maxThreads = (n + minGrain - 1) / std::max<size_t>(minGrain, 1);
+    if (threads > maxThreads)
+      threads = static_cast<unsigned>(maxThreads);
+
+    if (threads <= 1) {
+      fn(size_t(0), n);
+      return;
+    }
+
+    size_t chunk = (n + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t begin = chunk; begin < n; begin += chunk)
+      workers.push_back(std::thread(fn, begin, std::min(n, begin + chunk)));
+
+    fn(size_t(0), std::min(n, chunk));
+
+    for (size_t i = 0; i < workers.size(); ++i)
+      workers[i].join();
+  }
+
+} // namespace cgl
+
+#endif // CGL_PARALLEL_H_
@@ -0,0 +1,320 @@
+#ifndef CGL_QUATERNION_H_
+#define CGL_QUATERNION_H_
+
+#include <iostream>
+#include <iomanip>
+#include "cgl_math.h"
+#include "batch_transform.h"
+
+namespace cgl
+{
+  template <typename T> class Quaternion;
+  typedef Quaternion<float> Quat;
+  typedef Quaternion<double> Quatd;
+
+  /// Quaternion with vector part (X, Y, Z) and scalar part W. Unit quaternions
+  /// represent rotations; q1 * q2 applies q2 first, like matrix products.
+  template <typename T> class Quaternion
+  {
+  public:
+
+    /// The X component of the vector part.
+    T x;
+
+    /// The Y component of the vector part.
+    T y;
+
+    /// The Z component of the vector part.
+    T z;
+
+    /// The scalar part.
+    T w;
+
+    /// Constructs the identity rotation (0,0,0,1).
+    constexpr Quaternion<T>() : x(0), y(0), z(0), w(1) {}
+
+    /// Constructs a quaternion with components set to given values.
+    constexpr Quaternion<T>(T x, T y, T z, T w) : x(x), y(y), z(z), w(w) {}
+
+    /// Constructs a quaternion from a vector part v and a scalar part w.
+    constexpr Quaternion<T>(const Vector3<T>& v, T w) : x(v.x), y(v.y), z(v.z), w(w) {}
+
+    /// Constructs a copy of the quaternion q.
+    Quaternion<T>(const Quaternion<T>& q) = default;
+
+    /// Constructs the rotation represented by the rotation matrix M.
+    explicit Quaternion<T>(const Matrix3<T>& M)
+    {
+      const T* m = M;
+      set(m[0], m[3], m[6], m[1], m[4], m[7], m[2], m[5], m[8]);
+    }
+
+    /// Constructs the rotation represented by the upper 3x3 of M.
+    explicit Quaternion<T>(const Matrix4<T>& M)
+    {
+      const T* m = M;
+      set(m[0], m[4], m[8], m[1], m[5], m[9], m[2], m[6], m[10]);
+    }
+
+    /// Returns the vector part (X, Y, Z).
+    constexpr Vector3<T> vec() const
+    {
+      return Vector3<T>(x, y, z);
+    }
+
+    /// Computes the length/magnitude squared of the quaternion.
+    constexpr T lengthSquared() const
+    {
+      return x * x + y * y + z * z + w * w;
+    }
+
+    /// Computes the length/magnitude of the quaternion.
+    T length() const
+    {
+      return std::sqrt(lengthSquared());
+    }
+
+    /// Compute the dot product.
+    constexpr T dot(const Quaternion<T>& q) const
+    {
+      return x * q.x + y * q.y + z * q.z + w * q.w;
+    }
+
+    /// Returns a copy of this quaternion normalized.
+    Quaternion<T> normal() const
+    {
+      return (*this) * (1 / length());
+    }
+
+    /// Scales the components to ensure the quaternion has unit length.
+    Quaternion<T>& normalize()
+    {
+      return (*this) = normal();
+    }
+
+    /// Returns the conjugate (-X, -Y, -Z, W); the inverse of a unit quaternion.
+    constexpr Quaternion<T> conjugate() const
+    {
+      return Quaternion<T>(-x, -y, -z, w);
+    }
+
+    /// Returns the multiplicative inverse.
+    Quaternion<T> inverse() const
+    {
+      return conjugate() * (1 / lengthSquared());
+    }
+
+    /// Rotates the vector v (assumes this is a unit quaternion).
+    constexpr Vector3<T> rotate(const Vector3<T>& v) const
+    {
+      Vector3<T> u(x, y, z);
+      Vector3<T> t = u.cross(v) * 2;
+      return v + t * w + u.cross(t);
+    }
+
+    /// Converts the (unit) quaternion to a rotation matrix.
+    constexpr Matrix3<T> toMat3() const
+    {
+      T x2 = x + x, y2 = y + y, z2 = z + z;
+      T xx = x * x2, yy = y * y2, zz = z * z2;
+      T xy = x * y2, xz = x * z2, yz = y * z2;
+      T wx = w * x2, wy = w * y2, wz = w * z2;
+      return Matrix3<T>(1 - (yy + zz), xy + wz, xz - wy,
+        xy - wz, 1 - (xx + zz), yz + wx,
+        xz + wy, yz - wx, 1 - (xx + yy));
+    }
+
+    /// Converts the (unit) quaternion to a rotation matrix.
+    constexpr Matrix4<T> toMat4() const
+    {
+      Matrix3<T> R = toMat3();
+      const T* r = R;
+      return Matrix4<T>(r[0], r[1], r[2], 0,
+        r[3], r[4], r[5], 0,
+        r[6], r[7], r[8], 0,
+        0, 0, 0, 1);
+    }
+
+    /// Returns true if the two quaternions have the exact same component values.
+    constexpr bool operator==(const Quaternion<T>& q) const
+    {
+      return x == q.x && y == q.y && z == q.z && w == q.w;
+    }
+
+    /// Returns true if the two quaternions have at least one component that differs.
+    constexpr bool operator!=(const Quaternion<T>& q) const
+    {
+      return x != q.x || y != q.y || z != q.z || w != q.w;
+    }
+
+    /// Negates all components (represents the same rotation).
+    constexpr Quaternion<T> operator-() const
+    {
+      return Quaternion<T>(-x, -y, -z, -w);
+    }
+
+    /// Component-wise addition of this quaternion and q.
+    constexpr Quaternion<T> operator+(const Quaternion<T>& q) const
+    {
+      return Quaternion<T>(x + q.x, y + q.y, z + q.z, w + q.w);
+    }
+
+    /// Component-wise subtraction of this quaternion and q.
+    constexpr Quaternion<T> operator-(const Quaternion<T>& q) const
+    {
+      return Quaternion<T>(x - q.x, y - q.y, z - q.z, w - q.w);
+    }
+
+    /// Multiplies the scalar s with all components of this quaternion.
+    constexpr Quaternion<T> operator*(T s) const
+    {
+      return Quaternion<T>(x * s, y * s, z * s, w * s);
+    }
+
+    /// Hamilton product; the result applies q first, then this rotation.
+    constexpr Quaternion<T> operator*(const Quaternion<T>& q) const
+    {
+      return Quaternion<T>(w * q.x + x * q.w + y * q.z - z * q.y,
+        w * q.y - x * q.z + y * q.w + z * q.x,
+        w * q.z + x * q.y - y * q.x + z * q.w,
+        w * q.w - x * q.x - y * q.y - z * q.z);
+    }
+
+    /// Multiplies this quaternion by q (see operator*).
+    constexpr Quaternion<T>& operator*=(const Quaternion<T>& q)
+    {
+      return (*this) = (*this) * q;
+    }
+
+    /// Rotates the vector v (assumes this is a unit quaternion).
+    constexpr Vector3<T> operator*(const Vector3<T>& v) const
+    {
+      return rotate(v);
+    }
+
+    /// Creates a rotation of radians around axis (need not be unit length).
+    static Quaternion<T> rotation(T radians, const Vector3<T>& axis)
+    {
+      T half = radians / 2;
+      return Quaternion<T>(axis.normal() * std::sin(half), std::cos(half));
+    }
+
+    /// Creates a rotation of radians around the X axis.
+    static Quaternion<T> rotationX(T radians)
+    {
+      return Quaternion<T>(std::sin(radians / 2), 0, 0, std::cos(radians / 2));
+    }
+
+    /// Creates a rotation of radians around the Y axis.
+    static Quaternion<T> rotationY(T radians)
+    {
+      return Quaternion<T>(0, std::sin(radians / 2), 0, std::cos(radians / 2));
+    }
+
+    /// Creates a rotation of radians around the Z axis.
+    static Quaternion<T> rotationZ(T radians)
+    {
+      return Quaternion<T>(0, 0, std::sin(radians / 2), std::cos(radians / 2));
+    }
+
+    /// Returns the identity rotation (0,0,0,1).
+    static constexpr Quaternion<T> identity()
+    {
+      return Quaternion<T>();
+    }
+
+    /// Prints the quaternion to an output stream.
+    friend std::ostream& operator<<(std::ostream& os, const Quaternion<T>& q)
+    {
+      os << std::fixed;
+      os << std::setprecision(3);
+      os << "(";
+      os << std::setw(10) << q.x << " ";
+      os << std::setw(10) << q.y << " ";
+      os << std::setw(10) << q.z << " ";
+      os << std::setw(10) << q.w << ")";
+      return os;
+    }
+
+  private:
+
+    // Sets the rotation from a rotation matrix given by rows (Shepperd's method).
+    void set(T a00, T a01, T a02, T a10, T a11, T a12, T a20, T a21, T a22)
+    {
+      T trace = a00 + a11 + a22;
+      if (trace > 0) {
+        T s = std::sqrt(trace + 1) * 2;
+        x = (a21 - a12) / s;
+        y = (a02 - a20) / s;
+        z = (a10 - a01) / s;
+        w = s / 4;
+      } else if (a00 > a11 && a00 > a22) {
+        T s = std::sqrt(1 + a00 - a11 - a22) * 2;
+        x = s / 4;
+        y = (a01 + a10) / s;
+        z = (a02 + a20) / s;
+        w = (a21 - a12) / s;
+      } else if (a11 > a22) {
+        T s = std::sqrt(1 + a11 - a00 - a22) * 2;
+        x = (a01 + a10) / s;
+        y = s / 4;
+        z = (a12 + a21) / s;
+        w = (a02 - a20) / s;
+      } else {
+        T s = std::sqrt(1 + a22 - a00 - a11) * 2;
+        x = (a02 + a20) / s;
+        y = (a12 + a21) / s;
+        z = s / 4;
+        w = (a10 - a01) / s;
+      }
+    }
+  };
+
+  /// Normalized linear interpolation of the rotations a and b; cheaper than
+  /// slerp but the angular velocity is not constant.
+  template <typename T> Quaternion<T> nlerp(const Quaternion<T>& a, const Quaternion<T>& b, T w)
+  {
+    // interpolate along the shorter arc
+    Quaternion<T> c = a.dot(b) < 0 ? -b : b;
+    return (a + (c - a) * w).normalize();
+  }
+
+  /// Spherical linear interpolation of the rotations a and b with constant
+  /// angular velocity. Returns a when w == 0, and b (or -b) when w == 1.
+  template <typename T> Quaternion<T> slerp(const Quaternion<T>& a, const Quaternion<T>& b, T w)
+  {
+    T cosTheta = a.dot(b);
+    Quaternion<T> c = b;
+    if (cosTheta < 0) {
+      c = -b;
+      cosTheta = -cosTheta;
+    }
+
+    // nearly parallel: sin(theta) -> 0, so fall back to nlerp
+    if (cosTheta > T(0.9995))
+      return (a + (c - a) * w).normalize();
+
+    T theta = std::acos(cosTheta);
+    T sinTheta = std::sin(theta);
+    T wa = std::sin((1 - w) * theta) / sinTheta;
+    T wb = std::sin(w * theta) / sinTheta;
+    return a * wa + c * wb;
+  }
+
+  /// Rotates n vectors by the unit quaternion q. The quaternion is expanded to
+  /// a matrix once, and the vectors go through the batch transform kernels.
+  inline void rotateVectors(const Quat& q, const Vec3* src, Vec3* dst, size_t n, unsigned threads = 1)
+  {
+    transformDirections(q.toMat4(), src, dst, n, threads);
+  }
+
+  /// Rotates n strided vectors by the unit quaternion q (see batch_transform.h).
+  inline void rotateVectors(const Quat& q, const void* src, size_t srcStride,
+    void* dst, size_t dstStride, size_t n, unsigned threads = 1)
+  {
+    transformDirections(q.toMat4(), src, srcStride, dst, dstStride, n, threads);
+  }
+
+} // namespace cgl
+
+#endif // CGL_QUATERNION_H_
@@ -0,0 +1,48 @@
+#ifndef CGL_SIMD_H_
+#define CGL_SIMD_H_
+
+// Compile-time selection of the SIMD instruction set used by the math kernels.
+// The widest set enabled by the compiler flags is used (e.g. -mavx or
+// /arch:AVX for AVX). Define CGL_NO_SIMD before including any cgl headers to
+// force the portable scalar code paths.
+//
+//   CGL_SIMD_SSE  : 4-wide float kernels (<xmmintrin.h>)
+//   CGL_SIMD_SSE2 : 4-wide integer kernels (<emmintrin.h>); implies CGL_SIMD_SSE
+//   CGL_SIMD_AVX  : 8-wide float kernels (<immintrin.h>); implies CGL_SIMD_SSE2
+
+#ifndef CGL_NO_SIMD
+#  if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#    define CGL_SIMD_SSE 1
+#    include <xmmintrin.h>
+#  endif
+#  if defined(CGL_SIMD_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#    define CGL_SIMD_SSE2 1
+#    include <emmintrin.h>
+#  endif
+#  if defined(CGL_SIMD_SSE2) && defined(__AVX__)
+#    define CGL_SIMD_AVX 1
+#    include <immintrin.h>
+#  endif
+#endif
+
+/// True while a constexpr function is being evaluated at compile time, where
+/// the intrinsics cannot run, so the function takes its scalar path. Without
+/// compiler support there is no way to tell, and it is always true: the
+/// constexpr functions then always use the scalar code.
+#if defined(__has_builtin)
+#  if __has_builtin(__builtin_is_constant_evaluated)
+#    define CGL_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#  endif
+#endif
+#if !defined(CGL_IS_CONSTANT_EVALUATED) && \
+    ((defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 9) || (defined(_MSC_VER) && _MSC_VER >= 1925))
+#  define CGL_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#ifndef CGL_IS_CONSTANT_EVALUATED
+#  define CGL_IS_CONSTANT_EVALUATED() true
+#endif
+
+/// Builds the immediate operand for _mm_shuffle_ps from lane indices.
+#define CGL_SHUFFLE(x, y, z, w) ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+
+#endif // CGL_SIMD_H_
@@ -0,0 +1,213 @@
+#ifndef CGL_SIMD_FLOAT_H_
+#define CGL_SIMD_FLOAT_H_
+
+#include <algorithm>
+#include <cmath>
+#include "simd.h"
+
+// Thin wrappers around float registers of different widths with a common
+// interface, so that array kernels can be written once as templates and
+// instantiated for the widest available register (FloatN) plus a scalar
+// (Float1) pass for the elements left over. Loads and stores are unaligned.
+// Float4 is always available, as four scalars when SSE is disabled, for code
+// that works on 4-component values (e.g. a bounding box corner plus padding).
+//
+// rsqrt() is approximate: the hardware estimate refined by one Newton-Raphson
+// step, with a relative error below 3e-7 (it is exact when SSE is disabled).
+// Float1 uses the same estimate and step as the wide types, so a kernel gives
+// the same results for the packed elements and the scalar tail.
+
+namespace cgl
+{
+  namespace simd
+  {
+    /// One float; the portable fallback and the tail of every kernel.
+    struct Float1
+    {
+      static const int width = 1;
+      float v;
+
+      Float1() {}
+      explicit Float1(float s) : v(s) {}
+
+      static Float1 load(const float* p) { return Float1(*p); }
+      void store(float* p) const { *p = v; }
+
+      friend Float1 operator+(Float1 a, Float1 b) { return Float1(a.v + b.v); }
+      friend Float1 operator-(Float1 a, Float1 b) { return Float1(a.v - b.v); }
+      friend Float1 operator*(Float1 a, Float1 b) { return Float1(a.v * b.v); }
+      friend Float1 operator/(Float1 a, Float1 b) { return Float1(a.v / b.v); }
+      friend Float1 min(Float1 a, Float1 b) { return Float1(std::min(a.v, b.v)); }
+      friend Float1 max(Float1 a, Float1 b) { return Float1(std::max(a.v, b.v)); }
+      friend Float1 sqrt(Float1 a) { return Float1(std::sqrt(a.v)); }
+
+      /// Returns an approximation of 1 / sqrt(a).
+      friend Float1 rsqrt(Float1 a)
+      {
+#ifdef CGL_SIMD_SSE
+        float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(a.v)));
+        return Float1(y * (1.5f - 0.5f * a.v * y * y));
+#else
+        return Float1(1.0f / std::sqrt(a.v));
+#endif
+      }
+
+      /// Returns the smallest lane.
+      friend float hmin(Float1 a) { return a.v; }
+
+      /// Returns the largest lane.
+      friend float hmax(Float1 a) { return a.v; }
+
+      /// Returns a bit mask with bit k set if lane k of a is less than b.
+      friend int lessMask(Float1 a, Float1 b) { return a.v < b.v ? 1 : 0; }
+    };
+
+#ifdef CGL_SIMD_SSE
+    /// Four floats in an SSE register.
+    struct Float4
+    {
+      static const int width = 4;
+      __m128 v;
+
+      Float4() {}
+      explicit Float4(float s) : v(_mm_set1_ps(s)) {}
+      explicit Float4(__m128 v) : v(v) {}
+
+      static Float4 load(const float* p) { return Float4(_mm_loadu_ps(p)); }
+      void store(float* p) const { _mm_storeu_ps(p, v); }
+
+      friend Float4 operator+(Float4 a, Float4 b) { return Float4(_mm_add_ps(a.v, b.v)); }
+      friend Float4 operator-(Float4 a, Float4 b) { return Float4(_mm_sub_ps(a.v, b.v)); }
+      friend Float4 operator*(Float4 a, Float4 b) { return Float4(_mm_mul_ps(a.v, b.v)); }
+      friend Float4 operator/(Float4 a, Float4 b) { return Float4(_mm_div_ps(a.v, b.v)); }
+      friend Float4 min(Float4 a, Float4 b) { return Float4(_mm_min_ps(a.v, b.v)); }
+      friend Float4 max(Float4 a, Float4 b) { return Float4(_mm_max_ps(a.v, b.v)); }
+      friend Float4 sqrt(Float4 a) { return Float4(_mm_sqrt_ps(a.v)); }
+
+      /// Returns an approximation of 1 / sqrt(a).
+      friend Float4 rsqrt(Float4 a)
+      {
+        Float4 y(_mm_rsqrt_ps(a.v));
+        return y * (Float4(1.5f) - Float4(0.5f) * a * y * y);
+      }
+
+      /// Returns the smallest lane.
+      friend float hmin(Float4 a)
+      {
+        __m128 m = _mm_min_ps(a.v, _mm_shuffle_ps(a.v, a.v, CGL_SHUFFLE(2, 3, 0, 1)));
+        m = _mm_min_ps(m, _mm_shuffle_ps(m, m, CGL_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtss_f32(m);
+      }
+
+      /// Returns the largest lane.
+      friend float hmax(Float4 a)
+      {
+        __m128 m = _mm_max_ps(a.v, _mm_shuffle_ps(a.v, a.v, CGL_SHUFFLE(2, 3, 0, 1)));
+        m = _mm_max_ps(m, _mm_shuffle_ps(m, m, CGL_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtss_f32(m);
+      }
+
+      /// Returns a bit mask with bit k set if lane k of a is less than b.
+      friend int lessMask(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmplt_ps(a.v, b.v)); }
+    };
+#else
+    /// Four floats computed one at a time.
+    struct Float4
+    {
+      static const int width = 4;
+      float v[4];
+
+      Float4() {}
+      explicit Float4(float s) { v[0] = v[1] = v[2] = v[3] = s; }
+
+      static Float4 load(const float* p) { Float4 r; for (int k = 0; k < 4; ++k) r.v[k] = p[k]; return r; }
+      void store(float* p) const { for (int k = 0; k < 4; ++k) p[k] = v[k]; }
+
+#define CGL_FLOAT4_OP(name, expr) \
+      friend Float4 name(Float4 a, Float4 b) { Float4 r; for (int k = 0; k < 4; ++k) r.v[k] = expr; return r; }
+      CGL_FLOAT4_OP(operator+, a.v[k] + b.v[k])
+      CGL_FLOAT4_OP(operator-, a.v[k] - b.v[k])
+      CGL_FLOAT4_OP(operator*, a.v[k] * b.v[k])
+      CGL_FLOAT4_OP(operator/, a.v[k] / b.v[k])
+      CGL_FLOAT4_OP(min, std::min(a.v[k], b.v[k]))
+      CGL_FLOAT4_OP(max, std::max(a.v[k], b.v[k]))
+#undef CGL_FLOAT4_OP
+      friend Float4 sqrt(Float4 a) { Float4 r; for (int k = 0; k < 4; ++k) r.v[k] = std::sqrt(a.v[k]); return r; }
+      friend Float4 rsqrt(Float4 a) { Float4 r; for (int k = 0; k < 4; ++k) r.v[k] = 1.0f / std::sqrt(a.v[k]); return r; }
+
+      /// Returns the smallest lane.
+      friend float hmin(Float4 a) { return std::min(std::min(a.v[0], a.v[1]), std::min(a.v[2], a.v[3])); }
+
+      /// Returns the largest lane.
+      friend float hmax(Float4 a) { return std::max(std::max(a.v[0], a.v[1]), std::max(a.v[2], a.v[3])); }
+
+      /// Returns a bit mask with bit k set if lane k of a is less than b.
+      friend int lessMask(Float4 a, Float4 b)
+      {
+        int m = 0;
+        for (int k = 0; k < 4; ++k)
+          m |= (a.v[k] < b.v[k]) << k;
+        return m;
+      }
+    };
+#endif
+
+#ifdef CGL_SIMD_AVX
+    /// Eight floats in an AVX register.
+    struct Float8
+    {
+      static const int width = 8;
+      __m256 v;
+
+      Float8() {}
+      explicit Float8(float s) : v(_mm256_set1_ps(s)) {}
+      explicit Float8(__m256 v) : v(v) {}
+
+      static Float8 load(const float* p) { return Float8(_mm256_loadu_ps(p)); }
+      void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+      friend Float8 operator+(Float8 a, Float8 b) { return Float8(_mm256_add_ps(a.v, b.v)); }
+      friend Float8 operator-(Float8 a, Float8 b) { return Float8(_mm256_sub_ps(a.v, b.v)); }
+      friend Float8 operator*(Float8 a, Float8 b) { return Float8(_mm256_mul_ps(a.v, b.v)); }
+      friend Float8 operator/(Float8 a, Float8 b) { return Float8(_mm256_div_ps(a.v, b.v)); }
+      friend Float8 min(Float8 a, Float8 b) { return Float8(_mm256_min_ps(a.v, b.v)); }
+      friend Float8 max(Float8 a, Float8 b) { return Float8(_mm256_max_ps(a.v, b.v)); }
+      friend Float8 sqrt(Float8 a) { return Float8(_mm256_sqrt_ps(a.v)); }
+
+      /// Returns an approximation of 1 / sqrt(a).
+      friend Float8 rsqrt(Float8 a)
+      {
+        Float8 y(_mm256_rsqrt_ps(a.v));
+        return y * (Float8(1.5f) - Float8(0.5f) * a * y * y);
+      }
+
+      /// Returns the smallest lane.
+      friend float hmin(Float8 a)
+      {
+        return hmin(Float4(_mm_min_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1))));
+      }
+
+      /// Returns the largest lane.
+      friend float hmax(Float8 a)
+      {
+        return hmax(Float4(_mm_max_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1))));
+      }
+
+      /// Returns a bit mask with bit k set if lane k of a is less than b.
+      friend int lessMask(Float8 a, Float8 b) { return _mm256_movemask_ps(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)); }
+    };
+#endif
+
+    /// The widest float register enabled at compile time.
+#if defined(CGL_SIMD_AVX)
+    typedef Float8 FloatN;
+#elif defined(CGL_SIMD_SSE)
+    typedef Float4 FloatN;
+#else
+    typedef Float1 FloatN;
+#endif
+
+  } // namespace simd
+} // namespace cgl
+
+#endif // CGL_SIMD_FLOAT_H_
@@ -25,31 +25,31 @@ namespace cgl
     T y;
 
     /// Constructs a 2D vector with both components set to s (default 0).
-    Vector2<T>(T s = 0) : x(s), y(s) {}
+    constexpr Vector2<T>(T s = 0) : x(s), y(s) {}
 
     /// Constructs a 2D vector with X and Y components set to given values.
-    Vector2<T>(T x, T y) : x(x), y(y) {}
+    constexpr Vector2<T>(T x, T y) : x(x), y(y) {}
 
     /// Constructs a 2D vector by copying the values from v.
-    Vector2<T>(const Vector2<T>& v) : x(v.x), y(v.y) {}
+    Vector2<T>(const Vector2<T>& v) = default;
 
     /// Constructs a 2D vector by copying the first two values from v.
-    Vector2<T>(const Vector3<T>& v) : x(v.x), y(v.y) {}
+    constexpr Vector2<T>(const Vector3<T>& v) : x(v.x), y(v.y) {}
 
     /// Constructs a 2D vector by copying the first two values from v.
-    Vector2<T>(const Vector4<T>& v) : x(v.x), y(v.y) {}
+    constexpr Vector2<T>(const Vector4<T>& v) : x(v.x), y(v.y) {}
 
     /// Constructs a 2D vector from an array.
-    Vector2<T>(const T a[2]) : x(a[0]), y(a[1]) {}
+    constexpr Vector2<T>(const T a[2]) : x(a[0]), y(a[1]) {}
 
     /// Returns the number of components in the vector (2).
-    unsigned size() const
+    constexpr unsigned size() const
     {
       return 2;
     }
 
     /// Computes the length/magnitude squared of the vector.
-    T lengthSquared() const
+    constexpr T lengthSquared() const
     {
       return x * x + y * y;
     }
@@ -60,6 +60,14 @@ namespace cgl
       return std::sqrt(lengthSquared());
     }
 
+    /// Computes an approximation of the length with rsqrtFast() (relative
+    /// error below 4e-7).
+    T lengthFast() const
+    {
+      T d = lengthSquared();
+      return d > 0 ? d * rsqrtFast(d) : 0;
+    }
+
     /// Computes the angle in [-pi, pi].
     T angle() const
     {
@@ -84,19 +92,19 @@ namespace cgl
     }
 
     /// Compute the dot product.
-    T dot(const Vector2<T>& v) const
+    constexpr T dot(const Vector2<T>& v) const
     {
       return x * v.x + y * v.y;
     }
 
     /// Computes the 2D cross product.
-    T cross(const Vector2<T>& v) const
+    constexpr T cross(const Vector2<T>& v) const
     {
       return x * v.y - y * v.x;
     }
 
     /// Returns the reflection of this vector on a surface with normal n.
-    Vector2<T> reflect(const Vector2<T>& n) const
+    constexpr Vector2<T> reflect(const Vector2<T>& n) const
     { 
       return (*this) - n * n.dot(*this) * 2;
     }
@@ -107,6 +115,13 @@ namespace cgl
       return (*this) / length();
     } 
 
+    /// Returns a copy of this vector scaled to approximately unit length with
+    /// rsqrtFast() (length within 4e-7 of 1).
+    Vector2<T> normalFast() const
+    {
+      return (*this) * rsqrtFast(lengthSquared());
+    }
+
     /// Rotates this vector by radians around the origin.
     Vector2<T>& rotate(T radians)
     {
@@ -120,7 +135,7 @@ namespace cgl
     }
 
     /// Rotates this vector 90 degrees.
-    Vector2<T>& rotate90()
+    constexpr Vector2<T>& rotate90()
     {
       T temp = x;
       x = -y;
@@ -129,7 +144,7 @@ namespace cgl
     }
 
     /// Rotates this vector 180 degrees.
-    Vector2<T>& rotate180()
+    constexpr Vector2<T>& rotate180()
     {
       x = -x;
       y = -y;
@@ -137,7 +152,7 @@ namespace cgl
     }
 
     /// Rotates this vector 270 degrees.
-    Vector2<T>& rotate270()
+    constexpr Vector2<T>& rotate270()
     {
       T temp = x;
       x = y;
@@ -151,6 +166,13 @@ namespace cgl
       return (*this) /= length();
     }
 
+    /// Scales the components to approximately unit length with rsqrtFast()
+    /// (length within 4e-7 of 1).
+    Vector2<T>& normalizeFast()
+    {
+      return (*this) *= rsqrtFast(lengthSquared());
+    }
+
     /// Treats the vector as an array of values.
     operator T*()
     {
@@ -176,36 +198,36 @@ namespace cgl
     }
 
     /// Returns true if the two vectors have the exact same component values.
-    bool operator==(const Vector2<T>& v) const {
+    constexpr bool operator==(const Vector2<T>& v) const {
       return x == v.x && y == v.y;
     }
 
     /// Returns true if the two vectors have at least one component that differs.
-    bool operator!=(const Vector2<T>& v) const
+    constexpr bool operator!=(const Vector2<T>& v) const
     {
       return x != v.x || y != v.y;
     }
 
     /// Negates all components of this vector.
-    Vector2<T> operator-() const
+    constexpr Vector2<T> operator-() const
     {
       return Vector2<T>(-x, -y);
     }
 
     /// Adds the scalar s to all components of this vector.
-    Vector2<T> operator+(T s) const
+    constexpr Vector2<T> operator+(T s) const
     {
       return Vector2<T>(this->x + s, this->y + s);
     }
 
     /// Component-wise addition of this vector and v.
-    Vector2<T> operator+(const Vector2<T>& v) const
+    constexpr Vector2<T> operator+(const Vector2<T>& v) const
     {
       return Vector2<T>(x + v.x, y + v.y);
     }
 
     /// Adds the scalar s to all components of the vector.
-    Vector2<T>& operator+=(T s)
+    constexpr Vector2<T>& operator+=(T s)
     { 
       x += s;
       y += s;
@@ -213,7 +235,7 @@ namespace cgl
     } 
 
     /// Component-wise addition of this vector and v.
-    Vector2<T>& operator+=(const Vector2<T>& v)
+    constexpr Vector2<T>& operator+=(const Vector2<T>& v)
     { 
       x += v.x;
       y += v.y;
@@ -221,19 +243,19 @@ namespace cgl
     }
 
     /// Subtracts the scalar s from all components of this vector.
-    Vector2<T> operator-(T s) const
+    constexpr Vector2<T> operator-(T s) const
     {
       return Vector2<T>(this->x - s, this->y - s);
     }
 
     /// Component-wise subtraction of this vector and v.
-    Vector2<T> operator-(const Vector2<T>& v) const
+    constexpr Vector2<T> operator-(const Vector2<T>& v) const
     {
       return Vector2<T>(x - v.x, y - v.y);
     }
 
     /// Subtracts the scalar s from all components of the vector.
-    Vector2<T>& operator-=(T s)
+    constexpr Vector2<T>& operator-=(T s)
     { 
       x -= s;
       y -= s;
@@ -241,7 +263,7 @@ namespace cgl
     } 
 
     /// Component-wise subtraction of this vector and v.
-    Vector2<T>& operator-=(const Vector2<T>& v)
+    constexpr Vector2<T>& operator-=(const Vector2<T>& v)
     { 
       x -= v.x;
       y -= v.y;
@@ -249,19 +271,19 @@ namespace cgl
     }
 
     /// Multiplies the scalar s with all components of this vector.
-    Vector2<T> operator*(T s) const
+    constexpr Vector2<T> operator*(T s) const
     {
       return Vector2<T>(this->x * s, this->y * s);
     }
 
     /// Component-wise multiplication of this vector and v.
-    Vector2<T> operator*(const Vector2<T>& v) const
+    constexpr Vector2<T> operator*(const Vector2<T>& v) const
     {
       return Vector2<T>(x * v.x, y * v.y);
     }
 
     /// Multiplies the scalar s with all components of the vector.
-    Vector2<T>& operator*=(T s)
+    constexpr Vector2<T>& operator*=(T s)
     { 
       x *= s;
       y *= s;
@@ -269,7 +291,7 @@ namespace cgl
     } 
 
     /// Component-wise multiplication of this vector and v.
-    Vector2<T>& operator*=(const Vector2<T>& v)
+    constexpr Vector2<T>& operator*=(const Vector2<T>& v)
     { 
       x *= v.x;
       y *= v.y;
@@ -277,19 +299,19 @@ namespace cgl
     }
 
     /// Divides all components of this vector by the scalar s.
-    Vector2<T> operator/(T s) const
+    constexpr Vector2<T> operator/(T s) const
     {
       return Vector2<T>(this->x / s, this->y / s);
     }
 
     /// Component-wise division of this vector and v.
-    Vector2<T> operator/(const Vector2<T>& v) const
+    constexpr Vector2<T> operator/(const Vector2<T>& v) const
     {
       return Vector2<T>(x / v.x, y / v.y);
     }
 
     /// Divides all components of this vector by the scalar s.
-    Vector2<T>& operator/=(T s)
+    constexpr Vector2<T>& operator/=(T s)
     { 
       x /= s;
       y /= s;
@@ -297,7 +319,7 @@ namespace cgl
     } 
 
     /// Component-wise division of this vector and v.
-    Vector2<T>& operator/=(const Vector2<T>& v)
+    constexpr Vector2<T>& operator/=(const Vector2<T>& v)
     { 
       x /= v.x;
       y /= v.y;
@@ -305,31 +327,27 @@ namespace cgl
     }
 
     /// Returns the zero vector (0,0).
-    static const Vector2<T>& zero()
-    { 
-      static Vector2<T> s_zero;
-      return s_zero;
+    static constexpr Vector2<T> zero()
+    {
+      return Vector2<T>();
     }
 
     /// Returns the one vector (1,1).
-    static const Vector2<T>& one() 
+    static constexpr Vector2<T> one()
     {
-      static Vector2<T> s_one(1);
-      return s_one; 
+      return Vector2<T>(1);
     }
 
     /// Returns the x-axis vector (1,0).
-    static const Vector2<T>& xAxis()
+    static constexpr Vector2<T> xAxis()
     {
-      static Vector2<T> s_x(1,0); 
-      return s_x;
+      return Vector2<T>(1,0);
     }
 
     /// Returns the y-axis vector (0,1).
-    static const Vector2<T>& yAxis()
-    { 
-      static Vector2<T> s_y(0,1);
-      return s_y;
+    static constexpr Vector2<T> yAxis()
+    {
+      return Vector2<T>(0,1);
     }
 
     /// Prints the vector to an output stream.
@@ -28,25 +28,25 @@ namespace cgl
     T z;
 
     /// Constructs a 3D vector with all components set to s (default 0).
-    Vector3<T>(T s = 0) : x(s), y(s), z(s) {}
+    constexpr Vector3<T>(T s = 0) : x(s), y(s), z(s) {}
 
     /// Constructs a 3D vector with components set to given values.
-    Vector3<T>(T x, T y, T z) : x(x), y(y), z(z) {}
+    constexpr Vector3<T>(T x, T y, T z) : x(x), y(y), z(z) {}
 
     /// Constructs a 3D vector by copying the first two values from v; z = 0.
-    Vector3<T>(const Vector2<T>& v) : x(v.x), y(v.y), z(0) {}
+    constexpr Vector3<T>(const Vector2<T>& v) : x(v.x), y(v.y), z(0) {}
 
     /// Constructs a 3D vector by copying the values from v.
-    Vector3<T>(const Vector3<T>& v) : x(v.x), y(v.y), z(v.z) {}
+    Vector3<T>(const Vector3<T>& v) = default;
 
     /// Constructs a 3D vector by copying the first three values from v.
-    Vector3<T>(const Vector4<T>& v) : x(v.x), y(v.y), z(v.z) {}
+    constexpr Vector3<T>(const Vector4<T>& v) : x(v.x), y(v.y), z(v.z) {}
 
     /// Constructs a 3D vector from an array.
-    Vector3<T>(const T a[3]) : x(a[0]), y(a[1]), z(a[2]) {}
+    constexpr Vector3<T>(const T a[3]) : x(a[0]), y(a[1]), z(a[2]) {}
 
     /// Returns the number of components in the vector (3).
-    unsigned size() const { return 3; }
+    constexpr unsigned size() const { return 3; }
 
     /// Treats the vector as an array of values.
     operator T*()
@@ -67,7 +67,7 @@ namespace cgl
     }
 
     /// Computes the length/magnitude squared of the vector.
-    T lengthSquared() const
+    constexpr T lengthSquared() const
     {
       return x * x + y * y + z * z;
     }
@@ -78,14 +78,22 @@ namespace cgl
       return std::sqrt(lengthSquared());
     }
 
+    /// Computes an approximation of the length with rsqrtFast() (relative
+    /// error below 4e-7).
+    T lengthFast() const
+    {
+      T d = lengthSquared();
+      return d > 0 ? d * rsqrtFast(d) : 0;
+    }
+
     /// Compute the dot product.
-    T dot(const Vector3<T>& v) const
+    constexpr T dot(const Vector3<T>& v) const
     {
       return x * v.x + y * v.y + z * v.z;
     }
 
     /// Computes the 3D cross product.
-    Vector3<T> cross(const Vector3<T>& v) const
+    constexpr Vector3<T> cross(const Vector3<T>& v) const
     {
       return Vector3<T>(y * v.z - z * v.y,
         z * v.x - x * v.z,
@@ -98,50 +106,64 @@ namespace cgl
       return (*this) / length();
     } 
 
+    /// Returns a copy of this vector scaled to approximately unit length with
+    /// rsqrtFast() (length within 4e-7 of 1).
+    Vector3<T> normalFast() const
+    {
+      return (*this) * rsqrtFast(lengthSquared());
+    }
+
     /// Scales the components to ensure the vector has unit length.
     Vector3<T>& normalize()
     {
       return (*this) /= length();
     }
 
+    /// Scales the components to approximately unit length with rsqrtFast()
+    /// (length within 4e-7 of 1).
+    Vector3<T>& normalizeFast()
+    {
+      return (*this) *= rsqrtFast(lengthSquared());
+    }
+
     /// Returns the reflection of this vector on a surface with normal n.
-    Vector3<T> reflect(const Vector3<T>& n) const
+    constexpr Vector3<T> reflect(const Vector3<T>& n) const
     {
       return (*this) - n * n.dot(*this) * 2;
     }
 
     /// Returns true if the two vectors have the exact same component values.
-    bool operator==(const Vector3<T>& v) const
+    constexpr bool operator==(const Vector3<T>& v) const
     {
       return x == v.x && y == v.y && z == v.z;
     }
 
     /// Returns true if the two vectors have at least one component that differs.
-    bool operator!=(const Vector3<T>& v) const
+    constexpr bool operator!=(const Vector3<T>& v) const
     {
       return x != v.x || y != v.y || z != v.z;
     }
 
     /// Negates all components of this vector.
-    Vector3<T> operator-() const
+    constexpr Vector3<T> operator-() const
     {
       return Vector3<T>(-x, -y, -z);
     }
 
     /// Adds the scalar s to all components of this vector.
-    Vector3<T> operator+(T s) const
+    constexpr Vector3<T> operator+(T s) const
     {
       return Vector3<T>(this->x + s, this->y + s, this->z + s);
     }
 
     /// Component-wise addition of this vector and v.
-    Vector3<T> operator+(const Vector3<T>& v) const
+    constexpr Vector3<T> operator+(const Vector3<T>& v) const
     {
       return Vector3<T>(x + v.x, y + v.y, z + v.z);
     }
 
     /// Adds the scalar s to all components of the vector.
-    Vector3<T>& operator+=(T s)
+    constexpr Vector3<T>& operator+=(T s)
     { 
       x += s;
       y += s;
@@ -150,7 +172,7 @@ namespace cgl
     } 
 
     /// Component-wise addition of this vector and v.
-    Vector3<T>& operator+=(const Vector3<T>& v)
+    constexpr Vector3<T>& operator+=(const Vector3<T>& v)
     { 
       x += v.x;
       y += v.y;
@@ -159,19 +181,19 @@ namespace cgl
     }
 
     /// Subtracts the scalar s from all components of this vector.
-    Vector3<T> operator-(T s) const
+    constexpr Vector3<T> operator-(T s) const
     {
       return Vector3<T>(this->x - s, this->y - s, this->z - s);
     }
 
     /// Component-wise subtraction of this vector and v.
-    Vector3<T> operator-(const Vector3<T>& v) const
+    constexpr Vector3<T> operator-(const Vector3<T>& v) const
     {
       return Vector3<T>(x - v.x, y - v.y, z - v.z);
     }
 
     /// Subtracts the scalar s from all components of the vector.
-    Vector3<T>& operator-=(T s)
+    constexpr Vector3<T>& operator-=(T s)
     { 
       x -= s;
       y -= s;
@@ -180,7 +202,7 @@ namespace cgl
     } 
 
     /// Component-wise subtraction of this vector and v.
-    Vector3<T>& operator-=(const Vector3<T>& v)
+    constexpr Vector3<T>& operator-=(const Vector3<T>& v)
     { 
       x -= v.x;
       y -= v.y;
@@ -189,19 +211,19 @@ namespace cgl
     }
 
     /// Multiplies the scalar s with all components of this vector.
-    Vector3<T> operator*(T s) const
+    constexpr Vector3<T> operator*(T s) const
     {
       return Vector3<T>(this->x * s, this->y * s, this->z * s);
     }
 
     /// Component-wise multiplication of this vector and v.
-    Vector3<T> operator*(const Vector3<T>& v) const
+    constexpr Vector3<T> operator*(const Vector3<T>& v) const
     {
       return Vector3<T>(x * v.x, y * v.y, z * v.z);
     }
 
     /// Multiplies the scalar s with all components of the vector.
-    Vector3<T>& operator*=(T s)
+    constexpr Vector3<T>& operator*=(T s)
     { 
       x *= s;
       y *= s;
@@ -210,7 +232,7 @@ namespace cgl
     } 
 
     /// Component-wise multiplication of this vector and v.
-    Vector3<T>& operator*=(const Vector3<T>& v)
+    constexpr Vector3<T>& operator*=(const Vector3<T>& v)
     { 
       x *= v.x;
       y *= v.y;
@@ -219,19 +241,19 @@ namespace cgl
     }
 
     /// Divides all components of this vector by the scalar s.
-    Vector3<T> operator/(T s) const
+    constexpr Vector3<T> operator/(T s) const
     {
       return Vector3<T>(this->x / s, this->y / s, this->z / s);
     }
 
     /// Component-wise division of this vector and v.
-    Vector3<T> operator/(const Vector3<T>& v) const
+    constexpr Vector3<T> operator/(const Vector3<T>& v) const
     {
       return Vector3<T>(x / v.x, y / v.y, z / v.z);
     }
 
     /// Divides all components of this vector by the scalar s.
-    Vector3<T>& operator/=(T s)
+    constexpr Vector3<T>& operator/=(T s)
     { 
       x /= s;
       y /= s;
@@ -240,7 +262,7 @@ namespace cgl
     } 
 
     /// Component-wise division of this vector and v.
-    Vector3<T>& operator/=(const Vector3<T>& v)
+    constexpr Vector3<T>& operator/=(const Vector3<T>& v)
     { 
       x /= v.x;
       y /= v.y;
@@ -249,38 +271,33 @@ namespace cgl
     }
 
     /// Returns the zero vector (0,0,0).
-    static const Vector3<T>& zero()
-    { 
-      static Vector3<T> s_zero;
-      return s_zero;
+    static constexpr Vector3<T> zero()
+    {
+      return Vector3<T>();
     }
 
     /// Returns the one vector (1,1,1).
-    static const Vector3<T>& one() 
+    static constexpr Vector3<T> one()
     {
-      static Vector3<T> s_one(1);
-      return s_one; 
+      return Vector3<T>(1);
     }
 
     /// Returns the x-axis vector (1,0,0).
-    static const Vector3<T>& xAxis()
+    static constexpr Vector3<T> xAxis()
     {
-      static Vector3<T> s_x(1,0,0); 
-      return s_x;
+      return Vector3<T>(1,0,0);
     }
 
     /// Returns the y-axis vector (0,1,0).
-    static const Vector3<T>& yAxis()
-    { 
-      static Vector3<T> s_y(0,1,0);
-      return s_y;
+    static constexpr Vector3<T> yAxis()
+    {
+      return Vector3<T>(0,1,0);
     }
 
     /// Returns the z-axis vector (0,0,1).
-    static const Vector3<T>& zAxis()
+    static constexpr Vector3<T> zAxis()
     {
-      static Vector3<T> s_z(0,0,1);
-      return s_z;
+      return Vector3<T>(0,0,1);
     }
 
     /// Prints the vector to an output stream.
@@ -1,9 +1,9 @@
 #ifndef CGL_VECTOR4_H_
 #define CGL_VECTOR4_H_
 
+#include <cmath>
 #include <iostream>
 #include <iomanip>
-#include "cgl_math.h"
 
 namespace cgl
 {
@@ -31,25 +31,25 @@ namespace cgl
     T w;
 
     /// Constructs a 4D vector with all components set to s (default 0).
-    Vector4<T>(T s = 0) : x(s), y(s), z(s), w(s) {}
+    constexpr Vector4<T>(T s = 0) : x(s), y(s), z(s), w(s) {}
 
     /// Constructs a 4D vector with components set to given values.
-    Vector4<T>(T x, T y, T z, T w) : x(x), y(y), z(z), w(w) {}
+    constexpr Vector4<T>(T x, T y, T z, T w) : x(x), y(y), z(z), w(w) {}
 
     /// Constructs a 4D vector by copying the first two values from v; z/w=0.
-    Vector4<T>(const Vector2<T>& v) : x(v.x), y(v.y), z(0), w(0) {}
+    constexpr Vector4<T>(const Vector2<T>& v) : x(v.x), y(v.y), z(0), w(0) {}
 
     /// Constructs a 4D vector by copying the first three values from v; w=0.
-    Vector4<T>(const Vector3<T>& v) : x(v.x), y(v.y), z(v.z), w(0) {}
+    constexpr Vector4<T>(const Vector3<T>& v) : x(v.x), y(v.y), z(v.z), w(0) {}
 
     /// Constructs a 4D vector by copying the values from v.
-    Vector4<T>(const Vector4<T>& v) : x(v.x), y(v.y), z(v.z), w(v.w) {}
+    Vector4<T>(const Vector4<T>& v) = default;
 
     /// Constructs a 4D vector from an array.
-    Vector4<T>(const T a[4]) : x(a[0]), y(a[1]), z(a[2]), w(a[3]) {}
+    constexpr Vector4<T>(const T a[4]) : x(a[0]), y(a[1]), z(a[2]), w(a[3]) {}
 
     /// Returns the number of components in the vector (4).
-    unsigned size() const { return 4; }
+    constexpr unsigned size() const { return 4; }
 
     /// Treats the vector as an array of values.
     operator T*()
@@ -70,7 +70,7 @@ namespace cgl
     }
 
     /// Computes the length/magnitude squared of the vector.
-    T lengthSquared() const
+    constexpr T lengthSquared() const
     {
       return x * x + y * y + z * z + w * w;
     }
@@ -81,8 +81,16 @@ namespace cgl
       return std::sqrt(lengthSquared());
     }
 
+    /// Computes an approximation of the length with rsqrtFast() (relative
+    /// error below 4e-7).
+    T lengthFast() const
+    {
+      T d = lengthSquared();
+      return d > 0 ? d * rsqrtFast(d) : 0;
+    }
+
     /// Compute the dot product.
-    T dot(const Vector4<T>& v) const
+    constexpr T dot(const Vector4<T>& v) const
     {
       return x * v.x + y * v.y + z * v.z + w * v.w;
     }
@@ -93,54 +101,68 @@ namespace cgl
       return (*this) / length();
     } 
 
+    /// Returns a copy of this vector scaled to approximately unit length with
+    /// rsqrtFast() (length within 4e-7 of 1).
+    Vector4<T> normalFast() const
+    {
+      return (*this) * rsqrtFast(lengthSquared());
+    }
+
     /// Scales the components to ensure the vector has unit length.
     Vector4<T>& normalize()
     {
       return (*this) /= length();
     }
 
+    /// Scales the components to approximately unit length with rsqrtFast()
+    /// (length within 4e-7 of 1).
+    Vector4<T>& normalizeFast()
+    {
+      return (*this) *= rsqrtFast(lengthSquared());
+    }
+
     /// Returns true if the two vectors have the exact same component values.
-    bool operator==(const Vector4<T>& v) const
+    constexpr bool operator==(const Vector4<T>& v) const
     {
       return x == v.x && y == v.y && z == v.z && w == v.w;
     }
 
     /// Returns true if the two vectors have at least one component that differs.
-    bool operator!=(const Vector4<T>& v) const
+    constexpr bool operator!=(const Vector4<T>& v) const
     {
       return x != v.x || y != v.y || z != v.z || w != v.w;
     }
 
     /// Negates all components of this vector.
-    Vector4<T> operator-() const
+    constexpr Vector4<T> operator-() const
     {
       return Vector4<T>(-x, -y, -z, -w);
     }
 
     /// Adds the scalar s to all components of this vector.
-    Vector4<T> operator+(T s) const
+    constexpr Vector4<T> operator+(T s) const
     {
       return Vector4<T>(this->x + s, this->y + s, this->z + s, this->w + s);
     }
 
     /// Component-wise addition of this vector and v.
-    Vector4<T> operator+(const Vector4<T>& v) const
+    constexpr Vector4<T> operator+(const Vector4<T>& v) const
     {
       return Vector4<T>(x + v.x, y + v.y, z + v.z, w + v.w);
     }
 
     /// Adds the scalar s to all components of the vector.
-    Vector4<T>& operator+=(T s)
+    constexpr Vector4<T>& operator+=(T s)
     { 
       x += s;
       y += s;
       z += s;
-      w += w;
+      w += s;
       return *this;
     } 
 
     /// Component-wise addition of this vector and v.
-    Vector4<T>& operator+=(const Vector4<T>& v)
+    constexpr Vector4<T>& operator+=(const Vector4<T>& v)
     { 
       x += v.x;
       y += v.y;
@@ -150,19 +172,19 @@ namespace cgl
     }
 
     /// Subtracts the scalar s from all components of this vector.
-    Vector4<T> operator-(T s) const
+    constexpr Vector4<T> operator-(T s) const
     {
       return Vector4<T>(this->x - s, this->y - s, this->z - s, this->w - s);
     }
 
     /// Component-wise subtraction of this vector and v.
-    Vector4<T> operator-(const Vector4<T>& v) const
+    constexpr Vector4<T> operator-(const Vector4<T>& v) const
     {
       return Vector4<T>(x - v.x, y - v.y, z - v.z, w - v.w);
     }
 
     /// Subtracts the scalar s from all components of the vector.
-    Vector4<T>& operator-=(T s)
+    constexpr Vector4<T>& operator-=(T s)
     { 
       x -= s;
       y -= s;
@@ -172,7 +194,7 @@ namespace cgl
     } 
 
     /// Component-wise subtraction of this vector and v.
-    Vector4<T>& operator-=(const Vector4<T>& v)
+    constexpr Vector4<T>& operator-=(const Vector4<T>& v)
     { 
       x -= v.x;
       y -= v.y;
@@ -182,19 +204,19 @@ namespace cgl
     }
 
     /// Multiplies the scalar s with all components of this vector.
-    Vector4<T> operator*(T s) const
+    constexpr Vector4<T> operator*(T s) const
     {
       return Vector4<T>(this->x * s, this->y * s, this->z * s, this->w * s);
     }
 
     /// Component-wise multiplication of this vector and v.
-    Vector4<T> operator*(const Vector4<T>& v) const
+    constexpr Vector4<T> operator*(const Vector4<T>& v) const
     {
       return Vector4<T>(x * v.x, y * v.y, z * v.z, w * v.w);
     }
 
     /// Multiplies the scalar s with all components of the vector.
-    Vector4<T>& operator*=(T s)
+    constexpr Vector4<T>& operator*=(T s)
     { 
       x *= s;
       y *= s;
@@ -204,7 +226,7 @@ namespace cgl
     } 
 
     /// Component-wise multiplication of this vector and v.
-    Vector4<T>& operator*=(const Vector4<T>& v)
+    constexpr Vector4<T>& operator*=(const Vector4<T>& v)
     { 
       x *= v.x;
       y *= v.y;
@@ -214,19 +236,19 @@ namespace cgl
     }
 
     /// Divides all components of this vector by the scalar s.
-    Vector4<T> operator/(T s) const
+    constexpr Vector4<T> operator/(T s) const
     {
       return Vector4<T>(this->x / s, this->y / s, this->z / s, this->w / s);
     }
 
     /// Component-wise division of this vector and v.
-    Vector4<T> operator/(const Vector4<T>& v) const
+    constexpr Vector4<T> operator/(const Vector4<T>& v) const
     {
       return Vector4<T>(x / v.x, y / v.y, z / v.z, w / v.w);
     }
 
     /// Divides all components of this vector by the scalar s.
-    Vector4<T>& operator/=(T s)
+    constexpr Vector4<T>& operator/=(T s)
     { 
       x /= s;
       y /= s;
@@ -236,7 +258,7 @@ namespace cgl
     } 
 
     /// Component-wise division of this vector and v.
-    Vector4<T>& operator/=(const Vector4<T>& v)
+    constexpr Vector4<T>& operator/=(const Vector4<T>& v)
     { 
       x /= v.x;
       y /= v.y;
@@ -246,45 +268,39 @@ namespace cgl
     }
 
     /// Returns the zero vector (0,0,0,0).
-    static const Vector4<T>& zero()
-    { 
-      static Vector4<T> s_zero;
-      return s_zero;
+    static constexpr Vector4<T> zero()
+    {
+      return Vector4<T>();
     }
 
     /// Returns the one vector (1,1,1,1).
-    static const Vector4<T>& one() 
+    static constexpr Vector4<T> one()
     {
-      static Vector4<T> s_one(1);
-      return s_one; 
+      return Vector4<T>(1);
     }
 
     /// Returns the x-axis vector (1,0,0,0).
-    static const Vector4<T>& xAxis()
+    static constexpr Vector4<T> xAxis()
     {
-      static Vector4<T> s_x(1,0,0,0); 
-      return s_x;
+      return Vector4<T>(1,0,0,0);
     }
 
     /// Returns the y-axis vector (0,1,0,0).
-    static const Vector4<T>& yAxis()
-    { 
-      static Vector4<T> s_y(0,1,0,0);
-      return s_y;
+    static constexpr Vector4<T> yAxis()
+    {
+      return Vector4<T>(0,1,0,0);
     }
 
     /// Returns the z-axis vector (0,0,1,0).
-    static const Vector4<T>& zAxis()
+    static constexpr Vector4<T> zAxis()
     {
-      static Vector4<T> s_z(0,0,1,0);
-      return s_z;
+      return Vector4<T>(0,0,1,0);
     }
 
     /// Returns the w-axis vector (0,0,0,1).
-    static const Vector4<T>& wAxis()
+    static constexpr Vector4<T> wAxis()
     {
-      static Vector4<T> s_w(0,0,0,1);
-      return s_w;
+      return Vector4<T>(0,0,0,1);
     }
 
     /// Prints the vector to an output stream.
@@ -303,4 +319,8 @@ namespace cgl
 
 }
 
+// included last, so that Vector4 is complete when cgl_math.h brings in the
+// SIMD specializations of Matrix4 (matrix4_simd.h)
+#include "cgl_math.h"
+
 #endif
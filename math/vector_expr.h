@@ -0,0 +1,361 @@
+#ifndef CGL_VECTOR_EXPR_H_
+#define CGL_VECTOR_EXPR_H_
+
+#include <cstddef>
+#include "cgl_math.h"
+
+// Opt-in expression templates for Vector2/3/4. Wrapping operands with lazy()
+// makes +, -, * and / build an expression tree instead of a temporary vector
+// per operator; the whole tree is evaluated in a single pass by eval() or
+// assign(). For example,
+//
+//   using namespace cgl::expr;
+//   Vec3 v = eval(lazy(a) + (lazy(b) - lazy(a)) * w);
+//
+// lazy() also accepts a pointer to an array of vectors. assign() then runs the
+// fused expression over n elements in one loop, so no intermediate arrays are
+// written:
+//
+//   assign(out, n, lazy(a) + (lazy(b) - lazy(a)) * w);   // a, b: const Vec3*
+//
+// Expressions made only of arrays, scalars and component-wise operators are
+// evaluated over the flattened scalars, which vectorizes well; expressions that
+// mix components (cross) or broadcast a single vector go element by element.
+//
+// These are not a default speedup. The compiler already fuses short chains of
+// the plain operators, so only long component-wise expressions over arrays
+// gain reliably; lerp and cross come out anywhere from somewhat faster to
+// slower depending on the compiler and the run (see bench/expr_bench.cpp).
+// Measure before switching a loop over.
+//
+// Operands must have the same number of components (or be scalars), and
+// assign() must write to vectors of that size; both are checked at compile
+// time.
+//
+// Leaves refer to their operands, so an expression must be evaluated before
+// the vectors it wraps go out of scope.
+
+namespace cgl
+{
+  namespace expr
+  {
+    /// Maps a component count to the matching vector type.
+    template <typename T, int N> struct VectorType;
+    template <typename T> struct VectorType<T, 2> { typedef Vector2<T> type; };
+    template <typename T> struct VectorType<T, 3> { typedef Vector3<T> type; };
+    template <typename T> struct VectorType<T, 4> { typedef Vector4<T> type; };
+
+    /// Maps a vector type to its component count.
+    template <typename V> struct VectorSize;
+    template <typename T> struct VectorSize<Vector2<T> > { static const int value = 2; };
+    template <typename T> struct VectorSize<Vector3<T> > { static const int value = 3; };
+    template <typename T> struct VectorSize<Vector4<T> > { static const int value = 4; };
+
+    /// Base of all expression nodes (CRTP). Every node E provides the scalar
+    /// type value_type, its component count size, and eval(i, c), which returns
+    /// component c of element i. Nodes that treat every component alike also
+    /// set flat and provide evalFlat(j), which returns the j-th scalar when the
+    /// arrays are viewed as flat arrays of scalars.
+    template <typename E> struct Expr
+    {
+      constexpr const E& self() const
+      {
+        return static_cast<const E&>(*this);
+      }
+    };
+
+    /// Leaf referring to a single vector (the same for every element).
+    template <typename V, typename T, int N> struct VectorLeaf : Expr<VectorLeaf<V, T, N> >
+    {
+      typedef T value_type;
+      static const int size = N;
+      static const bool flat = false;
+      const T* v;
+
+      constexpr explicit VectorLeaf(const V& vec) : v(&vec.x) {}
+
+      constexpr T eval(size_t, int c) const
+      {
+        return v[c];
+      }
+    };
+
+    /// Leaf referring to a contiguous array of vectors.
+    template <typename V, typename T, int N> struct ArrayLeaf : Expr<ArrayLeaf<V, T, N> >
+    {
+      typedef T value_type;
+      static const int size = N;
+      static const bool flat = true;
+      const T* p;
+
+      constexpr explicit ArrayLeaf(const V* array) : p(&array->x) {}
+
+      constexpr T eval(size_t i, int c) const
+      {
+        return p[i * N + c];
+      }
+
+      constexpr T evalFlat(size_t j) const
+      {
+        return p[j];
+      }
+    };
+
+    /// Leaf holding a scalar, broadcast to every component.
+    template <typename T> struct ScalarLeaf : Expr<ScalarLeaf<T> >
+    {
+      typedef T value_type;
+      static const int size = 0;
+      static const bool flat = true;
+      T s;
+
+      constexpr explicit ScalarLeaf(T s) : s(s) {}
+
+      constexpr T eval(size_t, int) const
+      {
+        return s;
+      }
+
+      constexpr T evalFlat(size_t) const
+      {
+        return s;
+      }
+    };
+
+    struct OpAdd { template <typename T> static constexpr T apply(T a, T b) { return a + b; } };
+    struct OpSub { template <typename T> static constexpr T apply(T a, T b) { return a - b; } };
+    struct OpMul { template <typename T> static constexpr T apply(T a, T b) { return a * b; } };
+    struct OpDiv { template <typename T> static constexpr T apply(T a, T b) { return a / b; } };
+
+    /// Component-wise binary operation; operands are held by value.
+    template <typename A, typename B, typename Op> struct Binary : Expr<Binary<A, B, Op> >
+    {
+      typedef typename A::value_type value_type;
+      static const int size = A::size > B::size ? A::size : B::size;
+      static const bool flat = A::flat && B::flat;
+      static_assert(A::size == B::size || A::size == 0 || B::size == 0,
+                    "operands of a vector expression must have the same number of components");
+      A a;
+      B b;
+
+      constexpr Binary(const A& a, const B& b) : a(a), b(b) {}
+
+      constexpr value_type eval(size_t i, int c) const
+      {
+        return Op::apply(a.eval(i, c), b.eval(i, c));
+      }
+
+      constexpr value_type evalFlat(size_t j) const
+      {
+        return Op::apply(a.evalFlat(j), b.evalFlat(j));
+      }
+    };
+
+    /// Component-wise negation.
+    template <typename A> struct Negate : Expr<Negate<A> >
+    {
+      typedef typename A::value_type value_type;
+      static const int size = A::size;
+      static const bool flat = A::flat;
+      A a;
+
+      constexpr explicit Negate(const A& a) : a(a) {}
+
+      constexpr value_type eval(size_t i, int c) const
+      {
+        return -a.eval(i, c);
+      }
+
+      constexpr value_type evalFlat(size_t j) const
+      {
+        return -a.evalFlat(j);
+      }
+    };
+
+    /// 3D cross product of two expressions.
+    template <typename A, typename B> struct Cross : Expr<Cross<A, B> >
+    {
+      typedef typename A::value_type value_type;
+      static const int size = 3;
+      static const bool flat = false;
+      static_assert(A::size == 3 && B::size == 3, "cross() needs two 3D vector expressions");
+      A a;
+      B b;
+
+      constexpr Cross(const A& a, const B& b) : a(a), b(b) {}
+
+      constexpr value_type eval(size_t i, int c) const
+      {
+        int c1 = c == 2 ? 0 : c + 1;
+        int c2 = c == 0 ? 2 : c - 1;
+        return a.eval(i, c1) * b.eval(i, c2) - a.eval(i, c2) * b.eval(i, c1);
+      }
+    };
+
+    /// Wraps a vector as an expression leaf.
+    template <typename T> constexpr VectorLeaf<Vector2<T>, T, 2> lazy(const Vector2<T>& v)
+    {
+      return VectorLeaf<Vector2<T>, T, 2>(v);
+    }
+
+    /// Wraps a vector as an expression leaf.
+    template <typename T> constexpr VectorLeaf<Vector3<T>, T, 3> lazy(const Vector3<T>& v)
+    {
+      return VectorLeaf<Vector3<T>, T, 3>(v);
+    }
+
+    /// Wraps a vector as an expression leaf.
+    template <typename T> constexpr VectorLeaf<Vector4<T>, T, 4> lazy(const Vector4<T>& v)
+    {
+      return VectorLeaf<Vector4<T>, T, 4>(v);
+    }
+
+    /// Wraps an array of vectors as an expression leaf.
+    template <typename T> constexpr ArrayLeaf<Vector2<T>, T, 2> lazy(const Vector2<T>* array)
+    {
+      return ArrayLeaf<Vector2<T>, T, 2>(array);
+    }
+
+    /// Wraps an array of vectors as an expression leaf.
+    template <typename T> constexpr ArrayLeaf<Vector3<T>, T, 3> lazy(const Vector3<T>* array)
+    {
+      return ArrayLeaf<Vector3<T>, T, 3>(array);
+    }
+
+    /// Wraps an array of vectors as an expression leaf.
+    template <typename T> constexpr ArrayLeaf<Vector4<T>, T, 4> lazy(const Vector4<T>* array)
+    {
+      return ArrayLeaf<Vector4<T>, T, 4>(array);
+    }
+
+#define CGL_EXPR_OPERATOR(op, Op)                                                          \
+    template <typename A, typename B>                                                      \
+    constexpr Binary<A, B, Op> operator op(const Expr<A>& a, const Expr<B>& b)             \
+    {                                                                                      \
+      return Binary<A, B, Op>(a.self(), b.self());                                         \
+    }                                                                                      \
+    template <typename A>                                                                  \
+    constexpr Binary<A, ScalarLeaf<typename A::value_type>, Op>                            \
+    operator op(const Expr<A>& a, typename A::value_type s)                                \
+    {                                                                                      \
+      return Binary<A, ScalarLeaf<typename A::value_type>, Op>(a.self(),                   \
+        ScalarLeaf<typename A::value_type>(s));                                            \
+    }                                                                                      \
+    template <typename B>                                                                  \
+    constexpr Binary<ScalarLeaf<typename B::value_type>, B, Op>                            \
+    operator op(typename B::value_type s, const Expr<B>& b)                                \
+    {                                                                                      \
+      return Binary<ScalarLeaf<typename B::value_type>, B, Op>(                            \
+        ScalarLeaf<typename B::value_type>(s), b.self());                                  \
+    }
+
+    CGL_EXPR_OPERATOR(+, OpAdd)
+    CGL_EXPR_OPERATOR(-, OpSub)
+    CGL_EXPR_OPERATOR(*, OpMul)
+    CGL_EXPR_OPERATOR(/, OpDiv)
+
+#undef CGL_EXPR_OPERATOR
+
+    /// Component-wise negation of an expression.
+    template <typename A> constexpr Negate<A> operator-(const Expr<A>& a)
+    {
+      return Negate<A>(a.self());
+    }
+
+    /// 3D cross product of two expressions.
+    template <typename A, typename B> constexpr Cross<A, B> cross(const Expr<A>& a, const Expr<B>& b)
+    {
+      return Cross<A, B>(a.self(), b.self());
+    }
+
+    /// Evaluates components [C, N) of element i into r, unrolled at compile
+    /// time so that each eval() sees a constant component index.
+    template <int C, int N> struct Components
+    {
+      template <typename E, typename T> static void eval(const E& e, size_t i, T* r)
+      {
+        r[C] = e.eval(i, C);
+        Components<C + 1, N>::eval(e, i, r);
+      }
+    };
+
+    template <int N> struct Components<N, N>
+    {
+      template <typename E, typename T> static void eval(const E&, size_t, T*) {}
+    };
+
+    /// Evaluates element i of an expression into a vector.
+    template <typename E>
+    typename VectorType<typename E::value_type, E::size>::type eval(const Expr<E>& e, size_t i = 0)
+    {
+      typename E::value_type r[E::size];
+      Components<0, E::size>::eval(e.self(), i, r);
+      return typename VectorType<typename E::value_type, E::size>::type(r);
+    }
+
+    /// Evaluates expressions element by element.
+    template <bool Flat> struct Assign
+    {
+      template <typename T, int N, typename E> static void run(T* out, size_t n, const E& e)
+      {
+        for (size_t i = 0; i < n; ++i) {
+          // evaluate all components before storing, so dst may alias an operand
+          T r[N];
+          Components<0, N>::eval(e, i, r);
+          for (int c = 0; c < N; ++c)
+            out[i * N + c] = r[c];
+        }
+      }
+    };
+
+    /// Evaluates scalars [j + K, j + B) of a flat expression into r, unrolled
+    /// at compile time like Components.
+    template <int K, int B> struct Scalars
+    {
+      template <typename E, typename T> static void eval(const E& e, size_t j, T* r)
+      {
+        r[K] = e.evalFlat(j + K);
+        Scalars<K + 1, B>::eval(e, j, r);
+      }
+    };
+
+    template <int B> struct Scalars<B, B>
+    {
+      template <typename E, typename T> static void eval(const E&, size_t, T*) {}
+    };
+
+    /// Evaluates expressions that treat every component alike over the arrays
+    /// viewed as flat arrays of scalars, in blocks of 8 so the compiler can use
+    /// full-width vector registers without shuffling components.
+    template <> struct Assign<true>
+    {
+      template <typename T, int N, typename E> static void run(T* out, size_t n, const E& e)
+      {
+        const int B = 8;
+        size_t count = n * N;
+        size_t blocks = count / B;
+        for (size_t b = 0; b < blocks; ++b) {
+          T r[B];
+          Scalars<0, B>::eval(e, b * B, r);
+          for (int k = 0; k < B; ++k)
+            out[b * B + k] = r[k];
+        }
+        for (size_t j = blocks * B; j < count; ++j)
+          out[j] = e.evalFlat(j);
+      }
+    };
+
+    /// Evaluates elements [0, n) of an expression into dst in a single pass.
+    /// dst may be one of the arrays the expression reads from, since each
+    /// element only depends on the same element of its operands.
+    template <typename V, typename E> void assign(V* dst, size_t n, const Expr<E>& e)
+    {
+      static_assert(VectorSize<V>::value == E::size,
+                    "assign() needs vectors with as many components as the expression");
+      Assign<E::flat>::template run<typename E::value_type, E::size>(&dst->x, n, e.self());
+    }
+
+  } // namespace expr
+} // namespace cgl
+
+#endif // CGL_VECTOR_EXPR_H_
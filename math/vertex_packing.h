@@ -0,0 +1,571 @@
+#ifndef CGL_VERTEX_PACKING_H_
+#define CGL_VERTEX_PACKING_H_
+
+#include <stdint.h>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include "cgl_math.h"
+#include "simd.h"
+
+// Compact encodings for vertex attributes, matching the OpenGL vertex formats
+// they are meant for:
+//
+//   half         : IEEE 754 binary16 (GL_HALF_FLOAT)
+//   snorm16      : [-1, 1] as round(v * 32767) (GL_SHORT, normalized)
+//   unorm16      : [0, 1] as round(v * 65535) (GL_UNSIGNED_SHORT, normalized)
+//   octahedral   : unit vector as 2 x snorm16 (x in the low half)
+//   1010102      : 4 components in 10, 10, 10 and 2 bits, x in the lowest bits
+//                  (GL_INT_2_10_10_10_REV / GL_UNSIGNED_INT_2_10_10_10_REV)
+//
+// Values are clamped to the encodable range and rounded to nearest (ties to
+// even); NaN encodes as the lower end of the range, except for half, which
+// keeps NaN and infinity. The array versions process 4 or 8 values at a time
+// with SSE2 and give bit-identical results to the single-value versions.
+//
+// Worst-case errors of a round trip: half keeps 11 significant bits
+// (relative error 2^-11); snorm16 and unorm16 are within about 0.5 / 32767
+// and 0.5 / 65535; octahedral normals are within 0.04 degrees; 1010102 is
+// within 0.5 / 511 (snorm) or 0.5 / 1023 (unorm) for x, y and z.
+
+namespace cgl
+{
+  namespace detail
+  {
+    inline uint32_t floatBits(float f)
+    {
+      uint32_t u;
+      std::memcpy(&u, &f, sizeof(u));
+      return u;
+    }
+
+    inline float bitsFloat(uint32_t u)
+    {
+      float f;
+      std::memcpy(&f, &u, sizeof(f));
+      return f;
+    }
+
+    // Clamps like _mm_max_ps followed by _mm_min_ps (NaN becomes lo).
+    inline float clampPacked(float v, float lo, float hi)
+    {
+      v = v > lo ? v : lo;
+      return v < hi ? v : hi;
+    }
+
+    // Rounds to the nearest integer, ties to even, for |v| < 2^22.
+    inline int32_t roundPacked(float v)
+    {
+      return static_cast<int32_t>((v + 12582912.0f) - 12582912.0f);
+    }
+
+    inline int32_t packSnorm(float v, float scale)
+    {
+      return roundPacked(clampPacked(v, -1.0f, 1.0f) * scale);
+    }
+
+    inline int32_t packUnorm(float v, float scale)
+    {
+      return roundPacked(clampPacked(v, 0.0f, 1.0f) * scale);
+    }
+
+    inline float unpackSnorm(int32_t i, float scale)
+    {
+      float v = static_cast<float>(i) / scale;
+      return v > -1.0f ? v : -1.0f;
+    }
+  }
+
+  /// Converts a float to the nearest half float.
+  inline uint16_t packHalf(float value)
+  {
+    // F. Giesen's float_to_half_fast3_rtne
+    uint32_t u = detail::floatBits(value);
+    uint32_t sign = u & 0x80000000u;
+    u ^= sign;
+
+    uint32_t h;
+    if (u >= (127u + 16) << 23) {
+      // overflow to infinity; NaN stays NaN (quiet)
+      h = u > 255u << 23 ? 0x7e00 : 0x7c00;
+    } else if (u < 113u << 23) {
+      // subnormal or zero: let the float addition round the mantissa
+      const uint32_t magic = ((127u - 15) + (23 - 10) + 1) << 23;
+      h = detail::floatBits(detail::bitsFloat(u) + detail::bitsFloat(magic)) - magic;
+    } else {
+      uint32_t odd = (u >> 13) & 1;
+      u += ((15u - 127) << 23) + 0xfff + odd;
+      h = u >> 13;
+    }
+    return static_cast<uint16_t>(h | sign >> 16);
+  }
+
+  /// Converts a half float to a float (exactly).
+  inline float unpackHalf(uint16_t value)
+  {
+    uint32_t bits = value & 0x7fffu;
+    float f = detail::bitsFloat(bits << 13) * detail::bitsFloat((254u - 15) << 23);
+    uint32_t u = detail::floatBits(f);
+    if (bits > 0x7bff)
+      u |= 255u << 23;
+    return detail::bitsFloat(u | (value & 0x8000u) << 16);
+  }
+
+  /// Encodes a value in [-1, 1] as a 16-bit signed normalized integer.
+  inline int16_t packSnorm16(float value)
+  {
+    return static_cast<int16_t>(detail::packSnorm(value, 32767.0f));
+  }
+
+  /// Decodes a 16-bit signed normalized integer (-32768 and -32767 give -1).
+  inline float unpackSnorm16(int16_t value)
+  {
+    return detail::unpackSnorm(value, 32767.0f);
+  }
+
+  /// Encodes a value in [0, 1] as a 16-bit unsigned normalized integer.
+  inline uint16_t packUnorm16(float value)
+  {
+    return static_cast<uint16_t>(detail::packUnorm(value, 65535.0f));
+  }
+
+  /// Decodes a 16-bit unsigned normalized integer.
+  inline float unpackUnorm16(uint16_t value)
+  {
+    return static_cast<float>(value) / 65535.0f;
+  }
+
+  /// Encodes a unit vector by projecting it on the octahedron |x|+|y|+|z| = 1
+  /// and unfolding the lower half, giving two snorm16 coordinates.
+  inline uint32_t packOctahedral(const Vec3& n)
+  {
+    float inv = 1.0f / (std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z));
+    float x = n.x * inv;
+    float y = n.y * inv;
+    if (n.z < 0.0f) {
+      float fx = (1.0f - std::fabs(y)) * std::copysign(1.0f, x);
+      float fy = (1.0f - std::fabs(x)) * std::copysign(1.0f, y);
+      x = fx;
+      y = fy;
+    }
+    uint32_t px = static_cast<uint16_t>(detail::packSnorm(x, 32767.0f));
+    uint32_t py = static_cast<uint16_t>(detail::packSnorm(y, 32767.0f));
+    return px | py << 16;
+  }
+
+  /// Decodes a unit vector encoded by packOctahedral().
+  inline Vec3 unpackOctahedral(uint32_t value)
+  {
+    float x = detail::unpackSnorm(static_cast<int16_t>(value & 0xffff), 32767.0f);
+    float y = detail::unpackSnorm(static_cast<int16_t>(value >> 16), 32767.0f);
+    float z = 1.0f - std::fabs(x) - std::fabs(y);
+    float t = -z > 0.0f ? -z : 0.0f;
+    x = x - std::copysign(t, x);
+    y = y - std::copysign(t, y);
+    float length = std::sqrt(x * x + y * y + z * z);
+    return Vec3(x / length, y / length, z / length);
+  }
+
+  /// Encodes x, y and z in [-1, 1] as 10-bit and w as 2-bit signed
+  /// normalized integers.
+  inline uint32_t packSnorm1010102(const Vec4& v)
+  {
+    return (static_cast<uint32_t>(detail::packSnorm(v.x, 511.0f)) & 0x3ff) |
+      (static_cast<uint32_t>(detail::packSnorm(v.y, 511.0f)) & 0x3ff) << 10 |
+      (static_cast<uint32_t>(detail::packSnorm(v.z, 511.0f)) & 0x3ff) << 20 |
+      static_cast<uint32_t>(detail::packSnorm(v.w, 1.0f)) << 30;
+  }
+
+  /// Decodes a vector encoded by packSnorm1010102().
+  inline Vec4 unpackSnorm1010102(uint32_t value)
+  {
+    int32_t i = static_cast<int32_t>(value);
+    return Vec4(detail::unpackSnorm(static_cast<int32_t>(value << 22) >> 22, 511.0f),
+                detail::unpackSnorm(static_cast<int32_t>(value << 12) >> 22, 511.0f),
+                detail::unpackSnorm(static_cast<int32_t>(value << 2) >> 22, 511.0f),
+                detail::unpackSnorm(i >> 30, 1.0f));
+  }
+
+  /// Encodes x, y and z in [0, 1] as 10-bit and w as 2-bit unsigned
+  /// normalized integers.
+  inline uint32_t packUnorm1010102(const Vec4& v)
+  {
+    return static_cast<uint32_t>(detail::packUnorm(v.x, 1023.0f)) |
+      static_cast<uint32_t>(detail::packUnorm(v.y, 1023.0f)) << 10 |
+      static_cast<uint32_t>(detail::packUnorm(v.z, 1023.0f)) << 20 |
+      static_cast<uint32_t>(detail::packUnorm(v.w, 3.0f)) << 30;
+  }
+
+  /// Decodes a vector encoded by packUnorm1010102().
+  inline Vec4 unpackUnorm1010102(uint32_t value)
+  {
+    return Vec4(static_cast<float>(value & 0x3ff) / 1023.0f,
+                static_cast<float>(value >> 10 & 0x3ff) / 1023.0f,
+                static_cast<float>(value >> 20 & 0x3ff) / 1023.0f,
+                static_cast<float>(value >> 30) / 3.0f);
+  }
+
+#ifdef CGL_SIMD_SSE2
+  namespace detail
+  {
+    inline __m128 clampPacked(__m128 v, float lo, float hi)
+    {
+      return _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(lo)), _mm_set1_ps(hi));
+    }
+
+    inline __m128i roundPacked(__m128 v)
+    {
+      const __m128 magic = _mm_set1_ps(12582912.0f);
+      return _mm_cvttps_epi32(_mm_sub_ps(_mm_add_ps(v, magic), magic));
+    }
+
+    inline __m128i packSnorm(__m128 v, float scale)
+    {
+      return roundPacked(_mm_mul_ps(clampPacked(v, -1.0f, 1.0f), _mm_set1_ps(scale)));
+    }
+
+    inline __m128i packUnorm(__m128 v, float scale)
+    {
+      return roundPacked(_mm_mul_ps(clampPacked(v, 0.0f, 1.0f), _mm_set1_ps(scale)));
+    }
+
+    inline __m128 unpackSnorm(__m128i i, float scale)
+    {
+      return _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(i), _mm_set1_ps(scale)), _mm_set1_ps(-1.0f));
+    }
+
+    // Packs the low 16 bits of the 32-bit lanes of a and b.
+    inline __m128i packLow16(__m128i a, __m128i b)
+    {
+      a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+      b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+      return _mm_packs_epi32(a, b);
+    }
+
+    inline __m128 abs(__m128 v)
+    {
+      return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+    }
+
+    // Returns the magnitudes of a with the signs of b.
+    inline __m128 copysign(__m128 a, __m128 b)
+    {
+      const __m128 sign = _mm_set1_ps(-0.0f);
+      return _mm_or_ps(_mm_andnot_ps(sign, a), _mm_and_ps(sign, b));
+    }
+
+    // F. Giesen's float_to_half_SSE2; the same steps as packHalf().
+    inline __m128i packHalf(__m128 f)
+    {
+      __m128 sign = _mm_and_ps(f, _mm_set1_ps(-0.0f));
+      __m128i u = _mm_castps_si128(_mm_xor_ps(f, sign));
+      __m128i isNan = _mm_castps_si128(_mm_cmpunord_ps(f, f));
+      __m128i special = _mm_or_si128(_mm_and_si128(isNan, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7c00));
+      __m128i isRegular = _mm_cmpgt_epi32(_mm_set1_epi32((127 + 16) << 23), u);
+      __m128i isSubnormal = _mm_cmpgt_epi32(_mm_set1_epi32(113 << 23), u);
+
+      const __m128i magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+      __m128i subnormal = _mm_sub_epi32(
+        _mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(u), _mm_castsi128_ps(magic))), magic);
+
+      __m128i odd = _mm_and_si128(_mm_srli_epi32(u, 13), _mm_set1_epi32(1));
+      __m128i normal = _mm_add_epi32(u, _mm_set1_epi32(static_cast<int>(((15u - 127) << 23) + 0xfff)));
+      normal = _mm_srli_epi32(_mm_add_epi32(normal, odd), 13);
+
+      __m128i h = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+      h = _mm_or_si128(_mm_and_si128(isRegular, h), _mm_andnot_si128(isRegular, special));
+      return _mm_or_si128(h, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+    }
+
+    // The same steps as unpackHalf() on the low 16 bits of each lane.
+    inline __m128 unpackHalf(__m128i h)
+    {
+      __m128i bits = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+      __m128 f = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(bits, 13)),
+                            _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+      __m128i isSpecial = _mm_cmpgt_epi32(bits, _mm_set1_epi32(0x7bff));
+      __m128i u = _mm_or_si128(_mm_castps_si128(f), _mm_and_si128(isSpecial, _mm_set1_epi32(255 << 23)));
+      __m128i sign = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+      return _mm_castsi128_ps(_mm_or_si128(u, sign));
+    }
+
+    // Loads 4 Vec3 as registers of x, y and z components.
+    inline void loadVec3(const Vec3* v, __m128* x, __m128* y, __m128* z)
+    {
+      __m128 a = _mm_loadu_ps(&v[0].x);  // x0 y0 z0 x1
+      __m128 b = _mm_loadu_ps(&v[1].y);  // y1 z1 x2 y2
+      __m128 c = _mm_loadu_ps(&v[2].z);  // z2 x3 y3 z3
+      *x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, CGL_SHUFFLE(2, 2, 1, 1)), CGL_SHUFFLE(0, 3, 0, 2));
+      *y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, CGL_SHUFFLE(1, 1, 0, 0)),
+                          _mm_shuffle_ps(b, c, CGL_SHUFFLE(3, 3, 2, 2)), CGL_SHUFFLE(0, 2, 0, 2));
+      *z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, CGL_SHUFFLE(2, 2, 1, 1)), c, CGL_SHUFFLE(0, 2, 0, 3));
+    }
+
+    // Stores registers of x, y and z components as 4 Vec3.
+    inline void storeVec3(__m128 x, __m128 y, __m128 z, Vec3* v)
+    {
+      _mm_storeu_ps(&v[0].x, _mm_shuffle_ps(_mm_shuffle_ps(x, y, CGL_SHUFFLE(0, 0, 0, 0)),
+                                            _mm_shuffle_ps(z, x, CGL_SHUFFLE(0, 0, 1, 1)), CGL_SHUFFLE(0, 2, 0, 2)));
+      _mm_storeu_ps(&v[1].y, _mm_shuffle_ps(_mm_shuffle_ps(y, z, CGL_SHUFFLE(1, 1, 1, 1)),
+                                            _mm_shuffle_ps(x, y, CGL_SHUFFLE(2, 2, 2, 2)), CGL_SHUFFLE(0, 2, 0, 2)));
+      _mm_storeu_ps(&v[2].z, _mm_shuffle_ps(_mm_shuffle_ps(z, x, CGL_SHUFFLE(2, 2, 3, 3)),
+                                            _mm_shuffle_ps(y, z, CGL_SHUFFLE(3, 3, 3, 3)), CGL_SHUFFLE(0, 2, 0, 2)));
+    }
+
+    inline __m128i load128(const void* p)
+    {
+      return _mm_loadu_si128(static_cast<const __m128i*>(p));
+    }
+
+    inline void store128(void* p, __m128i v)
+    {
+      _mm_storeu_si128(static_cast<__m128i*>(p), v);
+    }
+  }
+#endif
+
+  /// Converts n floats to half floats.
+  inline void packHalf(const float* src, uint16_t* dst, size_t n)
+  {
+    size_t i = 0;
+#ifdef CGL_SIMD_SSE2
+    size_t blocks = n / 8;
+    for (size_t b = 0; b < blocks; ++b, i += 8) {
+      __m128i lo = detail::packHalf(_mm_loadu_ps(src + i));
+      __m128i hi = detail::packHalf(_mm_loadu_ps(src + i + 4));
+      detail::store128(dst + i, detail::packLow16(lo, hi));
+    }
+#endif
+    for (; i < n; ++i)
+      dst[i] = packHalf(src[i]);
+  }
+
+  /// Converts n half floats to floats.
+  inline void unpackHalf(const uint16_t* src, float* dst, size_t n)
+  {
+    size_t i = 0;
+#ifdef CGL_SIMD_SSE2
+    size_t blocks = n / 8;
+    for (size_t b = 0; b < blocks; ++b, i += 8) {
+      __m128i h = detail::load128(src + i);
+      _mm_storeu_ps(dst + i, detail::unpackHalf(_mm_unpacklo_epi16(h, _mm_setzero_si128())));
+      _mm_storeu_ps(dst + i + 4, detail::unpackHalf(_mm_unpackhi_epi16(h, _mm_setzero_si128())));
+    }
+#endif
+    for (; i < n; ++i)
+      dst[i] = unpackHalf(src[i]);
+  }
+
+  /// Encodes n values in [-1, 1] as snorm16.
+  inline void packSnorm16(const float* src, int16_t* dst, size_t n)
+  {
+    size_t i = 0;
+#ifdef CGL_SIMD_SSE2
+    size_t blocks = n / 8;
+    for (size_t b = 0; b < blocks; ++b, i += 8) {
+      __m128i lo = detail::packSnorm(_mm_loadu_ps(src + i), 32767.0f);
+      __m128i hi = detail::packSnorm(_mm_loadu_ps(src + i + 4), 32767.0f);
+      detail::store128(dst + i, _mm_packs_epi32(lo, hi));
+    }
+#endif
+    for (; i < n; ++i)
+      dst[i] = packSnorm16(src[i]);
+  }
+
+  /// Decodes n snorm16 values.
+  inline void unpackSnorm16(const int16_t* src, float* dst, size_t n)
+  {
+    size_t i = 0;
+#ifdef CGL_SIMD_SSE2
+    size_t blocks = n / 8;
+    for (size_t b = 0; b < blocks; ++b, i += 8) {
+      __m128i v = detail::load128(src + i);
+      __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+      __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+      _mm_storeu_ps(dst + i, detail::unpackSnorm(lo, 32767.0f));
+      _mm_storeu_ps(dst + i + 4, detail::unpackSnorm(hi, 32767.0f));
+    }
+#endif
+    for (; i < n; ++i)
+      dst[i] = unpackSnorm16(src[i]);
+  }
+
+  /// Encodes n values in [0, 1] as unorm16.
+  inline void packUnorm16(const float* src, uint16_t* dst, size_t n)
+  {
+    size_t i = 0;
+#ifdef CGL_SIMD_SSE2
+    size_t blocks = n / 8;
+    for (size_t b = 0; b < blocks; ++b, i += 8) {
+      __m128i lo = detail::packUnorm(_mm_loadu_ps(src + i), 65535.0f);
+      __m128i hi = detail::packUnorm(_mm_loadu_ps(src + i + 4), 65535.0f);
+      detail::store128(dst + i, detail::packLow16(lo, hi));
+    }
+#endif
+    for (; i < n; ++i)
+      dst[i] = packUnorm16(src[i]);
+  }
+
+  /// Decodes n unorm16 values.
+  inline void unpackUnorm16(const uint16_t* src, float* dst, size_t n)
+  {
+    size_t i = 0;
+#ifdef CGL_SIMD_SSE2
+    size_t blocks = n / 8;
+    const __m128 scale = _mm_set1_ps(65535.0f);
+    for (size_t b = 0; b < blocks; ++b, i += 8) {
+      __m128i v = detail::load128(src + i);
+      __m128i lo = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+      __m128i hi = _mm_unpackhi_epi16(v, _mm_setzero_si128());
+      _mm_storeu_ps(dst + i, _mm_div_ps(_mm_cvtepi32_ps(lo), scale));
+      _mm_storeu_ps(dst + i + 4, _mm_div_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#endif
+    for (; i < n; ++i)
+      dst[i] = unpackUnorm16(src[i]);
+  }
+
+  /// Encodes n unit vectors with packOctahedral().
+  inline void packOctahedral(const Vec3* src, uint32_t* dst, size_t n)
+  {
+    size_t i = 0;
+#ifdef CGL_SIMD_SSE2
+    size_t blocks = n / 4;
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (size_t b = 0; b < blocks; ++b, i += 4) {
+      __m128 x, y, z;
+      detail::loadVec3(src + i, &x, &y, &z);
+      __m128 inv = _mm_div_ps(one, _mm_add_ps(_mm_add_ps(detail::abs(x), detail::abs(y)), detail::abs(z)));
+      x = _mm_mul_ps(x, inv);
+      y = _mm_mul_ps(y, inv);
+      __m128 fx = _mm_mul_ps(_mm_sub_ps(one, detail::abs(y)), detail::copysign(one, x));
+      __m128 fy = _mm_mul_ps(_mm_sub_ps(one, detail::abs(x)), detail::copysign(one, y));
+      __m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+      x = _mm_or_ps(_mm_and_ps(lower, fx), _mm_andnot_ps(lower, x));
+      y = _mm_or_ps(_mm_and_ps(lower, fy), _mm_andnot_ps(lower, y));
+      __m128i px = _mm_and_si128(detail::packSnorm(x, 32767.0f), _mm_set1_epi32(0xffff));
+      __m128i py = _mm_slli_epi32(detail::packSnorm(y, 32767.0f), 16);
+      detail::store128(dst + i, _mm_or_si128(px, py));
+    }
+#endif
+    for (; i < n; ++i)
+      dst[i] = packOctahedral(src[i]);
+  }
+
+  /// Decodes n unit vectors encoded by packOctahedral().
+  inline void unpackOctahedral(const uint32_t* src, Vec3* dst, size_t n)
+  {
+    size_t i = 0;
+#ifdef CGL_SIMD_SSE2
+    size_t blocks = n / 4;
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (size_t b = 0; b < blocks; ++b, i += 4) {
+      __m128i v = detail::load128(src + i);
+      __m128 x = detail::unpackSnorm(_mm_srai_epi32(_mm_slli_epi32(v, 16), 16), 32767.0f);
+      __m128 y = detail::unpackSnorm(_mm_srai_epi32(v, 16), 32767.0f);
+      __m128 z = _mm_sub_ps(_mm_sub_ps(one, detail::abs(x)), detail::abs(y));
+      __m128 t = _mm_max_ps(_mm_xor_ps(z, _mm_set1_ps(-0.0f)), _mm_setzero_ps());
+      x = _mm_sub_ps(x, detail::copysign(t, x));
+      y = _mm_sub_ps(y, detail::copysign(t, y));
+      __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+      detail::storeVec3(_mm_div_ps(x, length), _mm_div_ps(y, length), _mm_div_ps(z, length), dst + i);
+    }
+#endif
+    for (; i < n; ++i)
+      dst[i] = unpackOctahedral(src[i]);
+  }
+
+  /// Encodes n vectors with packSnorm1010102().
+  inline void packSnorm1010102(const Vec4* src, uint32_t* dst, size_t n)
+  {
+    size_t i = 0;
+#ifdef CGL_SIMD_SSE2
+    size_t blocks = n / 4;
+    const __m128i mask = _mm_set1_epi32(0x3ff);
+    for (size_t b = 0; b < blocks; ++b, i += 4) {
+      __m128 x = _mm_loadu_ps(&src[i].x), y = _mm_loadu_ps(&src[i + 1].x);
+      __m128 z = _mm_loadu_ps(&src[i + 2].x), w = _mm_loadu_ps(&src[i + 3].x);
+      _MM_TRANSPOSE4_PS(x, y, z, w);
+      __m128i r = _mm_and_si128(detail::packSnorm(x, 511.0f), mask);
+      r = _mm_or_si128(r, _mm_slli_epi32(_mm_and_si128(detail::packSnorm(y, 511.0f), mask), 10));
+      r = _mm_or_si128(r, _mm_slli_epi32(_mm_and_si128(detail::packSnorm(z, 511.0f), mask), 20));
+      r = _mm_or_si128(r, _mm_slli_epi32(detail::packSnorm(w, 1.0f), 30));
+      detail::store128(dst + i, r);
+    }
+#endif
+    for (; i < n; ++i)
+      dst[i] = packSnorm1010102(src[i]);
+  }
+
+  /// Decodes n vectors encoded by packSnorm1010102().
+  inline void unpackSnorm1010102(const uint32_t* src, Vec4* dst, size_t n)
+  {
+    size_t i = 0;
+#ifdef CGL_SIMD_SSE2
+    size_t blocks = n / 4;
+    for (size_t b = 0; b < blocks; ++b, i += 4) {
+      __m128i v = detail::load128(src + i);
+      __m128 x = detail::unpackSnorm(_mm_srai_epi32(_mm_slli_epi32(v, 22), 22), 511.0f);
+      __m128 y = detail::unpackSnorm(_mm_srai_epi32(_mm_slli_epi32(v, 12), 22), 511.0f);
+      __m128 z = detail::unpackSnorm(_mm_srai_epi32(_mm_slli_epi32(v, 2), 22), 511.0f);
+      __m128 w = detail::unpackSnorm(_mm_srai_epi32(v, 30), 1.0f);
+      _MM_TRANSPOSE4_PS(x, y, z, w);
+      _mm_storeu_ps(&dst[i].x, x);
+      _mm_storeu_ps(&dst[i + 1].x, y);
+      _mm_storeu_ps(&dst[i + 2].x, z);
+      _mm_storeu_ps(&dst[i + 3].x, w);
+    }
+#endif
+    for (; i < n; ++i)
+      dst[i] = unpackSnorm1010102(src[i]);
+  }
+
+  /// Encodes n vectors with packUnorm1010102().
+  inline void packUnorm1010102(const Vec4* src, uint32_t* dst, size_t n)
+  {
+    size_t i = 0;
+#ifdef CGL_SIMD_SSE2
+    size_t blocks = n / 4;
+    for (size_t b = 0; b < blocks; ++b, i += 4) {
+      __m128 x = _mm_loadu_ps(&src[i].x), y = _mm_loadu_ps(&src[i + 1].x);
+      __m128 z = _mm_loadu_ps(&src[i + 2].x), w = _mm_loadu_ps(&src[i + 3].x);
+      _MM_TRANSPOSE4_PS(x, y, z, w);
+      __m128i r = detail::packUnorm(x, 1023.0f);
+      r = _mm_or_si128(r, _mm_slli_epi32(detail::packUnorm(y, 1023.0f), 10));
+      r = _mm_or_si128(r, _mm_slli_epi32(detail::packUnorm(z, 1023.0f), 20));
+      r = _mm_or_si128(r, _mm_slli_epi32(detail::packUnorm(w, 3.0f), 30));
+      detail::store128(dst + i, r);
+    }
+#endif
+    for (; i < n; ++i)
+      dst[i] = packUnorm1010102(src[i]);
+  }
+
+  /// Decodes n vectors encoded by packUnorm1010102().
+  inline void unpackUnorm1010102(const uint32_t* src, Vec4* dst, size_t n)
+  {
+    size_t i = 0;
+#ifdef CGL_SIMD_SSE2
+    size_t blocks = n / 4;
+    const __m128i mask = _mm_set1_epi32(0x3ff);
+    const __m128 scale = _mm_set1_ps(1023.0f);
+    for (size_t b = 0; b < blocks; ++b, i += 4) {
+      __m128i v = detail::load128(src + i);
+      __m128 x = _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(v, mask)), scale);
+      __m128 y = _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, 10), mask)), scale);
+      __m128 z = _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, 20), mask)), scale);
+      __m128 w = _mm_div_ps(_mm_cvtepi32_ps(_mm_srli_epi32(v, 30)), _mm_set1_ps(3.0f));
+      _MM_TRANSPOSE4_PS(x, y, z, w);
+      _mm_storeu_ps(&dst[i].x, x);
+      _mm_storeu_ps(&dst[i + 1].x, y);
+      _mm_storeu_ps(&dst[i + 2].x, z);
+      _mm_storeu_ps(&dst[i + 3].x, w);
+    }
+#endif
+    for (; i < n; ++i)
+      dst[i] = unpackUnorm1010102(src[i]);
+  }
+
+} // namespace cgl
+
+#endif // CGL_VERTEX_PACKING_H_
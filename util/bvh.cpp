@@ -0,0 +1,398 @@
+#include "bvh.h"
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include "math/parallel.h"
+#include "math/simd_float.h"
+
+using namespace cgl;
+using cgl::simd::Float4;
+
+namespace
+{
+  // Number of buckets the centroids are sorted into when evaluating splits.
+  const int binCount = 16;
+
+  // Subtrees with fewer triangles are not worth a thread of their own.
+  const size_t parallelThreshold = 64 * 1024;
+
+  // Below this depth, nodes are split in the middle instead of by SAH, so
+  // even a degenerate input stays within Bvh::maxDepth (2^32 triangles need
+  // at most 32 more levels).
+  const unsigned sahDepth = Bvh::maxDepth - 32;
+
+  // Nodes with more triangles than this are binned by all threads together,
+  // since the first levels would otherwise run on one thread.
+  const size_t parallelBinThreshold = 1024 * 1024;
+
+  // Axis-aligned box with the corners in the first three lanes.
+  struct Bounds
+  {
+    Float4 lo;
+    Float4 hi;
+
+    // Returns a box that contains nothing.
+    static Bounds empty()
+    {
+      Bounds b;
+      b.lo = Float4(std::numeric_limits<float>::infinity());
+      b.hi = Float4(-std::numeric_limits<float>::infinity());
+      return b;
+    }
+
+    void extend(Float4 p)
+    {
+      lo = min(lo, p);
+      hi = max(hi, p);
+    }
+
+    void extend(const Bounds& b)
+    {
+      lo = min(lo, b.lo);
+      hi = max(hi, b.hi);
+    }
+
+    float area() const
+    {
+      float e[4];
+      (hi - lo).store(e);
+      return 2 * (e[0] * e[1] + e[1] * e[2] + e[2] * e[0]);
+    }
+
+    Vec3 minCorner() const
+    {
+      float c[4];
+      lo.store(c);
+      return Vec3(c);
+    }
+
+    Vec3 maxCorner() const
+    {
+      float c[4];
+      hi.store(c);
+      return Vec3(c);
+    }
+  };
+
+  inline Float4 position(const char* positions, size_t stride, int index)
+  {
+    const float* p = reinterpret_cast<const float*>(positions + stride * index);
+    float q[4] = { p[0], p[1], p[2], 0 };
+    return Float4::load(q);
+  }
+
+  inline Float4 point(const Vec3& p)
+  {
+    float q[4] = { p.x, p.y, p.z, 0 };
+    return Float4::load(q);
+  }
+
+  inline Bounds triangleBounds(const char* positions, size_t stride, const int* indices, uint32_t t)
+  {
+    Bounds b = Bounds::empty();
+    b.extend(position(positions, stride, indices[3 * t]));
+    b.extend(position(positions, stride, indices[3 * t + 1]));
+    b.extend(position(positions, stride, indices[3 * t + 2]));
+    return b;
+  }
+
+  // A triangle during the build. The records themselves are partitioned (not
+  // indices to them), so every pass over a node streams through memory.
+  struct Record
+  {
+    Bounds bounds;
+    uint32_t triangle;
+
+    Float4 centroid() const
+    {
+      return (bounds.lo + bounds.hi) * Float4(0.5f);
+    }
+  };
+
+  struct Bin
+  {
+    Bounds bounds;
+    Bounds centroids;
+    size_t count;
+
+    // Bins are not constructed empty, since most nodes use only a few.
+    void reset()
+    {
+      bounds = Bounds::empty();
+      centroids = Bounds::empty();
+      count = 0;
+    }
+
+    void extend(const Bin& b)
+    {
+      bounds.extend(b.bounds);
+      centroids.extend(b.centroids);
+      count += b.count;
+    }
+  };
+
+  struct Builder
+  {
+    Record* records;
+    unsigned spawnDepth;
+    unsigned threads;
+
+    // Returns the bins of a centroid along the three axes. The bin is
+    // clamped before the conversion, which is undefined out of range.
+    static void bins(Float4 centroid, Float4 lo, Float4 scale, int last, int* b)
+    {
+      float f[4];
+      ((centroid - lo) * scale).store(f);
+      for (int axis = 0; axis < 3; ++axis)
+        b[axis] = f[axis] > 0 ? static_cast<int>(std::min(f[axis], static_cast<float>(last))) : 0;
+    }
+
+    static void resetBins(int binsUsed, Bin (*bins)[binCount])
+    {
+      for (int axis = 0; axis < 3; ++axis) {
+        for (int b = 0; b < binsUsed; ++b)
+          bins[axis][b].reset();
+      }
+    }
+
+    // Sorts the centroids of records[begin, end) into the first binsUsed bins
+    // along each of the three axes.
+    void fillBins(size_t begin, size_t end, Float4 lo, Float4 scale, int binsUsed,
+                  Bin (*bins)[binCount]) const
+    {
+      resetBins(binsUsed, bins);
+      for (size_t i = begin; i < end; ++i) {
+        const Record& r = records[i];
+        Float4 c = r.centroid();
+        int b[3];
+        Builder::bins(c, lo, scale, binsUsed - 1, b);
+        for (int axis = 0; axis < 3; ++axis) {
+          Bin& bin = bins[axis][b[axis]];
+          bin.bounds.extend(r.bounds);
+          bin.centroids.extend(c);
+          bin.count++;
+        }
+      }
+    }
+
+    // Appends the subtree over records[begin, end) to out in depth-first
+    // order. The node bounds and the bounds of the triangle centroids are
+    // passed in by the parent, which gets them from its bins.
+    void build(size_t begin, size_t end, const Bounds& nodeBounds, const Bounds& centroidBounds,
+               unsigned depth, std::vector<BvhNode>& out) const
+    {
+      size_t node = out.size();
+      BvhNode n;
+      n.min = nodeBounds.minCorner();
+      n.max = nodeBounds.maxCorner();
+      n.offset = static_cast<uint32_t>(begin);
+      n.count = 0;
+      n.axis = 0;
+      out.push_back(n);
+
+      size_t count = end - begin;
+      if (count == 1) {
+        out[node].count = 1;
+        return;
+      }
+
+      // sort the centroids into bins along all three axes in a single pass;
+      // small nodes need fewer bins
+      int binsUsed = static_cast<int>(std::min<size_t>(binCount, count));
+      float extent[4], scales[4];
+      (centroidBounds.hi - centroidBounds.lo).store(extent);
+      // axes too thin for a finite scale (a denormal extent overflows it, and
+      // 0 * inf would make a NaN bin) are treated as flat
+      float minExtent = binsUsed / std::numeric_limits<float>::max();
+      for (int axis = 0; axis < 4; ++axis)
+        scales[axis] = extent[axis] > minExtent ? binsUsed / extent[axis] : 0;
+      Float4 lo = centroidBounds.lo;
+      Float4 scale = Float4::load(scales);
+
+      Bin bins[3][binCount];
+      if (threads > 1 && count >= parallelBinThreshold) {
+        std::vector<Bin> partial(threads * 3 * binCount);
+        size_t chunk = (count + threads - 1) / threads;
+        parallelFor(threads, threads, [&](size_t first, size_t last) {
+          for (size_t k = first; k < last; ++k) {
+            Bin (*local)[binCount] = reinterpret_cast<Bin (*)[binCount]>(&partial[k * 3 * binCount]);
+            size_t from = std::min(end, begin + k * chunk);
+            fillBins(from, std::min(end, from + chunk), lo, scale, binsUsed, local);
+          }
+        }, 1);
+        resetBins(binsUsed, bins);
+        for (size_t k = 0; k < threads; ++k) {
+          for (int axis = 0; axis < 3; ++axis) {
+            for (int b = 0; b < binsUsed; ++b)
+              bins[axis][b].extend(partial[(k * 3 + axis) * binCount + b]);
+          }
+        }
+      } else {
+        fillBins(begin, end, lo, scale, binsUsed, bins);
+      }
+
+      // evaluate the SAH cost at every bin boundary
+      int bestAxis = -1;
+      int bestBin = 0;
+      float bestCost = std::numeric_limits<float>::infinity();
+      for (int axis = 0; axis < 3; ++axis) {
+        if (scales[axis] == 0)
+          continue;
+
+        // right-to-left sweep stores the cost terms of the right halves
+        float rightCost[binCount];
+        Bin right;
+        right.reset();
+        for (int b = binsUsed - 1; b > 0; --b) {
+          right.extend(bins[axis][b]);
+          rightCost[b] = right.count ? right.bounds.area() * right.count : 0;
+        }
+
+        Bin left;
+        left.reset();
+        for (int b = 0; b < binsUsed - 1; ++b) {
+          left.extend(bins[axis][b]);
+          if (left.count == 0 || left.count == count)
+            continue;
+          float cost = left.bounds.area() * left.count + rightCost[b + 1];
+          if (cost < bestCost) {
+            bestCost = cost;
+            bestAxis = axis;
+            bestBin = b;
+          }
+        }
+      }
+
+      // relative costs: traversing a node = 1, intersecting a triangle = 1
+      float leafCost = static_cast<float>(count);
+      float splitCost = 1 + bestCost / nodeBounds.area();
+      if (count <= static_cast<size_t>(Bvh::maxLeafSize) && (bestAxis < 0 || leafCost <= splitCost)) {
+        out[node].count = static_cast<uint16_t>(count);
+        return;
+      }
+
+      size_t mid;
+      Bin first, second;
+      first.reset();
+      second.reset();
+      if (bestAxis < 0 || depth >= sahDepth) {
+        // all centroids coincide (any split is as good as another), or the
+        // tree is getting too deep
+        mid = begin + count / 2;
+        for (size_t i = begin; i < end; ++i) {
+          Bin& b = i < mid ? first : second;
+          b.bounds.extend(records[i].bounds);
+          b.centroids.extend(records[i].centroid());
+        }
+      } else {
+        int axis = bestAxis;
+        int split = bestBin;
+        mid = std::partition(records + begin, records + end, [=](const Record& r) {
+          int b[3];
+          Builder::bins(r.centroid(), lo, scale, binsUsed - 1, b);
+          return b[axis] <= split;
+        }) - records;
+        for (int b = 0; b < binsUsed; ++b)
+          (b <= bestBin ? first : second).extend(bins[bestAxis][b]);
+        out[node].axis = static_cast<uint16_t>(bestAxis);
+      }
+
+      if (depth < spawnDepth && count >= parallelThreshold) {
+        // build the second subtree on another thread, then append it
+        std::vector<BvhNode> nodes;
+        std::thread worker([&]() {
+          build(mid, end, second.bounds, second.centroids, depth + 1, nodes);
+        });
+        build(begin, mid, first.bounds, first.centroids, depth + 1, out);
+        worker.join();
+
+        uint32_t base = static_cast<uint32_t>(out.size());
+        for (size_t i = 0; i < nodes.size(); ++i) {
+          if (!nodes[i].isLeaf())
+            nodes[i].offset += base;
+        }
+        out[node].offset = base;
+        out.insert(out.end(), nodes.begin(), nodes.end());
+      } else {
+        build(begin, mid, first.bounds, first.centroids, depth + 1, out);
+        out[node].offset = static_cast<uint32_t>(out.size());
+        build(mid, end, second.bounds, second.centroids, depth + 1, out);
+      }
+    }
+  };
+}
+
+void Bvh::build(const ObjModel& model, unsigned threads)
+{
+  build(model.vertices.empty() ? NULL : &model.vertices[0].position, sizeof(ObjVertex),
+        model.indices.empty() ? NULL : &model.indices[0], model.indices.size() / 3, threads);
+}
+
+void Bvh::build(const void* positions, size_t stride, const int* indices,
+                size_t triangleCount, unsigned threads)
+{
+  nodes_.clear();
+  triangles_.clear();
+  if (triangleCount == 0)
+    return;
+
+  if (threads == 0)
+    threads = hardwareThreads();
+
+  const char* p = static_cast<const char*>(positions);
+  std::vector<Record> records(triangleCount);
+  parallelFor(triangleCount, threads, [&](size_t begin, size_t end) {
+    for (size_t t = begin; t < end; ++t) {
+      records[t].bounds = triangleBounds(p, stride, indices, static_cast<uint32_t>(t));
+      records[t].triangle = static_cast<uint32_t>(t);
+    }
+  });
+
+  Bounds bounds = Bounds::empty();
+  Bounds centroids = Bounds::empty();
+  for (size_t t = 0; t < triangleCount; ++t) {
+    bounds.extend(records[t].bounds);
+    centroids.extend(records[t].centroid());
+  }
+
+  // enough spawning levels to keep every thread busy despite uneven splits
+  unsigned spawnDepth = 0;
+  while (threads > 1 && (1u << spawnDepth) < threads * 4)
+    ++spawnDepth;
+
+  Builder builder = { &records[0], spawnDepth, threads };
+  builder.build(0, triangleCount, bounds, centroids, 0, nodes_);
+
+  triangles_.resize(triangleCount);
+  for (size_t t = 0; t < triangleCount; ++t)
+    triangles_[t] = records[t].triangle;
+}
+
+void Bvh::refit(const ObjModel& model)
+{
+  refit(model.vertices.empty() ? NULL : &model.vertices[0].position, sizeof(ObjVertex),
+        model.indices.empty() ? NULL : &model.indices[0]);
+}
+
+void Bvh::refit(const void* positions, size_t stride, const int* indices)
+{
+  // children follow their parents, so a reverse sweep visits them first
+  const char* p = static_cast<const char*>(positions);
+  for (size_t i = nodes_.size(); i-- > 0;) {
+    BvhNode& node = nodes_[i];
+    Bounds b = Bounds::empty();
+    if (node.isLeaf()) {
+      for (uint32_t k = 0; k < node.count; ++k)
+        b.extend(triangleBounds(p, stride, indices, triangles_[node.offset + k]));
+    } else {
+      const BvhNode& first = nodes_[i + 1];
+      const BvhNode& second = nodes_[node.offset];
+      b.extend(point(first.min));
+      b.extend(point(first.max));
+      b.extend(point(second.min));
+      b.extend(point(second.max));
+    }
+    node.min = b.minCorner();
+    node.max = b.maxCorner();
+  }
+}
@@ -0,0 +1,86 @@
+#ifndef CGL_BVH_H_
+#define CGL_BVH_H_
+
+#include <stdint.h>
+#include <vector>
+#include "math/cgl_math.h"
+#include "obj_loader.h"
+
+namespace cgl
+{
+
+  /// A node of a flattened BVH (32 bytes, two per cache line). Nodes are
+  /// stored in depth-first order, so the first child of an interior node is
+  /// the next node in the array.
+  struct BvhNode
+  {
+    /// Minimum corner of the node bounds.
+    cgl::Vec3 min;
+
+    /// Leaf: index of the first triangle in Bvh::triangles().
+    /// Interior: index of the second child.
+    uint32_t offset;
+
+    /// Maximum corner of the node bounds.
+    cgl::Vec3 max;
+
+    /// Number of triangles in a leaf; 0 for interior nodes.
+    uint16_t count;
+
+    /// Axis (0 = X, 1 = Y, 2 = Z) an interior node was split along.
+    uint16_t axis;
+
+    bool isLeaf() const { return count > 0; }
+  };
+
+  /// Bounding volume hierarchy over the triangles of an indexed mesh, built
+  /// top-down with binned surface area heuristic (SAH) splits.
+  class Bvh
+  {
+  public:
+
+    /// Largest number of triangles in a leaf.
+    static const int maxLeafSize = 8;
+
+    /// No node is deeper than this (the root has depth 0), so traversal
+    /// code can use a fixed-size stack.
+    static const int maxDepth = 96;
+
+    /// Builds the hierarchy over the triangles of model. Subtrees are built
+    /// in parallel on up to threads threads (0 = one per hardware thread).
+    void build(const ObjModel& model, unsigned threads = 0);
+
+    /// Builds the hierarchy over triangleCount triangles given by three
+    /// vertex indices each. positions points at the first float of the first
+    /// vertex position, and each following position starts stride bytes
+    /// after the previous one.
+    void build(const void* positions, size_t stride, const int* indices,
+               size_t triangleCount, unsigned threads = 0);
+
+    /// Recomputes the node bounds after the vertices of model moved, keeping
+    /// the tree topology. The indices must be the ones the tree was built
+    /// with. Cheaper than a rebuild, but the tree degrades if the vertices
+    /// move far.
+    void refit(const ObjModel& model);
+
+    /// Recomputes the node bounds after the positions moved (see build()).
+    void refit(const void* positions, size_t stride, const int* indices);
+
+    /// Returns the nodes in depth-first order; the root is nodes()[0].
+    const std::vector<BvhNode>& nodes() const { return nodes_; }
+
+    /// Returns the triangle indices referenced by the leaves; triangle t
+    /// has the vertex indices indices[3 * t .. 3 * t + 2].
+    const std::vector<uint32_t>& triangles() const { return triangles_; }
+
+    /// Returns true if the hierarchy contains no triangles.
+    bool empty() const { return nodes_.empty(); }
+
+  private:
+    std::vector<BvhNode> nodes_;
+    std::vector<uint32_t> triangles_;
+  };
+
+}
+
+#endif
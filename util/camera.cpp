@@ -5,6 +5,11 @@ using namespace cgl;
 Camera::Camera()
 {}
 
+Frustum Camera::frustum() const
+{
+  return Frustum(projection_ * view_);
+}
+
 const Vec3& Camera::eye() const
 {
   return eye_;
@@ -131,7 +136,7 @@ void Camera::update()
 void Camera::setView(const Mat4& view)
 {
   view_ = view;
-  viewInverse_ = view.inverse();
+  viewInverse_ = view.inverseFast();
   update();
 }
 
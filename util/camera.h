@@ -2,6 +2,7 @@
 #define CGL_CAMERA_H_
 
 #include "math/cgl_math.h"
+#include "math/frustum.h"
 
 namespace cgl
 {
@@ -18,6 +19,9 @@ public:
   /// Returns the projection matrix.
   const Mat4& projection() const;
 
+  /// Returns the view frustum (projection * view) in world coordinates.
+  Frustum frustum() const;
+
   /// Returns the eye position in world coordinates; origin in eye coordinates.
   const Vec3& eye() const;
 
@@ -0,0 +1,126 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace cgl;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() : data_(NULL), size_(0), file_(INVALID_HANDLE_VALUE), mapping_(NULL)
+{
+}
+
+bool MappedFile::open(const char* fileName)
+{
+  close();
+  file_ = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                      FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file_ == INVALID_HANDLE_VALUE)
+    return false;
+  
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file_, &size)) {
+    close();
+    return false;
+  }
+  size_ = static_cast<size_t>(size.QuadPart);
+  if (size_ == 0)
+    return true;
+  
+  mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping_)
+    data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+  if (!data_) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void MappedFile::discard(size_t, size_t)
+{
+  // the working set is trimmed by the OS as needed
+}
+
+void MappedFile::close()
+{
+  if (data_)
+    UnmapViewOfFile(data_);
+  if (mapping_)
+    CloseHandle(mapping_);
+  if (file_ != INVALID_HANDLE_VALUE)
+    CloseHandle(file_);
+  data_ = NULL;
+  size_ = 0;
+  file_ = INVALID_HANDLE_VALUE;
+  mapping_ = NULL;
+}
+
+#else
+
+MappedFile::MappedFile() : data_(NULL), size_(0)
+{
+}
+
+bool MappedFile::open(const char* fileName)
+{
+  close();
+  int fd = ::open(fileName, O_RDONLY);
+  if (fd < 0)
+    return false;
+  
+  struct stat info;
+  if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+    ::close(fd);
+    return false;
+  }
+  
+  // the mapping stays valid after the descriptor is closed
+  bool ok = true;
+  if (info.st_size > 0) {
+    void* p = mmap(NULL, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      ok = false;
+    } else {
+      data_ = static_cast<const char*>(p);
+      size_ = static_cast<size_t>(info.st_size);
+      madvise(p, size_, MADV_SEQUENTIAL);
+    }
+  }
+  ::close(fd);
+  return ok;
+}
+
+void MappedFile::discard(size_t offset, size_t length)
+{
+  // only whole pages inside the range
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t begin = (offset + page - 1) / page * page;
+  size_t end = (offset + length) / page * page;
+  if (data_ && begin < end)
+    madvise(const_cast<char*>(data_) + begin, end - begin, MADV_DONTNEED);
+}
+
+void MappedFile::close()
+{
+  if (data_)
+    munmap(const_cast<char*>(data_), size_);
+  data_ = NULL;
+  size_ = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+  close();
+}
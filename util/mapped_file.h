@@ -0,0 +1,48 @@
+#ifndef CGL_MAPPED_FILE_H_
+#define CGL_MAPPED_FILE_H_
+
+#include <cstddef>
+
+namespace cgl
+{
+  
+  /// Read-only memory mapping of a whole file. The contents are paged in by
+  /// the OS as they are touched, so nothing is copied up front.
+  class MappedFile
+  {
+  public:
+    MappedFile();
+    ~MappedFile();
+    
+    /// Maps the file, replacing any previous mapping. Returns false if the
+    /// file cannot be opened or mapped.
+    bool open(const char* fileName);
+    
+    /// Unmaps the file.
+    void close();
+    
+    /// First byte of the file (NULL if none is mapped or it is empty).
+    const char* data() const { return data_; }
+    
+    /// Size of the file in bytes.
+    size_t size() const { return size_; }
+    
+    /// Tells the OS that the bytes [offset, offset + length) will not be read
+    /// again, so the pages they fill can be dropped from memory.
+    void discard(size_t offset, size_t length);
+    
+  private:
+    const char* data_;
+    size_t size_;
+#ifdef _WIN32
+    void* file_;
+    void* mapping_;
+#endif
+    
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+  };
+  
+}
+
+#endif
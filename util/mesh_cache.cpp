@@ -0,0 +1,244 @@
+#include "mesh_cache.h"
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "math/parallel.h"
+
+using namespace cgl;
+
+const uint32_t MeshCache::version;
+
+namespace
+{
+  const char magic[4] = { 'C', 'G', 'L', 'M' };
+  const size_t hashBlock = 1 << 20;
+
+  inline uint64_t mix(uint64_t h)
+  {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+  }
+
+  // Hashes one block 8 bytes at a time in four independent lanes.
+  uint64_t hashBlockBytes(const char* p, size_t n, uint64_t seed)
+  {
+    const uint64_t prime = 0x9e3779b97f4a7c15ull;
+    uint64_t h[4] = { seed, seed ^ 1, seed ^ 2, seed ^ 3 };
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+      for (int k = 0; k < 4; ++k) {
+        uint64_t w;
+        std::memcpy(&w, p + i + 8 * k, 8);
+        h[k] = (h[k] ^ w) * prime;
+        h[k] ^= h[k] >> 29;
+      }
+    }
+    uint64_t tail = 0;
+    for (size_t k = 0; i < n; ++i, ++k)
+      tail ^= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * (k & 7));
+    return mix(h[0] ^ mix(h[1] ^ mix(h[2] ^ mix(h[3] ^ tail ^ n))));
+  }
+
+  inline size_t alignUp(size_t n, size_t alignment)
+  {
+    return (n + alignment - 1) / alignment * alignment;
+  }
+
+  // Creates a temporary file next to fileName for one writer. The name holds
+  // the process id and a counter shared by the threads of the process, and
+  // the file is created exclusively, so concurrent writers never open the
+  // same file; names left behind by a crashed process are skipped.
+  FILE* createTemp(const char* fileName, std::string* temp)
+  {
+    static std::atomic<unsigned> counter(0);
+    for (int attempt = 0; attempt < 100; ++attempt) {
+      char suffix[48];
+#ifdef _WIN32
+      std::snprintf(suffix, sizeof(suffix), ".%d.%u.tmp", _getpid(), counter++);
+      *temp = std::string(fileName) + suffix;
+      int fd = _open(temp->c_str(), _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+      std::snprintf(suffix, sizeof(suffix), ".%ld.%u.tmp", static_cast<long>(getpid()), counter++);
+      *temp = std::string(fileName) + suffix;
+      int fd = open(temp->c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+#endif
+      if (fd >= 0) {
+#ifdef _WIN32
+        FILE* f = _fdopen(fd, "wb");
+        if (!f)
+          _close(fd);
+#else
+        FILE* f = fdopen(fd, "wb");
+        if (!f)
+          close(fd);
+#endif
+        if (!f)
+          std::remove(temp->c_str());
+        return f;
+      }
+      if (errno != EEXIST)
+        return NULL;
+    }
+    return NULL;
+  }
+}
+
+bool cgl::fileStatus(const char* fileName, uint64_t* size, int64_t* time)
+{
+#ifdef _WIN32
+  struct _stat64 info;
+  if (_stat64(fileName, &info) != 0)
+    return false;
+#else
+  struct stat info;
+  if (stat(fileName, &info) != 0)
+    return false;
+#endif
+  *size = static_cast<uint64_t>(info.st_size);
+  *time = static_cast<int64_t>(info.st_mtime);
+  return true;
+}
+
+uint64_t cgl::hashBytes(const char* data, size_t n, unsigned threads)
+{
+  size_t blocks = (n + hashBlock - 1) / hashBlock;
+  std::vector<uint64_t> hashes(blocks);
+  parallelFor(blocks, threads, [&](size_t begin, size_t end) {
+    for (size_t b = begin; b < end; ++b) {
+      size_t offset = b * hashBlock;
+      hashes[b] = hashBlockBytes(data + offset, std::min(hashBlock, n - offset), b);
+    }
+  }, 1);
+
+  uint64_t h = mix(n);
+  for (size_t b = 0; b < blocks; ++b)
+    h = mix(h ^ hashes[b]) + b;
+  return h;
+}
+
+MeshCache::MeshCache() : header_(NULL)
+{
+}
+
+bool MeshCache::open(const char* fileName)
+{
+  close();
+  if (!file_.open(fileName))
+    return false;
+
+  // check everything the accessors rely on
+  const MeshCacheHeader* h = reinterpret_cast<const MeshCacheHeader*>(file_.data());
+  size_t size = file_.size();
+  bool valid = size >= sizeof(MeshCacheHeader) &&
+    std::memcmp(h->magic, magic, sizeof(magic)) == 0 &&
+    h->version == version &&
+    h->vertexSize == sizeof(ObjVertex) &&
+    h->vertexOffset % 16 == 0 && h->indexOffset % 4 == 0 &&
+    h->vertexOffset <= size && h->vertexCount <= (size - h->vertexOffset) / sizeof(ObjVertex) &&
+    h->indexOffset <= size && h->indexCount <= (size - h->indexOffset) / sizeof(uint32_t);
+  if (!valid) {
+    file_.close();
+    return false;
+  }
+  header_ = h;
+  return true;
+}
+
+void MeshCache::close()
+{
+  file_.close();
+  header_ = NULL;
+}
+
+const ObjVertex* MeshCache::vertices() const
+{
+  return reinterpret_cast<const ObjVertex*>(file_.data() + header_->vertexOffset);
+}
+
+const uint32_t* MeshCache::indices() const
+{
+  return reinterpret_cast<const uint32_t*>(file_.data() + header_->indexOffset);
+}
+
+void MeshCache::copyTo(ObjModel* model) const
+{
+  model->vertices.assign(vertices(), vertices() + vertexCount());
+  model->indices.assign(indices(), indices() + indexCount());
+  model->min = min();
+  model->max = max();
+  model->textured = textured();
+}
+
+bool MeshCache::matches(const MeshSource& source) const
+{
+  return header_ && header_->hasSource &&
+    header_->source.size == source.size &&
+    header_->source.time == source.time &&
+    header_->source.hash == source.hash;
+}
+
+bool MeshCache::write(const char* fileName, const ObjModel& model, const MeshSource* source)
+{
+  MeshCacheHeader h;
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, magic, sizeof(magic));
+  h.version = version;
+  h.vertexSize = sizeof(ObjVertex);
+  h.textured = model.textured ? 1 : 0;
+  h.vertexCount = model.vertices.size();
+  h.indexCount = model.indices.size();
+  h.vertexOffset = alignUp(sizeof(MeshCacheHeader), 64);
+  h.indexOffset = alignUp(h.vertexOffset + h.vertexCount * sizeof(ObjVertex), 64);
+  for (int i = 0; i < 3; ++i) {
+    h.min[i] = model.min[i];
+    h.max[i] = model.max[i];
+  }
+
+  if (source) {
+    h.hasSource = 1;
+    h.source = *source;
+  }
+
+  std::string temp;
+  FILE* f = createTemp(fileName, &temp);
+  if (!f)
+    return false;
+
+  static const char zeros[64] = { 0 };
+  size_t vertexBytes = model.vertices.size() * sizeof(ObjVertex);
+  size_t indexBytes = model.indices.size() * sizeof(int);
+  bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1 &&
+    std::fwrite(zeros, 1, h.vertexOffset - sizeof(h), f) == h.vertexOffset - sizeof(h) &&
+    (!vertexBytes || std::fwrite(&model.vertices[0], 1, vertexBytes, f) == vertexBytes) &&
+    std::fwrite(zeros, 1, h.indexOffset - h.vertexOffset - vertexBytes, f) ==
+      h.indexOffset - h.vertexOffset - vertexBytes &&
+    (!indexBytes || std::fwrite(&model.indices[0], 1, indexBytes, f) == indexBytes);
+  ok = std::fclose(f) == 0 && ok;
+
+  if (ok) {
+#ifdef _WIN32
+    // rename() does not replace an existing file on Windows
+    std::remove(fileName);
+#endif
+    ok = std::rename(temp.c_str(), fileName) == 0;
+  }
+  if (!ok)
+    std::remove(temp.c_str());
+  return ok;
+}
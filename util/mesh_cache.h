@@ -0,0 +1,107 @@
+#ifndef CGL_MESH_CACHE_H_
+#define CGL_MESH_CACHE_H_
+
+#include <stdint.h>
+#include "math/cgl_math.h"
+#include "mapped_file.h"
+#include "obj_loader.h"
+
+namespace cgl
+{
+
+  /// Identifies the contents of the source file of a cached mesh. The time
+  /// only has a resolution of seconds, so the hash of the contents is what
+  /// catches a file rewritten with the same size within a second.
+  struct MeshSource
+  {
+    uint64_t size;
+    int64_t time;            // modification time in seconds
+    uint64_t hash;           // hashBytes() of the contents
+  };
+
+  /// Header of a mesh cache file. It is followed by the vertices (ObjVertex,
+  /// interleaved, 32 bytes each) at vertexOffset and the indices (uint32) at
+  /// indexOffset, so both can be handed to glBufferData as they are. All
+  /// values are in the byte order of the machine that wrote the file.
+  struct MeshCacheHeader
+  {
+    char magic[4];           // "CGLM"
+    uint32_t version;        // MeshCache::version
+    uint32_t vertexSize;     // sizeof(ObjVertex)
+    uint32_t textured;       // ObjModel::textured
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    float min[3];
+    float max[3];
+    uint32_t hasSource;      // source is set
+    uint32_t padding;
+    MeshSource source;       // the file the mesh was loaded from
+  };
+
+  /// Read-only view of a mesh cache file. open() maps the file and checks
+  /// the header; the vertices and indices are then read straight from the
+  /// mapping, without parsing or copying.
+  class MeshCache
+  {
+  public:
+
+    /// Version of the format written by write(); files of other versions are
+    /// rejected by open().
+    static const uint32_t version = 1;
+
+    MeshCache();
+
+    /// Maps a cache file. Returns false if it cannot be read, is not a cache
+    /// file of this version and machine, or is truncated.
+    bool open(const char* fileName);
+
+    /// Unmaps the file.
+    void close();
+
+    /// Returns true if a cache file is open.
+    bool isOpen() const { return header_ != NULL; }
+
+    /// Header of the open file.
+    const MeshCacheHeader& header() const { return *header_; }
+
+    const ObjVertex* vertices() const;
+    size_t vertexCount() const { return static_cast<size_t>(header_->vertexCount); }
+    const uint32_t* indices() const;
+    size_t indexCount() const { return static_cast<size_t>(header_->indexCount); }
+    cgl::Vec3 min() const { return cgl::Vec3(header_->min); }
+    cgl::Vec3 max() const { return cgl::Vec3(header_->max); }
+    bool textured() const { return header_->textured != 0; }
+
+    /// Copies the mesh into model.
+    void copyTo(ObjModel* model) const;
+
+    /// Returns true if the cache was written from the given source: same
+    /// size, modification time and hash.
+    bool matches(const MeshSource& source) const;
+
+    /// Writes model to a cache file, recording source (if not NULL) as where
+    /// it came from. The file is written under a temporary name of its own
+    /// and renamed, so readers never see a partial file and concurrent
+    /// writers of the same cache do not clobber each other; the last rename
+    /// wins. Returns false on failure.
+    static bool write(const char* fileName, const ObjModel& model, const MeshSource* source = NULL);
+
+  private:
+    MappedFile file_;
+    const MeshCacheHeader* header_;
+  };
+
+  /// Returns the size and modification time (in seconds) of a file, or false
+  /// if it does not exist.
+  bool fileStatus(const char* fileName, uint64_t* size, int64_t* time);
+
+  /// 64-bit hash of n bytes. The data is hashed in 1 MB blocks, up to threads
+  /// at once (0 = one per hardware thread); the result does not depend on
+  /// threads.
+  uint64_t hashBytes(const char* data, size_t n, unsigned threads = 1);
+
+}
+
+#endif
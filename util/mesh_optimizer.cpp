@@ -0,0 +1,227 @@
+#include "mesh_optimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace cgl;
+
+namespace
+{
+  // Size of the LRU cache that optimizeVertexCache() models.
+  const int cacheSize = 32;
+
+  // Valences above this get the score of this one.
+  const int maxValence = 32;
+
+  // Bytes per line and lines in the fetch cache of analyzeVertexCache().
+  const size_t lineSize = 64;
+  const size_t fetchLines = 64;
+
+  // Vertex scores of Forsyth's algorithm by cache position (the last entry
+  // is for vertices not in the cache) and by the number of triangles left to
+  // draw.
+  struct ScoreTables
+  {
+    float cache[cacheSize + 1];
+    float valence[maxValence + 1];
+
+    ScoreTables()
+    {
+      // the three vertices of the last triangle score the same, since the
+      // next triangle should share two of them whatever their order
+      for (int i = 0; i < cacheSize; ++i)
+        cache[i] = i < 3 ? 0.75f : std::pow(1.0f - (i - 3) / float(cacheSize - 3), 1.5f);
+      cache[cacheSize] = 0.0f;
+
+      // vertices with few triangles left are finished first, so they do not
+      // have to be transformed again later
+      valence[0] = 0.0f;
+      for (int i = 1; i <= maxValence; ++i)
+        valence[i] = 2.0f / std::sqrt(float(i));
+    }
+  };
+
+  const ScoreTables scores;
+
+  inline float vertexScore(int position, int valence)
+  {
+    if (valence == 0)
+      return -1.0f;
+    return scores.cache[position < 0 ? cacheSize : position] + scores.valence[std::min(valence, maxValence)];
+  }
+}
+
+VertexCacheStats cgl::analyzeVertexCache(const int* indices, size_t indexCount, size_t vertexCount,
+                                         size_t vertexSize, unsigned cacheSize)
+{
+  VertexCacheStats stats = { 0, 0, 0 };
+  if (indexCount < 3 || vertexCount == 0)
+    return stats;
+
+  // a vertex or line is cached if it was loaded within the last cacheSize
+  // (or fetchLines) misses, which is how a FIFO behaves
+  std::vector<size_t> loaded(vertexCount, 0);
+  size_t lines = (vertexCount * vertexSize + lineSize - 1) / lineSize;
+  std::vector<size_t> lineLoaded(lines, 0);
+  size_t misses = 0, lineMisses = 0, used = 0;
+  for (size_t i = 0; i < indexCount; ++i) {
+    size_t v = static_cast<size_t>(indices[i]);
+    if (loaded[v] && misses + 1 - loaded[v] <= cacheSize)
+      continue;
+    used += loaded[v] == 0;
+    loaded[v] = ++misses;
+
+    size_t first = v * vertexSize / lineSize, last = ((v + 1) * vertexSize - 1) / lineSize;
+    for (size_t line = first; line <= last; ++line) {
+      if (lineLoaded[line] && lineMisses + 1 - lineLoaded[line] <= fetchLines)
+        continue;
+      lineLoaded[line] = ++lineMisses;
+    }
+  }
+
+  stats.acmr = float(misses) / float(indexCount / 3);
+  stats.atvr = float(misses) / float(used);
+  stats.overfetch = float(lineMisses * lineSize) / float(used * vertexSize);
+  return stats;
+}
+
+VertexCacheStats cgl::analyzeVertexCache(const ObjModel& model, unsigned cacheSize)
+{
+  return analyzeVertexCache(model.indices.empty() ? NULL : &model.indices[0], model.indices.size(),
+                            model.vertices.size(), sizeof(ObjVertex), cacheSize);
+}
+
+void cgl::optimizeVertexCache(int* indices, size_t indexCount, size_t vertexCount)
+{
+  size_t triangles = indexCount / 3;
+  if (triangles == 0)
+    return;
+
+  // triangles of each vertex; the first valence[v] entries from
+  // first[v] are those not drawn yet
+  std::vector<int> valence(vertexCount, 0);
+  for (size_t i = 0; i < triangles * 3; ++i)
+    ++valence[indices[i]];
+  std::vector<size_t> first(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; ++v)
+    first[v + 1] = first[v] + valence[v];
+  std::vector<int> adjacency(triangles * 3);
+  {
+    std::vector<size_t> fill(first.begin(), first.end() - 1);
+    for (size_t i = 0; i < triangles * 3; ++i)
+      adjacency[fill[indices[i]]++] = static_cast<int>(i / 3);
+  }
+
+  std::vector<float> vertexScores(vertexCount);
+  for (size_t v = 0; v < vertexCount; ++v)
+    vertexScores[v] = vertexScore(-1, valence[v]);
+
+  // triangles are scored as the sum of their vertex scores when they are
+  // candidates, which is cheaper than keeping all scores up to date
+  int best = 0;
+  float bestScore = -1.0f;
+  for (size_t t = 0; t < triangles; ++t) {
+    const int* tri = indices + 3 * t;
+    float score = vertexScores[tri[0]] + vertexScores[tri[1]] + vertexScores[tri[2]];
+    if (score > bestScore) {
+      best = static_cast<int>(t);
+      bestScore = score;
+    }
+  }
+
+  std::vector<int> result(triangles * 3);
+  std::vector<char> drawn(triangles, 0);
+  size_t next = 0;
+  int cache[cacheSize + 3];
+  int cached = 0;
+  for (size_t out = 0; out < triangles; ++out) {
+    // if no cached vertex has triangles left, take the next one not drawn
+    if (best < 0) {
+      while (drawn[next])
+        ++next;
+      best = static_cast<int>(next);
+    }
+
+    const int* tri = indices + 3 * best;
+    std::copy(tri, tri + 3, &result[3 * out]);
+    drawn[best] = 1;
+    for (int k = 0; k < 3; ++k) {
+      int v = tri[k];
+      int* list = &adjacency[first[v]];
+      *std::find(list, list + valence[v], best) = list[--valence[v]];
+    }
+
+    // move the triangle's vertices to the front of the cache; the vertices
+    // pushed past cacheSize drop out of it
+    int updated[cacheSize + 3];
+    int front = 0;
+    for (int k = 0; k < 3; ++k) {
+      if (std::find(updated, updated + front, tri[k]) == updated + front)
+        updated[front++] = tri[k];
+    }
+    int count = front;
+    for (int i = 0; i < cached; ++i) {
+      if (std::find(updated, updated + front, cache[i]) == updated + front)
+        updated[count++] = cache[i];
+    }
+
+    // rescore the vertices whose position or valence changed
+    for (int i = 0; i < count; ++i) {
+      int v = updated[i];
+      vertexScores[v] = vertexScore(i < cacheSize ? i : -1, valence[v]);
+      if (i < cacheSize)
+        cache[i] = v;
+    }
+    cached = std::min(count, cacheSize);
+
+    // the best triangle left is one of the cached vertices
+    best = -1;
+    bestScore = -1.0f;
+    for (int i = 0; i < cached; ++i) {
+      int v = cache[i];
+      const int* list = &adjacency[first[v]];
+      for (int j = 0; j < valence[v]; ++j) {
+        const int* candidate = indices + 3 * list[j];
+        float score = vertexScores[candidate[0]] + vertexScores[candidate[1]] + vertexScores[candidate[2]];
+        if (score > bestScore) {
+          best = list[j];
+          bestScore = score;
+        }
+      }
+    }
+  }
+
+  std::copy(result.begin(), result.end(), indices);
+}
+
+void cgl::optimizeVertexFetch(ObjModel* model)
+{
+  size_t n = model->vertices.size();
+  std::vector<int> remap(n, -1);
+  std::vector<ObjVertex> vertices(n);
+  int next = 0;
+  for (size_t i = 0; i < model->indices.size(); ++i) {
+    int& index = model->indices[i];
+    if (remap[index] < 0) {
+      remap[index] = next;
+      vertices[next++] = model->vertices[index];
+    }
+    index = remap[index];
+  }
+  for (size_t v = 0; v < n; ++v) {
+    if (remap[v] < 0)
+      vertices[next++] = model->vertices[v];
+  }
+  model->vertices.swap(vertices);
+}
+
+void cgl::optimizeMesh(ObjModel* model, VertexCacheStats* before, VertexCacheStats* after)
+{
+  if (before)
+    *before = analyzeVertexCache(*model);
+  if (!model->indices.empty())
+    optimizeVertexCache(&model->indices[0], model->indices.size(), model->vertices.size());
+  optimizeVertexFetch(model);
+  if (after)
+    *after = analyzeVertexCache(*model);
+}
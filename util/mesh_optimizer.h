@@ -0,0 +1,57 @@
+#ifndef CGL_MESH_OPTIMIZER_H_
+#define CGL_MESH_OPTIMIZER_H_
+
+#include <cstddef>
+#include "obj_loader.h"
+
+namespace cgl
+{
+
+  /// How well an index buffer uses the post-transform vertex cache and the
+  /// memory bandwidth of vertex fetch.
+  struct VertexCacheStats
+  {
+    /// Average cache miss ratio: vertices transformed per triangle. 3 means
+    /// no reuse at all; a regular grid reaches about 0.5 at best.
+    float acmr;
+
+    /// Average transform to vertex ratio: vertices transformed per vertex
+    /// used. 1 is the best possible.
+    float atvr;
+
+    /// Bytes of vertex data read from memory per byte used. 1 is the best
+    /// possible.
+    float overfetch;
+  };
+
+  /// Simulates drawing a triangle list through a FIFO post-transform cache
+  /// of cacheSize vertices, the model of most GPUs, with each transformed
+  /// vertex read in 64-byte lines through a FIFO cache of 64 lines.
+  /// vertexSize is the stride of the vertices in bytes.
+  VertexCacheStats analyzeVertexCache(const int* indices, size_t indexCount, size_t vertexCount,
+                                      size_t vertexSize, unsigned cacheSize = 16);
+
+  /// Returns the cache statistics of a model's index buffer (see above).
+  VertexCacheStats analyzeVertexCache(const ObjModel& model, unsigned cacheSize = 16);
+
+  /// Reorders the triangles of a triangle list so that consecutive triangles
+  /// share vertices, with Tom Forsyth's "Linear-Speed Vertex Cache
+  /// Optimisation". The algorithm assumes an LRU cache of 32 vertices, but
+  /// works about as well for FIFO caches of any size. The vertices of each
+  /// triangle keep their winding order.
+  void optimizeVertexCache(int* indices, size_t indexCount, size_t vertexCount);
+
+  /// Reorders the vertices of model in the order the indices first use
+  /// them, so the vertex fetch reads memory close to sequentially, and
+  /// remaps the indices to match. Vertices that no index uses are moved to
+  /// the end.
+  void optimizeVertexFetch(ObjModel* model);
+
+  /// Optimizes model for drawing: optimizeVertexCache() and then
+  /// optimizeVertexFetch(). The cache statistics before and after are stored
+  /// in before and after if they are not NULL.
+  void optimizeMesh(ObjModel* model, VertexCacheStats* before = NULL, VertexCacheStats* after = NULL);
+
+}
+
+#endif
@@ -0,0 +1,475 @@
+#include "mesh_simplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include "camera.h"
+
+using namespace cgl;
+
+namespace
+{
+  // Weight of the planes that keep borders and seams in place, relative to
+  // the planes of the faces.
+  const double edgeWeight = 10.0;
+
+  // Cosine of the largest angle a triangle may turn by in a collapse. Small
+  // turns are common on curved surfaces, but a triangle that turns sideways
+  // is about to fold. Triangles of zero area before or after never pass,
+  // since their direction is unknown.
+  const float maxTurn = 0.25f;
+
+  // Sum of weighted squared distances to planes: p^T A p + 2 b^T p + c, with
+  // the symmetric A stored as its upper triangle.
+  struct Quadric
+  {
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+    double weight;
+
+    // Adds the plane through p with normal n (of any length), weighted by w.
+    void addPlane(const Vec3& p, const Vec3& n, double w)
+    {
+      double length = std::sqrt(double(n.x) * n.x + double(n.y) * n.y + double(n.z) * n.z);
+      if (length == 0 || w == 0)
+        return;
+      double x = n.x / length, y = n.y / length, z = n.z / length;
+      double d = -(x * p.x + y * p.y + z * p.z);
+      a00 += w * x * x; a01 += w * x * y; a02 += w * x * z;
+      a11 += w * y * y; a12 += w * y * z; a22 += w * z * z;
+      b0 += w * x * d; b1 += w * y * d; b2 += w * z * d;
+      c += w * d * d;
+      weight += w;
+    }
+
+    void add(const Quadric& q)
+    {
+      a00 += q.a00; a01 += q.a01; a02 += q.a02;
+      a11 += q.a11; a12 += q.a12; a22 += q.a22;
+      b0 += q.b0; b1 += q.b1; b2 += q.b2;
+      c += q.c;
+      weight += q.weight;
+    }
+
+    // Returns the weighted mean of the squared distances from p to the planes.
+    double error(const Vec3& p) const
+    {
+      if (weight <= 0)
+        return 0;
+      double x = p.x, y = p.y, z = p.z;
+      double e = a00 * x * x + a11 * y * y + a22 * z * z +
+        2 * (a01 * x * y + a02 * x * z + a12 * y * z + b0 * x + b1 * y + b2 * z) + c;
+      return std::max(e, 0.0) / weight;
+    }
+  };
+
+  // Moving position from onto position to, at the given squared error.
+  struct Collapse
+  {
+    double cost;
+    int from;
+    int to;
+
+    bool operator<(const Collapse& c) const { return cost < c.cost; }
+  };
+
+  // Simplifies a triangle list in passes. Each pass sorts the possible
+  // collapses by cost and makes as many of the cheapest ones as it can
+  // without two of them touching the same triangles, so the costs and checks
+  // of a pass stay exact without updating them after every collapse.
+  //
+  // Vertices (wedges) are welded by position. A collapse moves all wedges of
+  // one position onto wedges of a neighboring position, and is only allowed
+  // if each wedge has a counterpart across the collapsed edge; this is what
+  // keeps seams together.
+  class Simplifier
+  {
+  public:
+    explicit Simplifier(const ObjModel& model);
+
+    // Collapses edges until at most target triangles are left or every
+    // remaining collapse costs more than maxCost.
+    void run(size_t target, double maxCost);
+
+    size_t triangles() const { return indices_.size() / 3; }
+    float error() const { return static_cast<float>(std::sqrt(cost_)); }
+
+    // Writes the current triangles and the vertices they use to result.
+    void extract(ObjModel* result) const;
+
+  private:
+    // A position next to the one being collapsed, and the edge between them.
+    struct Neighbor
+    {
+      int position;
+      int triangles;       // triangles that share the edge
+      int wedge;           // wedge at the collapsed position in the first triangle
+      int neighborWedge;   // wedge at this position in the first triangle
+      bool seam;           // the triangles have different wedges on the edge
+      bool linked;         // also a neighbor of the target position
+    };
+
+    const ObjModel& model_;
+    std::vector<int> indices_;
+    std::vector<int> position_;          // position of each vertex
+    std::vector<Vec3> points_;           // point of each position
+    std::vector<Quadric> quadrics_;      // of each position
+    double cost_;                        // largest cost collapsed so far
+
+    // triangles around each position, rebuilt every pass
+    std::vector<int> first_;
+    std::vector<int> adjacency_;
+
+    std::vector<char> locked_;
+    std::vector<int> remap_;
+    std::vector<Neighbor> ring_;
+    std::vector<std::pair<int, int> > wedges_;
+
+    bool pass(size_t target, double maxCost);
+    bool canCollapse(int u, int v);
+    int corner(int triangle, int position) const;
+  };
+
+  Simplifier::Simplifier(const ObjModel& model) : model_(model), cost_(0)
+  {
+    // weld the vertices by position
+    size_t n = model.vertices.size();
+    std::vector<int> order(n);
+    for (size_t i = 0; i < n; ++i)
+      order[i] = static_cast<int>(i);
+    const ObjVertex* vertices = n ? &model.vertices[0] : NULL;
+    std::sort(order.begin(), order.end(), [=](int a, int b) {
+      const Vec3& p = vertices[a].position;
+      const Vec3& q = vertices[b].position;
+      return p.x < q.x || (p.x == q.x && (p.y < q.y || (p.y == q.y && p.z < q.z)));
+    });
+    position_.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      const Vec3& p = vertices[order[i]].position;
+      if (points_.empty() || !(points_.back() == p))
+        points_.push_back(p);
+      position_[order[i]] = static_cast<int>(points_.size() - 1);
+    }
+
+    for (size_t i = 0; i + 2 < model.indices.size(); i += 3) {
+      const int* tri = &model.indices[i];
+      int a = position_[tri[0]], b = position_[tri[1]], c = position_[tri[2]];
+      if (a != b && b != c && c != a)
+        indices_.insert(indices_.end(), tri, tri + 3);
+    }
+
+    // the planes of the faces, weighted by area
+    Quadric zero = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    quadrics_.assign(points_.size(), zero);
+    std::vector<Vec3> normals(triangles());
+    for (size_t t = 0; t < triangles(); ++t) {
+      const Vec3& p0 = points_[position_[indices_[3 * t]]];
+      Vec3 n = (points_[position_[indices_[3 * t + 1]]] - p0).cross(points_[position_[indices_[3 * t + 2]]] - p0);
+      normals[t] = n;
+      double area = 0.5 * n.length();
+      for (int k = 0; k < 3; ++k)
+        quadrics_[position_[indices_[3 * t + k]]].addPlane(p0, n, area);
+    }
+
+    // planes through the border and seam edges, perpendicular to their faces,
+    // which keep those edges from moving sideways
+    std::unordered_map<uint64_t, size_t> halfEdges;
+    halfEdges.reserve(indices_.size());
+    for (size_t i = 0; i < indices_.size(); ++i) {
+      size_t j = i - i % 3 + (i + 1) % 3;
+      uint64_t key = uint64_t(position_[indices_[i]]) << 32 | uint32_t(position_[indices_[j]]);
+      halfEdges.insert(std::make_pair(key, i));
+    }
+    for (size_t i = 0; i < indices_.size(); ++i) {
+      size_t j = i - i % 3 + (i + 1) % 3;
+      int a = position_[indices_[i]], b = position_[indices_[j]];
+      std::unordered_map<uint64_t, size_t>::const_iterator twin =
+        halfEdges.find(uint64_t(b) << 32 | uint32_t(a));
+      if (twin != halfEdges.end()) {
+        size_t ti = twin->second, tj = ti - ti % 3 + (ti + 1) % 3;
+        bool seam = indices_[i] != indices_[tj] || indices_[j] != indices_[ti];
+        if (!seam || a > b)
+          continue;
+      }
+      Vec3 edge = points_[b] - points_[a];
+      Vec3 normal = edge.cross(normals[i / 3]);
+      double w = edgeWeight * edge.lengthSquared();
+      quadrics_[a].addPlane(points_[a], normal, w);
+      quadrics_[b].addPlane(points_[a], normal, w);
+    }
+  }
+
+  void Simplifier::run(size_t target, double maxCost)
+  {
+    while (triangles() > target && pass(target, maxCost))
+      ;
+  }
+
+  int Simplifier::corner(int triangle, int position) const
+  {
+    const int* tri = &indices_[3 * triangle];
+    return position_[tri[0]] == position ? 0 : position_[tri[1]] == position ? 1 : 2;
+  }
+
+  bool Simplifier::pass(size_t target, double maxCost)
+  {
+    size_t positions = points_.size();
+    first_.assign(positions + 1, 0);
+    for (size_t i = 0; i < indices_.size(); ++i)
+      ++first_[position_[indices_[i]] + 1];
+    for (size_t p = 0; p < positions; ++p)
+      first_[p + 1] += first_[p];
+    adjacency_.resize(indices_.size());
+    {
+      std::vector<int> fill(first_.begin(), first_.end() - 1);
+      for (size_t i = 0; i < indices_.size(); ++i)
+        adjacency_[fill[position_[indices_[i]]]++] = static_cast<int>(i / 3);
+    }
+
+    // each half-edge gives the collapse of its start onto its end; the other
+    // direction comes from the twin half-edge, which borders do not have
+    std::vector<Collapse> collapses(indices_.size());
+    for (size_t i = 0; i < indices_.size(); ++i) {
+      size_t j = i - i % 3 + (i + 1) % 3;
+      int u = position_[indices_[i]], v = position_[indices_[j]];
+      Quadric q = quadrics_[u];
+      q.add(quadrics_[v]);
+      Collapse c = { q.error(points_[v]), u, v };
+      collapses[i] = c;
+    }
+    std::sort(collapses.begin(), collapses.end());
+
+    locked_.assign(positions, 0);
+    remap_.resize(model_.vertices.size());
+    for (size_t i = 0; i < remap_.size(); ++i)
+      remap_[i] = static_cast<int>(i);
+
+    size_t left = triangles();
+    bool collapsed = false;
+    for (size_t i = 0; i < collapses.size() && left > target; ++i) {
+      const Collapse& c = collapses[i];
+      if (c.cost > maxCost)
+        break;
+      if (locked_[c.from] || locked_[c.to] || !canCollapse(c.from, c.to))
+        continue;
+
+      for (size_t k = 0; k < wedges_.size(); ++k)
+        remap_[wedges_[k].first] = wedges_[k].second;
+      quadrics_[c.to].add(quadrics_[c.from]);
+      cost_ = std::max(cost_, c.cost);
+      locked_[c.from] = locked_[c.to] = 1;
+      for (size_t k = 0; k < ring_.size(); ++k) {
+        locked_[ring_[k].position] = 1;
+        if (ring_[k].position == c.to)
+          left -= ring_[k].triangles;
+      }
+      collapsed = true;
+    }
+
+    // drop the triangles that collapsed
+    size_t out = 0;
+    for (size_t i = 0; i < indices_.size(); i += 3) {
+      int a = remap_[indices_[i]], b = remap_[indices_[i + 1]], c = remap_[indices_[i + 2]];
+      int pa = position_[a], pb = position_[b], pc = position_[c];
+      if (pa != pb && pb != pc && pc != pa) {
+        indices_[out++] = a;
+        indices_[out++] = b;
+        indices_[out++] = c;
+      }
+    }
+    indices_.resize(out);
+    return collapsed;
+  }
+
+  bool Simplifier::canCollapse(int u, int v)
+  {
+    ring_.clear();
+    wedges_.clear();
+    const int* around = &adjacency_[first_[u]];
+    int count = first_[u + 1] - first_[u];
+
+    // the edges around u, and the wedges of u paired with those of v
+    for (int t = 0; t < count; ++t) {
+      const int* tri = &indices_[3 * around[t]];
+      int k = corner(around[t], u);
+      int wedge = tri[k];
+      for (int j = 1; j <= 2; ++j) {
+        int x = tri[(k + j) % 3];
+        int p = position_[x];
+        size_t e = 0;
+        while (e < ring_.size() && ring_[e].position != p)
+          ++e;
+        if (e == ring_.size()) {
+          Neighbor neighbor = { p, 1, wedge, x, false, false };
+          ring_.push_back(neighbor);
+        } else {
+          ++ring_[e].triangles;
+          ring_[e].seam |= ring_[e].wedge != wedge || ring_[e].neighborWedge != x;
+        }
+        if (p == v) {
+          size_t w = 0;
+          while (w < wedges_.size() && wedges_[w].first != wedge)
+            ++w;
+          if (w == wedges_.size())
+            wedges_.push_back(std::make_pair(wedge, x));
+          else if (wedges_[w].second != x)
+            return false;
+        }
+      }
+    }
+
+    // borders and seams may only shrink along themselves, and not at the
+    // corners where they meet or branch
+    int borders = 0, seams = 0, shared = 0;
+    for (size_t e = 0; e < ring_.size(); ++e) {
+      if (ring_[e].triangles > 2)
+        return false;
+      if (ring_[e].triangles == 1)
+        ++borders;
+      else if (ring_[e].seam)
+        ++seams;
+      if (ring_[e].position == v)
+        shared = ring_[e].triangles;
+    }
+    if (shared == 0 || (borders && seams) || (seams != 0 && seams != 2))
+      return false;
+    if (borders && (borders != 2 || shared != 1))
+      return false;
+
+    // the triangles that remain must keep a wedge of v and not turn over
+    const Vec3& pu = points_[u];
+    const Vec3& pv = points_[v];
+    for (int t = 0; t < count; ++t) {
+      const int* tri = &indices_[3 * around[t]];
+      int k = corner(around[t], u);
+      int a = position_[tri[(k + 1) % 3]], b = position_[tri[(k + 2) % 3]];
+      if (a == v || b == v)
+        continue;
+      size_t w = 0;
+      while (w < wedges_.size() && wedges_[w].first != tri[k])
+        ++w;
+      if (w == wedges_.size())
+        return false;
+      Vec3 before = (points_[a] - pu).cross(points_[b] - pu);
+      Vec3 after = (points_[a] - pv).cross(points_[b] - pv);
+      if (before.dot(after) <= maxTurn * std::sqrt(before.lengthSquared() * after.lengthSquared()))
+        return false;
+    }
+
+    // u and v may only have the neighbors across their shared triangles in
+    // common, or the collapse would fold the surface onto itself
+    int common = 0;
+    for (int t = first_[v]; t < first_[v + 1]; ++t) {
+      const int* tri = &indices_[3 * adjacency_[t]];
+      for (int k = 0; k < 3; ++k) {
+        int p = position_[tri[k]];
+        if (p == u || p == v)
+          continue;
+        for (size_t e = 0; e < ring_.size(); ++e) {
+          if (ring_[e].position == p && !ring_[e].linked) {
+            ring_[e].linked = true;
+            ++common;
+          }
+        }
+      }
+    }
+    return common == shared;
+  }
+
+  void Simplifier::extract(ObjModel* result) const
+  {
+    std::vector<int> remap(model_.vertices.size(), -1);
+    result->vertices.clear();
+    result->indices.resize(indices_.size());
+    result->min = Vec3(std::numeric_limits<float>::infinity());
+    result->max = Vec3(-std::numeric_limits<float>::infinity());
+    for (size_t i = 0; i < indices_.size(); ++i) {
+      int v = indices_[i];
+      if (remap[v] < 0) {
+        const ObjVertex& vertex = model_.vertices[v];
+        remap[v] = static_cast<int>(result->vertices.size());
+        result->vertices.push_back(vertex);
+        const Vec3& p = vertex.position;
+        result->min = Vec3(std::min(result->min.x, p.x), std::min(result->min.y, p.y), std::min(result->min.z, p.z));
+        result->max = Vec3(std::max(result->max.x, p.x), std::max(result->max.y, p.y), std::max(result->max.z, p.z));
+      }
+      result->indices[i] = remap[v];
+    }
+    result->textured = model_.textured;
+  }
+
+  double squared(float error)
+  {
+    return double(error) * error;
+  }
+}
+
+float cgl::simplify(const ObjModel& model, ObjModel* result, const SimplifyTarget& target)
+{
+  Simplifier simplifier(model);
+  simplifier.run(target.triangles, squared(target.error));
+  simplifier.extract(result);
+  return simplifier.error();
+}
+
+void cgl::buildLodChain(const ObjModel& model, const SimplifyTarget* targets, size_t n, LodChain* chain)
+{
+  chain->levels.clear();
+  chain->levels.reserve(n + 1);
+  chain->center = (model.min + model.max) * 0.5f;
+  chain->radius = (model.max - model.min).length() * 0.5f;
+  LodLevel full = { model, 0.0f };
+  chain->levels.push_back(full);
+
+  Simplifier simplifier(model);
+  for (size_t i = 0; i < n; ++i) {
+    size_t before = simplifier.triangles();
+    simplifier.run(targets[i].triangles, squared(targets[i].error));
+    if (simplifier.triangles() == before)
+      break;
+    chain->levels.push_back(LodLevel());
+    simplifier.extract(&chain->levels.back().model);
+    chain->levels.back().error = simplifier.error();
+  }
+}
+
+void cgl::buildLodChain(const ObjModel& model, size_t levels, float ratio, LodChain* chain)
+{
+  std::vector<SimplifyTarget> targets;
+  double triangles = model.indices.size() / 3;
+  for (size_t i = 1; i < levels; ++i) {
+    triangles *= ratio;
+    targets.push_back(SimplifyTarget(static_cast<size_t>(triangles)));
+  }
+  buildLodChain(model, targets.empty() ? NULL : &targets[0], targets.size(), chain);
+}
+
+size_t cgl::selectLod(const LodChain& chain, const Camera& camera, const Mat4& world,
+                      float viewportHeight, float maxPixels)
+{
+  if (chain.levels.size() < 2)
+    return 0;
+  
+  // the sphere in eye coordinates, scaled by the largest scale of world
+  Mat4 modelView = camera.view() * world;
+  Vec4 center = modelView * Vec4(chain.center.x, chain.center.y, chain.center.z, 1.0f);
+  float scale = std::max(Vec3(modelView.col(0)).length(),
+                         std::max(Vec3(modelView.col(1)).length(), Vec3(modelView.col(2)).length()));
+
+  // clip w of the nearest point of the sphere (the distance for a
+  // perspective projection, 1 for an orthographic one)
+  const Mat4& projection = camera.projection();
+  Vec4 row = projection.row(3);
+  float w = row.x * center.x + row.y * center.y + row.z * center.z + row.w -
+    chain.radius * scale * Vec3(row).length();
+  if (w <= 0)
+    return 0;
+
+  // a length at that point spans this many pixels per model unit
+  float pixels = scale * projection.col(1).y * 0.5f * viewportHeight / w;
+  for (size_t i = chain.levels.size() - 1; i > 0; --i) {
+    if (chain.levels[i].error * pixels <= maxPixels)
+      return i;
+  }
+  return 0;
+}
@@ -0,0 +1,74 @@
+#ifndef CGL_MESH_SIMPLIFIER_H_
+#define CGL_MESH_SIMPLIFIER_H_
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "math/cgl_math.h"
+#include "obj_loader.h"
+
+namespace cgl
+{
+
+  class Camera;
+
+  /// Where simplify() stops: at targetTriangles triangles or before the
+  /// error would exceed targetError, whichever comes first.
+  struct SimplifyTarget
+  {
+    size_t triangles;
+    float error;        // in model units
+
+    SimplifyTarget(size_t triangles = 0, float error = std::numeric_limits<float>::infinity())
+      : triangles(triangles), error(error) {}
+  };
+
+  /// Simplifies model into result by collapsing edges in order of the
+  /// quadric error metric (Garland and Heckbert). Each collapse moves one
+  /// vertex onto a neighbor, so the remaining vertices keep their original
+  /// attributes. Vertices that share a position but differ in texture
+  /// coordinates or normals (seams) are moved together, and only along the
+  /// seam, so seams never tear; open borders only shrink along themselves.
+  /// Returns the error reached: the RMS distance, in model units, from the
+  /// simplified surface around each remaining vertex to the original surface
+  /// it replaces, taking the largest over all collapses.
+  float simplify(const ObjModel& model, ObjModel* result, const SimplifyTarget& target);
+
+  /// One level of detail of a model.
+  struct LodLevel
+  {
+    ObjModel model;
+    float error;        // simplify() error relative to the full model
+  };
+
+  /// Levels of detail from the full model (level 0, error 0) to the
+  /// coarsest, with the bounding sphere of the model for selectLod().
+  struct LodChain
+  {
+    std::vector<LodLevel> levels;
+    cgl::Vec3 center;
+    float radius;
+  };
+
+  /// Builds a chain with the full model as level 0 followed by one level per
+  /// target, each simplified further from the previous one. The errors are
+  /// relative to the full model. The chain ends early if a target cannot
+  /// remove any more triangles.
+  void buildLodChain(const ObjModel& model, const SimplifyTarget* targets, size_t n, LodChain* chain);
+
+  /// Builds a chain of up to levels levels, each with ratio times the
+  /// triangles of the previous one.
+  void buildLodChain(const ObjModel& model, size_t levels, float ratio, LodChain* chain);
+
+  /// Returns the coarsest level of chain whose error projects to at most
+  /// maxPixels pixels on screen, for the model drawn with the world matrix
+  /// world through camera into a viewport viewportHeight pixels high. The
+  /// error is projected at the point of the bounding sphere nearest to the
+  /// camera; if the camera is inside the sphere, the result is level 0.
+  /// Works for perspective and orthographic projections.
+  size_t selectLod(const LodChain& chain, const Camera& camera, const cgl::Mat4& world,
+                   float viewportHeight, float maxPixels = 1.0f);
+
+}
+
+#endif
@@ -0,0 +1,261 @@
+#include "meshlet.h"
+#include <algorithm>
+#include <cmath>
+#include "camera.h"
+
+using namespace cgl;
+
+namespace
+{
+  // Cones whose triangles turn further than about 84 degrees from the axis
+  // are not worth testing: they are only culled from a narrow range of
+  // directions.
+  const float minConeDot = 0.1f;
+
+  // Ritter's bounding sphere of the points p[index[i]], within a few percent
+  // of the smallest.
+  Vec4 boundingSphere(const ObjVertex* vertices, const uint32_t* index, size_t n)
+  {
+    // start with the sphere through a pair of distant points
+    const Vec3& p0 = vertices[index[0]].position;
+    size_t a = 0, b = 0;
+    for (size_t i = 1; i < n; ++i) {
+      if ((vertices[index[i]].position - p0).lengthSquared() > (vertices[index[a]].position - p0).lengthSquared())
+        a = i;
+    }
+    const Vec3& pa = vertices[index[a]].position;
+    for (size_t i = 1; i < n; ++i) {
+      if ((vertices[index[i]].position - pa).lengthSquared() > (vertices[index[b]].position - pa).lengthSquared())
+        b = i;
+    }
+    Vec3 center = (pa + vertices[index[b]].position) * 0.5f;
+    float radius = (vertices[index[b]].position - pa).length() * 0.5f;
+
+    // grow it to cover the points outside
+    for (size_t i = 0; i < n; ++i) {
+      const Vec3& p = vertices[index[i]].position;
+      float d = (p - center).length();
+      if (d > radius) {
+        float grown = (radius + d) * 0.5f;
+        center += (p - center) * ((grown - radius) / d);
+        radius = grown;
+      }
+    }
+    return Vec4(center.x, center.y, center.z, radius);
+  }
+
+  MeshletCone normalCone(const ObjVertex* vertices, const uint32_t* index, const uint8_t* triangles,
+                         size_t n, const Vec3& center)
+  {
+    MeshletCone cone = { center, Vec3(0, 0, 1), 1.0f };
+    std::vector<Vec3> normals(n);
+    Vec3 sum(0.0f);
+    for (size_t t = 0; t < n; ++t) {
+      const Vec3& p0 = vertices[index[triangles[3 * t]]].position;
+      const Vec3& p1 = vertices[index[triangles[3 * t + 1]]].position;
+      const Vec3& p2 = vertices[index[triangles[3 * t + 2]]].position;
+      Vec3 normal = (p1 - p0).cross(p2 - p0);
+      float length = normal.length();
+      normals[t] = length > 0 ? normal / length : Vec3(0.0f);
+      sum += normals[t];
+    }
+    float length = sum.length();
+    if (length == 0)
+      return cone;
+    Vec3 axis = sum / length;
+
+    // the widest normal sets the angle of the cone
+    float minDot = 1.0f;
+    for (size_t t = 0; t < n; ++t) {
+      if (normals[t] == Vec3(0.0f))
+        continue;
+      minDot = std::min(minDot, normals[t].dot(axis));
+    }
+    if (minDot <= minConeDot)
+      return cone;
+
+    // the apex is on the back of every triangle's plane, moved back from the
+    // center along the axis
+    float maxT = 0;
+    for (size_t t = 0; t < n; ++t) {
+      if (normals[t] == Vec3(0.0f))
+        continue;
+      const Vec3& p0 = vertices[index[triangles[3 * t]]].position;
+      maxT = std::max(maxT, (center - p0).dot(normals[t]) / axis.dot(normals[t]));
+    }
+    cone.apex = center - axis * maxT;
+    cone.axis = axis;
+    cone.cutoff = std::sqrt(1.0f - minDot * minDot);
+    return cone;
+  }
+}
+
+void cgl::buildMeshlets(const ObjModel& model, MeshletMesh* mesh, size_t maxVertices, size_t maxTriangles)
+{
+  mesh->meshlets.clear();
+  mesh->vertices.clear();
+  mesh->triangles.clear();
+  mesh->spheres.clear();
+  mesh->cones.clear();
+  maxVertices = std::min<size_t>(std::max<size_t>(maxVertices, 3), 256);
+  maxTriangles = std::max<size_t>(maxTriangles, 1);
+
+  size_t triangles = model.indices.size() / 3;
+  size_t vertexCount = model.vertices.size();
+  if (triangles == 0)
+    return;
+  const int* indices = &model.indices[0];
+  const ObjVertex* vertices = &model.vertices[0];
+
+  // weld the vertices by position, so triangles that only share corners
+  // (flat shading, texture seams) are still neighbors
+  std::vector<int> order(vertexCount);
+  for (size_t i = 0; i < vertexCount; ++i)
+    order[i] = static_cast<int>(i);
+  std::sort(order.begin(), order.end(), [=](int a, int b) {
+    const Vec3& p = vertices[a].position;
+    const Vec3& q = vertices[b].position;
+    return p.x < q.x || (p.x == q.x && (p.y < q.y || (p.y == q.y && p.z < q.z)));
+  });
+  // each position is named by its first vertex, which keeps the arrays below
+  // in the order of the vertices, and as local as they are
+  std::vector<int> position(vertexCount);
+  for (size_t i = 0, j = 0; i < vertexCount; i = j) {
+    int lowest = order[i];
+    for (j = i + 1; j < vertexCount && vertices[order[j]].position == vertices[order[i]].position; ++j)
+      lowest = std::min(lowest, order[j]);
+    for (size_t k = i; k < j; ++k)
+      position[order[k]] = lowest;
+  }
+  size_t positions = vertexCount;
+
+  // triangles around each position; the first live[p] entries from first[p]
+  // are those not yet in a meshlet
+  std::vector<int> live(positions, 0);
+  for (size_t i = 0; i < triangles * 3; ++i)
+    ++live[position[indices[i]]];
+  std::vector<size_t> first(positions + 1, 0);
+  for (size_t p = 0; p < positions; ++p)
+    first[p + 1] = first[p] + live[p];
+  std::vector<int> adjacency(triangles * 3);
+  {
+    std::vector<size_t> fill(first.begin(), first.end() - 1);
+    for (size_t i = 0; i < triangles * 3; ++i)
+      adjacency[fill[position[indices[i]]]++] = static_cast<int>(i / 3);
+  }
+
+  // index of each vertex in the current meshlet, or -1
+  std::vector<int> local(vertexCount, -1);
+  auto newVertices = [&](int t) {
+    const int* tri = indices + 3 * t;
+    return (local[tri[0]] < 0) + (local[tri[1]] < 0 && tri[1] != tri[0]) +
+      (local[tri[2]] < 0 && tri[2] != tri[0] && tri[2] != tri[1]);
+  };
+
+  // step at which each position was last searched for neighbors, so that
+  // positions shared by several of the meshlet's vertices are searched once
+  std::vector<size_t> searched(positions, size_t(-1));
+
+  std::vector<char> added(triangles, 0);
+  size_t next = 0;
+  int seed = -1;
+  Meshlet meshlet = { 0, 0, 0, 0 };
+  for (size_t done = 0; done < triangles; ++done) {
+    int t = seed;
+    if (t < 0) {
+      while (added[next])
+        ++next;
+      t = static_cast<int>(next);
+    }
+
+    const int* tri = indices + 3 * t;
+    for (int k = 0; k < 3; ++k) {
+      int v = tri[k];
+      if (local[v] < 0) {
+        local[v] = static_cast<int>(meshlet.vertexCount++);
+        mesh->vertices.push_back(static_cast<uint32_t>(v));
+      }
+      mesh->triangles.push_back(static_cast<uint8_t>(local[v]));
+      int p = position[v];
+      int* list = &adjacency[first[p]];
+      *std::find(list, list + live[p], t) = list[--live[p]];
+    }
+    ++meshlet.triangleCount;
+    added[t] = 1;
+
+    // the neighbor that adds the fewest vertices, and of those the one whose
+    // corners have the fewest triangles left, so no stragglers are left
+    // behind
+    seed = -1;
+    int bestExtra = 4, bestLive = 0;
+    const uint32_t* meshletVertices = &mesh->vertices[meshlet.vertexOffset];
+    for (uint32_t i = 0; i < meshlet.vertexCount; ++i) {
+      int p = position[meshletVertices[i]];
+      if (searched[p] == done)
+        continue;
+      searched[p] = done;
+      const int* list = &adjacency[first[p]];
+      for (int j = 0; j < live[p]; ++j) {
+        const int* candidate = indices + 3 * list[j];
+        int extra = newVertices(list[j]);
+        int left = live[position[candidate[0]]] + live[position[candidate[1]]] + live[position[candidate[2]]];
+        if (extra < bestExtra || (extra == bestExtra && left < bestLive)) {
+          seed = list[j];
+          bestExtra = extra;
+          bestLive = left;
+        }
+      }
+    }
+
+    // with no neighbors left (the end of a separate piece of the surface),
+    // keep filling the meshlet in index order, which is usually nearby
+    if (seed < 0 && done + 1 < triangles) {
+      while (added[next])
+        ++next;
+      seed = static_cast<int>(next);
+      bestExtra = newVertices(seed);
+    }
+
+    // finish the meshlet if the next triangle does not fit; it starts the
+    // next one
+    if (seed < 0 || meshlet.vertexCount + bestExtra > maxVertices || meshlet.triangleCount == maxTriangles) {
+      const uint32_t* index = &mesh->vertices[meshlet.vertexOffset];
+      Vec4 sphere = boundingSphere(vertices, index, meshlet.vertexCount);
+      mesh->meshlets.push_back(meshlet);
+      mesh->spheres.push_back(sphere);
+      mesh->cones.push_back(normalCone(vertices, index, &mesh->triangles[meshlet.triangleOffset],
+                                       meshlet.triangleCount, Vec3(sphere.x, sphere.y, sphere.z)));
+      for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+        local[index[i]] = -1;
+      meshlet.vertexOffset = static_cast<uint32_t>(mesh->vertices.size());
+      meshlet.triangleOffset = static_cast<uint32_t>(mesh->triangles.size());
+      meshlet.vertexCount = 0;
+      meshlet.triangleCount = 0;
+    }
+  }
+}
+
+size_t cgl::cullMeshlets(const MeshletMesh& mesh, const Frustum& frustum, const Vec3& eye, uint32_t* visible)
+{
+  if (mesh.meshlets.empty())
+    return 0;
+  size_t count = frustum.visibleSpheres(&mesh.spheres[0], mesh.spheres.size(), visible);
+
+  size_t out = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const MeshletCone& cone = mesh.cones[visible[i]];
+    Vec3 d = cone.apex - eye;
+    if (d.dot(cone.axis) > cone.cutoff * d.length())
+      continue;
+    visible[out++] = visible[i];
+  }
+  return out;
+}
+
+size_t cgl::cullMeshlets(const MeshletMesh& mesh, const Camera& camera, const Mat4& world, uint32_t* visible)
+{
+  Frustum frustum(camera.projection() * camera.view() * world);
+  const Vec3& e = camera.eye();
+  Vec3 eye(world.inverseFast() * Vec4(e.x, e.y, e.z, 1.0f));
+  return cullMeshlets(mesh, frustum, eye, visible);
+}
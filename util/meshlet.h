@@ -0,0 +1,84 @@
+#ifndef CGL_MESHLET_H_
+#define CGL_MESHLET_H_
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+#include "math/cgl_math.h"
+#include "math/frustum.h"
+#include "obj_loader.h"
+
+namespace cgl
+{
+
+  class Camera;
+
+  /// A cluster of triangles of a model that share few vertices, to be culled
+  /// and drawn as a unit. Its vertices are MeshletMesh::vertices[vertexOffset
+  /// to vertexOffset + vertexCount), and its triangles are triangleCount
+  /// triples of indices into those vertices at
+  /// MeshletMesh::triangles[triangleOffset].
+  struct Meshlet
+  {
+    uint32_t vertexOffset;
+    uint32_t triangleOffset;
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+  };
+
+  /// Cone that bounds the normals of a meshlet's triangles. All of them face
+  /// away from an eye at e if
+  ///
+  ///   dot(normalize(apex - e), axis) > cutoff
+  ///
+  /// cutoff is the sine of the cone's half angle, or 1 for meshlets whose
+  /// triangles face too many ways to ever be culled.
+  struct MeshletCone
+  {
+    cgl::Vec3 apex;
+    cgl::Vec3 axis;
+    float cutoff;
+  };
+
+  /// Triangles of a model split into meshlets, with the bounds of each.
+  struct MeshletMesh
+  {
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> vertices;   // indices into the model's vertices
+    std::vector<uint8_t> triangles;   // 3 local vertex indices per triangle
+    std::vector<cgl::Vec4> spheres;   // bounding sphere (center, radius) of each meshlet
+    std::vector<MeshletCone> cones;   // normal cone of each meshlet
+  };
+
+  /// Limits of buildMeshlets() that suit mesh shaders on most GPUs.
+  const size_t maxMeshletVertices = 64;
+  const size_t maxMeshletTriangles = 124;
+
+  /// Splits the triangles of model into meshlets of at most maxVertices
+  /// (up to 256) vertices and maxTriangles triangles. Each meshlet grows
+  /// from a seed triangle to the triangles that touch it (by position, so
+  /// flat-shaded models and seams are handled), picking the neighbor that
+  /// adds the fewest vertices, so meshlets are compact patches of the
+  /// surface. When no neighbor is left, the meshlet continues with the next
+  /// triangle in index order; a new meshlet starts when the next triangle
+  /// does not fit. Index order works best after optimizeVertexCache()
+  /// (mesh_optimizer.h).
+  void buildMeshlets(const ObjModel& model, MeshletMesh* mesh, size_t maxVertices = maxMeshletVertices,
+                     size_t maxTriangles = maxMeshletTriangles);
+
+  /// Writes the indices of the meshlets that may be visible to visible (which
+  /// must have room for all of them) and returns how many there are. A
+  /// meshlet is rejected if its bounding sphere is outside frustum or if all
+  /// of its triangles face away from eye; frustum and eye must be in the
+  /// coordinates of the model (see Frustum).
+  size_t cullMeshlets(const MeshletMesh& mesh, const Frustum& frustum, const cgl::Vec3& eye,
+                      uint32_t* visible);
+
+  /// Culls the meshlets of a model drawn with the world matrix world through
+  /// camera (see above).
+  size_t cullMeshlets(const MeshletMesh& mesh, const Camera& camera, const cgl::Mat4& world,
+                      uint32_t* visible);
+
+}
+
+#endif
@@ -1,139 +1,596 @@
 #include "obj_loader.h"
-#include <fstream>
-#include <sstream>
-#include <map>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 #include <limits>
+#include <algorithm>
+#include "mapped_file.h"
+#include "mesh_cache.h"
+#include "math/batch_transform.h"
+#include "math/vertex_packing.h"
+#include "math/parallel.h"
 
 using namespace cgl;
 
-void ObjLoader::load(const char* fileName, ObjModel* model)
+namespace
+{
+  inline bool isSpace(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+  }
+  
+  inline bool isDigit(char c)
+  {
+    return static_cast<unsigned>(c - '0') < 10;
+  }
+  
+  inline const char* skipSpace(const char* p, const char* end)
+  {
+    while (p < end && isSpace(*p))
+      ++p;
+    return p;
+  }
+  
+  inline const char* skipToken(const char* p, const char* end)
+  {
+    while (p < end && !isSpace(*p))
+      ++p;
+    return p;
+  }
+  
+  // Parses an integer like atoi() from [p, end).
+  int parseInt(const char* p, const char* end)
+  {
+    p = skipSpace(p, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+      negative = *p++ == '-';
+    int value = 0;
+    for (; p < end && isDigit(*p); ++p)
+      value = value * 10 + (*p - '0');
+    return negative ? -value : value;
+  }
+  
+  // Parses the float at p (after any spaces) and advances p past it. Returns
+  // false, leaving value unchanged, if there is no number. The result is the
+  // correctly rounded float, as from strtof(): decimals of up to 19 digits
+  // with small exponents are converted exactly in double precision, and the
+  // rest go through strtof().
+  bool parseFloat(const char*& p, const char* end, float* value)
+  {
+    static const double powers[] = {
+      1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    
+    p = skipSpace(p, end);
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+      negative = *p++ == '-';
+    
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool any = false;
+    for (; p < end && isDigit(*p); ++p) {
+      mantissa = mantissa * 10 + (*p - '0');
+      digits += mantissa != 0;
+      any = true;
+    }
+    if (p < end && *p == '.') {
+      for (++p; p < end && isDigit(*p); ++p) {
+        mantissa = mantissa * 10 + (*p - '0');
+        digits += mantissa != 0;
+        --exponent;
+        any = true;
+      }
+    }
+    if (!any) {
+      p = start;
+      return false;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+      const char* q = p + 1;
+      bool negativeExponent = false;
+      if (q < end && (*q == '-' || *q == '+'))
+        negativeExponent = *q++ == '-';
+      if (q < end && isDigit(*q)) {
+        int e = 0;
+        for (; q < end && isDigit(*q); ++q)
+          e = std::min(e * 10 + (*q - '0'), 100000);
+        exponent += negativeExponent ? -e : e;
+        p = q;
+      }
+    }
+    
+    if (mantissa == 0 && digits == 0) {
+      *value = negative ? -0.0f : 0.0f;
+      return true;
+    }
+    if (digits <= 19 && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+      // m and 10^|e| are exact doubles, so d is the correctly rounded value
+      // of the decimal, and rounding d to float is too unless d is exactly
+      // halfway between two floats (or a float denormal)
+      double d = static_cast<double>(mantissa);
+      d = exponent < 0 ? d / powers[-exponent] : d * powers[exponent];
+      uint64_t bits;
+      std::memcpy(&bits, &d, sizeof(bits));
+      if ((bits & 0x1fffffff) != 0x10000000 && d >= 1.1754943508222875e-38) {
+        float f = static_cast<float>(d);
+        *value = negative ? -f : f;
+        return true;
+      }
+    }
+    
+    char buffer[64];
+    size_t length = static_cast<size_t>(p - start);
+    if (length < sizeof(buffer)) {
+      std::memcpy(buffer, start, length);
+      buffer[length] = 0;
+      *value = std::strtof(buffer, NULL);
+    } else {
+      *value = std::strtof(std::string(start, p).c_str(), NULL);
+    }
+    return true;
+  }
+  
+  
+  // Splits a v, v/vt, v//vn or v/vt/vn triplet into its indices as written
+  // (0 if absent).
+  inline void parseTriplet(const char* begin, const char* end, int& v, int& vt, int& vn)
+  {
+    const char* i = static_cast<const char*>(std::memchr(begin, '/', end - begin));
+    if (!i) {
+      v = parseInt(begin, end);
+      vt = 0;
+      vn = 0;
+    } else {
+      const char* j = end - 1;
+      while (*j != '/')
+        --j;
+      v = parseInt(begin, i);
+      vt = i == j ? parseInt(j + 1, end) : parseInt(i + 1, j);
+      vn = i == j ? 0 : parseInt(j + 1, end);
+    }
+  }
+  
+  // Makes a negative (relative) index absolute given the number of elements
+  // read so far, and flags it in relative.
+  inline int absoluteIndex(int i, size_t count, unsigned flag, unsigned char& relative)
+  {
+    if (i >= 0)
+      return i;
+    relative |= flag;
+    return static_cast<int>(count) + i + 1;
+  }
+  
+  // Bytes of text tokenized per chunk before the chunks are merged.
+  const size_t chunkSize = 4 << 20;
+  
+  // Rough size of the text per output vertex (its v, vt and vn lines and its
+  // share of the faces), for reserving the vertex table.
+  const size_t bytesPerVertex = 128;
+}
+
+// Records of one chunk of text: the attributes, the face corners and the
+// smoothing group changes, in file order.
+struct ObjLoader::Chunk
+{
+  std::vector<Vec3> v;
+  std::vector<Vec2> vt;
+  std::vector<Vec3> vn;
+  Vec3 min;
+  Vec3 max;
+  
+  // Corners of all faces. Relative indices are resolved against the counts
+  // within the chunk and flagged, since the counts before it are not known
+  // until the merge.
+  std::vector<Corner> corners;
+  std::vector<int> faceSizes;
+  
+  // (face index, group) for each "s" line.
+  std::vector<std::pair<size_t, int> > groups;
+};
+
+ObjVertexTable::ObjVertexTable() : size_(0)
+{
+}
+
+void ObjVertexTable::clear(size_t expected)
+{
+  // keep the load factor below 1/2
+  size_t capacity = 16;
+  while (capacity < 2 * expected)
+    capacity *= 2;
+  if (capacity == slots_.size() && size_ > 0) {
+    Slot empty = { 0, 0, 0, 0, -1 };
+    std::fill(slots_.begin(), slots_.end(), empty);
+    size_ = 0;
+  } else if (capacity != slots_.size()) {
+    slots_.clear();
+    size_ = 0;
+    resize(capacity);
+  }
+}
+
+int ObjVertexTable::insert(int group, int v, int vt, int vn, int index)
+{
+  if (2 * (size_ + 1) > slots_.size())
+    resize(std::max<size_t>(16, 2 * slots_.size()));
+  
+  uint32_t h = static_cast<uint32_t>(v) * 0x9e3779b1u;
+  h = (h ^ static_cast<uint32_t>(vt)) * 0x85ebca6bu;
+  h = (h ^ static_cast<uint32_t>(vn)) * 0xc2b2ae35u;
+  h ^= static_cast<uint32_t>(group) ^ (h >> 16);
+  size_t mask = slots_.size() - 1;
+  for (size_t i = h & mask;; i = (i + 1) & mask) {
+    Slot& s = slots_[i];
+    if (s.index < 0) {
+      Slot entry = { group, v, vt, vn, index };
+      s = entry;
+      ++size_;
+      return index;
+    }
+    if (s.v == v && s.vt == vt && s.vn == vn && s.group == group)
+      return s.index;
+  }
+}
+
+void ObjVertexTable::resize(size_t capacity)
+{
+  std::vector<Slot> old;
+  old.swap(slots_);
+  Slot empty = { 0, 0, 0, 0, -1 };
+  slots_.assign(capacity, empty);
+  size_ = 0;
+  for (size_t i = 0; i < old.size(); ++i)
+    if (old[i].index >= 0)
+      insert(old[i].group, old[i].v, old[i].vt, old[i].vn, old[i].index);
+}
+
+bool ObjLoader::load(const char* fileName, ObjModel* model, unsigned threads)
+{
+  MappedFile file;
+  if (!file.open(fileName))
+    return false;
+  parse(file.data(), file.data() + file.size(), model, threads);
+  return true;
+}
+
+bool ObjLoader::load(const char* fileName, CompactModel* model, unsigned threads)
+{
+  ObjModel obj;
+  if (!load(fileName, &obj, threads))
+    return false;
+  compact(obj, model);
+  return true;
+}
+
+void ObjLoader::parse(const char* begin, const char* end, ObjModel* model, unsigned threads)
 {
   model_ = model;
+  model_->vertices.clear();
+  model_->indices.clear();
   model_->min = Vec3(std::numeric_limits<float>::infinity());
   model_->max = Vec3(-std::numeric_limits<float>::infinity());
   smoothGroup = 1;
-  vertexMap = &vertexMaps[smoothGroup];
+  vertexTable_.clear(static_cast<size_t>(end - begin) / bytesPerVertex);
+  stream_ = NULL;
   
-  // parse file line by line
-  std::ifstream infile(fileName);
-  std::string line;
-  while (std::getline(infile, line)) {
-    parseLine(line);
-  }
+  if (threads == 0)
+    threads = hardwareThreads();
+  read(begin, end, threads, NULL);
   
   // make sure normals are all unit length
-  for (std::vector<ObjVertex>::iterator it = model_->vertices.begin();
-       it != model_->vertices.end();
-       ++it)
-  {
-    it->normal.normalize();
-  }
+  ObjVertex* vertices = model_->vertices.empty() ? NULL : &model_->vertices[0];
+  parallelFor(model_->vertices.size(), threads, [=](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i)
+      vertices[i].normal.normalize();
+  });
+  
+  model_->textured = !vt_.empty();
   
   // clear temporary storage
   v_.clear();
   vt_.clear();
   vn_.clear();
+  vertexTable_.clear();
   model_ = NULL;
 }
 
-void ObjLoader::parseLine(std::string& line)
+bool ObjLoader::stream(const char* fileName, const std::function<bool(const ObjModel&)>& callback,
+                       const ObjStreamOptions& options)
 {
-  std::istringstream iss(line);
-  std::string prefix;
-  iss >> prefix;
+  MappedFile file;
+  if (!file.open(fileName))
+    return false;
+  
+  // a chunk holds no more vertices than the whole file
+  size_t vertices = std::min(options.maxVertices, file.size() / bytesPerVertex + 1);
+  ObjModel chunk;
+  chunk.vertices.reserve(vertices);
+  chunk.indices.reserve(std::min(options.maxIndices, 6 * vertices));
+  model_ = &chunk;
+  smoothGroup = 1;
+  vertexTable_.clear(vertices);
+  Stream stream = { &callback, &options, vertices };
+  stream_ = &stream;
   
-  if (prefix == "v") {
+  unsigned threads = options.threads ? options.threads : hardwareThreads();
+  bool ok = read(file.data(), file.data() + file.size(), threads, &file) && flush();
+  
+  v_.clear();
+  vt_.clear();
+  vn_.clear();
+  vertexTable_.clear();
+  model_ = NULL;
+  stream_ = NULL;
+  return ok;
+}
+
+// Tokenizes up to threads chunks at once, split at line ends, then merges
+// them in file order. When streaming, the text already merged is released
+// from memory, and reading stops if the memory limit is exceeded or the
+// callback asks to.
+bool ObjLoader::read(const char* begin, const char* end, unsigned threads, MappedFile* file)
+{
+  std::vector<Chunk> chunks(threads);
+  std::vector<const char*> bounds(threads + 1);
+  for (const char* p = begin; p < end;) {
+    size_t n = 0;
+    bounds[0] = p;
+    for (; n < threads && p < end; ++n) {
+      const char* split = end;
+      if (static_cast<size_t>(end - p) > chunkSize) {
+        split = static_cast<const char*>(std::memchr(p + chunkSize, '\n', end - p - chunkSize));
+        split = split ? split + 1 : end;
+      }
+      bounds[n + 1] = p = split;
+    }
+    parallelFor(n, threads, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i)
+        parseChunk(bounds[i], bounds[i + 1], &chunks[i]);
+    }, 1);
+    for (size_t i = 0; i < n; ++i)
+      if (!merge(chunks[i]))
+        return false;
+    
+    if (stream_) {
+      if (file)
+        file->discard(bounds[0] - file->data(), p - bounds[0]);
+      
+      size_t limit = stream_->options->memoryLimit;
+      if (limit) {
+        size_t bytes = v_.capacity() * sizeof(Vec3) + vt_.capacity() * sizeof(Vec2) +
+          vn_.capacity() * sizeof(Vec3) + vertexTable_.memoryUsage() +
+          model_->vertices.capacity() * sizeof(ObjVertex) + model_->indices.capacity() * sizeof(int);
+        for (size_t i = 0; i < chunks.size(); ++i) {
+          bytes += chunks[i].v.capacity() * sizeof(Vec3) + chunks[i].vt.capacity() * sizeof(Vec2) +
+            chunks[i].vn.capacity() * sizeof(Vec3) + chunks[i].corners.capacity() * sizeof(Corner) +
+            chunks[i].faceSizes.capacity() * sizeof(int);
+        }
+        if (bytes > limit)
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Hands the vertices and indices collected so far to the stream callback as
+// a chunk and starts a new one.
+bool ObjLoader::flush()
+{
+  ObjModel& chunk = *model_;
+  if (chunk.indices.empty())
+    return true;
+  
+  chunk.min = Vec3(std::numeric_limits<float>::infinity());
+  chunk.max = Vec3(-std::numeric_limits<float>::infinity());
+  for (size_t i = 0; i < chunk.vertices.size(); ++i) {
+    ObjVertex& v = chunk.vertices[i];
+    v.normal.normalize();
+    chunk.min = Vec3(std::min(chunk.min.x, v.position.x), std::min(chunk.min.y, v.position.y),
+                     std::min(chunk.min.z, v.position.z));
+    chunk.max = Vec3(std::max(chunk.max.x, v.position.x), std::max(chunk.max.y, v.position.y),
+                     std::max(chunk.max.z, v.position.z));
+  }
+  chunk.textured = !vt_.empty();
+  
+  bool ok = (*stream_->callback)(chunk);
+  chunk.vertices.clear();
+  chunk.indices.clear();
+  vertexTable_.clear(stream_->vertices);
+  return ok;
+}
+
+bool ObjLoader::loadCached(const char* fileName, ObjModel* model, unsigned threads)
+{
+  MeshCache cache;
+  bool parsed;
+  if (!updateCache(fileName, &cache, model, &parsed, threads))
+    return false;
+  if (!parsed)
+    cache.copyTo(model);
+  return true;
+}
+
+bool ObjLoader::loadCached(const char* fileName, MeshCache* cache, unsigned threads)
+{
+  ObjModel model;
+  bool parsed;
+  return updateCache(fileName, cache, &model, &parsed, threads) && cache->isOpen();
+}
+
+// Opens the cache of fileName if it matches the file. Otherwise parses the
+// file into model, sets parsed and rewrites the cache, then opens it if that
+// worked.
+bool ObjLoader::updateCache(const char* fileName, MeshCache* cache, ObjModel* model, bool* parsed,
+                            unsigned threads)
+{
+  *parsed = false;
+  MeshSource source;
+  MappedFile file;
+  if (!fileStatus(fileName, &source.size, &source.time) || !file.open(fileName))
+    return false;
+  source.hash = hashBytes(file.data(), file.size(), threads);
+  
+  std::string cacheName = std::string(fileName) + ".cglmesh";
+  if (cache->open(cacheName.c_str()) && cache->matches(source))
+    return true;
+  
+  cache->close();
+  parse(file.data(), file.data() + file.size(), model, threads);
+  *parsed = true;
+  if (MeshCache::write(cacheName.c_str(), *model, &source))
+    cache->open(cacheName.c_str());
+  return true;
+}
+
+void ObjLoader::parseChunk(const char* begin, const char* end, Chunk* chunk)
+{
+  chunk->v.clear();
+  chunk->vt.clear();
+  chunk->vn.clear();
+  chunk->min = Vec3(std::numeric_limits<float>::infinity());
+  chunk->max = Vec3(-std::numeric_limits<float>::infinity());
+  chunk->corners.clear();
+  chunk->faceSizes.clear();
+  chunk->groups.clear();
+  
+  for (const char* p = begin; p < end;) {
+    const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    if (!eol)
+      eol = end;
+    parseLine(p, eol, chunk);
+    p = eol + 1;
+  }
+}
+
+void ObjLoader::parseLine(const char* p, const char* end, Chunk* chunk)
+{
+  p = skipSpace(p, end);
+  const char* prefix = p;
+  p = skipToken(p, end);
+  size_t length = p - prefix;
+  
+  if (length == 1 && prefix[0] == 'v') {
     Vec3 position;
-    iss >> position.x >> position.y >> position.z;
-    if (position.x < model_->min.x) model_->min.x = position.x;
-    if (position.x > model_->max.x) model_->max.x = position.x;
-    if (position.y < model_->min.y) model_->min.y = position.y;
-    if (position.y > model_->max.y) model_->max.y = position.y;
-    if (position.z < model_->min.z) model_->min.z = position.z;
-    if (position.z > model_->max.z) model_->max.z = position.z;
-    v_.push_back(position);
-    
-  } else if (prefix == "vt") {
+    parseFloat(p, end, &position.x) && parseFloat(p, end, &position.y) && parseFloat(p, end, &position.z);
+    if (position.x < chunk->min.x) chunk->min.x = position.x;
+    if (position.x > chunk->max.x) chunk->max.x = position.x;
+    if (position.y < chunk->min.y) chunk->min.y = position.y;
+    if (position.y > chunk->max.y) chunk->max.y = position.y;
+    if (position.z < chunk->min.z) chunk->min.z = position.z;
+    if (position.z > chunk->max.z) chunk->max.z = position.z;
+    chunk->v.push_back(position);
+    
+  } else if (length == 2 && prefix[0] == 'v' && prefix[1] == 't') {
     Vec2 texCoord;
-    iss >> texCoord.x >> texCoord.y;
-    vt_.push_back(texCoord);
+    parseFloat(p, end, &texCoord.x) && parseFloat(p, end, &texCoord.y);
+    chunk->vt.push_back(texCoord);
     
-  } else if (prefix == "vn") {
+  } else if (length == 2 && prefix[0] == 'v' && prefix[1] == 'n') {
     Vec3 normal;
-    iss >> normal.x >> normal.y >> normal.z;
-    vn_.push_back(normal);
-    
-  } else if (prefix == "s") {
-    iss >> smoothGroup;
-    vertexMap = &vertexMaps[smoothGroup];
-    
-  } else if (prefix == "f") {
-    parseFace(iss);
-  }
-}
-
-inline void parseTriplet(std::string& triplet, int& v, int& vt, int& vn)
-{
-  size_t i = triplet.find("/");
-  if (i == -1) {
-    // format: v
-    v = atoi(triplet.c_str()) - 1;
-    vt = -1;
-    vn = -1;
-  } else {
-    size_t j = triplet.rfind("/");
-    if (i == j) {
-      // format: v/vt
-      v = atoi(triplet.substr(0, i).c_str()) - 1;
-      vt = atoi(triplet.substr(j+1).c_str()) - 1;
-      vn = -1;
-    } else if (i == j - 1) {
-      // format: v//vn
-      v = atoi(triplet.substr(0, i).c_str()) - 1;
-      vt = -1;
-      vn = atoi(triplet.substr(j+1).c_str()) - 1;
-    } else {
-      // format: v/vt/vn
-      v = atoi(triplet.substr(0, i).c_str()) - 1;
-      vt = atoi(triplet.substr(i+1, j-i).c_str()) - 1;
-      vn = atoi(triplet.substr(j+1).c_str()) - 1;
+    parseFloat(p, end, &normal.x) && parseFloat(p, end, &normal.y) && parseFloat(p, end, &normal.z);
+    chunk->vn.push_back(normal);
+    
+  } else if (length == 1 && prefix[0] == 's') {
+    // "s off" reads as 0, like a failed stream extraction
+    chunk->groups.push_back(std::make_pair(chunk->faceSizes.size(), parseInt(p, end)));
+    
+  } else if (length == 1 && prefix[0] == 'f') {
+    int numVerts = 0;
+    for (p = skipSpace(p, end); p < end; p = skipSpace(p, end)) {
+      const char* triplet = p;
+      p = skipToken(p, end);
+      Corner c;
+      c.relative = 0;
+      parseTriplet(triplet, p, c.v, c.vt, c.vn);
+      c.v = absoluteIndex(c.v, chunk->v.size(), 1, c.relative);
+      c.vt = absoluteIndex(c.vt, chunk->vt.size(), 2, c.relative);
+      c.vn = absoluteIndex(c.vn, chunk->vn.size(), 4, c.relative);
+      chunk->corners.push_back(c);
+      numVerts++;
     }
+    chunk->faceSizes.push_back(numVerts);
   }
 }
 
-void ObjLoader::parseFace(std::istringstream& iss)
+bool ObjLoader::merge(Chunk& chunk)
+{
+  int vBase = static_cast<int>(v_.size());
+  int vtBase = static_cast<int>(vt_.size());
+  int vnBase = static_cast<int>(vn_.size());
+  v_.insert(v_.end(), chunk.v.begin(), chunk.v.end());
+  vt_.insert(vt_.end(), chunk.vt.begin(), chunk.vt.end());
+  vn_.insert(vn_.end(), chunk.vn.begin(), chunk.vn.end());
+  
+  // the first of equal values is kept, as when reading them in order
+  if (chunk.min.x < model_->min.x) model_->min.x = chunk.min.x;
+  if (chunk.max.x > model_->max.x) model_->max.x = chunk.max.x;
+  if (chunk.min.y < model_->min.y) model_->min.y = chunk.min.y;
+  if (chunk.max.y > model_->max.y) model_->max.y = chunk.max.y;
+  if (chunk.min.z < model_->min.z) model_->min.z = chunk.min.z;
+  if (chunk.max.z > model_->max.z) model_->max.z = chunk.max.z;
+  
+  Corner* corners = chunk.corners.empty() ? NULL : &chunk.corners[0];
+  size_t group = 0;
+  for (size_t f = 0; f < chunk.faceSizes.size(); ++f) {
+    for (; group < chunk.groups.size() && chunk.groups[group].first == f; ++group)
+      smoothGroup = chunk.groups[group].second;
+    int numVerts = chunk.faceSizes[f];
+    if (stream_) {
+      // start a new chunk if the face does not fit
+      size_t indices = numVerts > 3 ? 3 * (numVerts - 2) : numVerts;
+      if (model_->vertices.size() + numVerts > stream_->options->maxVertices ||
+          model_->indices.size() + indices > stream_->options->maxIndices) {
+        if (!flush())
+          return false;
+      }
+    }
+    for (int i = 0; i < numVerts; ++i) {
+      Corner& c = corners[i];
+      if (c.relative & 1) c.v += vBase;
+      if (c.relative & 2) c.vt += vtBase;
+      if (c.relative & 4) c.vn += vnBase;
+    }
+    addFace(corners, numVerts);
+    corners += numVerts;
+  }
+  if (group < chunk.groups.size())
+    smoothGroup = chunk.groups.back().second;
+  return true;
+}
+
+void ObjLoader::addFace(const Corner* corners, int numVerts)
 {
-  int numVerts = 0;
-  std::string triplet;
   bool useFaceNormal = false;
-  while (iss >> triplet) {
-    numVerts++;
-    int v, vt, vn;
-    parseTriplet(triplet, v, vt, vn);
+  for (int k = 0; k < numVerts; ++k) {
+    const Corner& c = corners[k];
+    int v = c.v - 1, vt = c.vt - 1, vn = c.vn - 1;
     useFaceNormal = useFaceNormal || vn < 0;
     
     // split polygons into triangles using a triangle fan
-    if (numVerts > 3) {
-      model_->indices.push_back(model_->indices[model_->indices.size() - numVerts + 1]);
+    if (k >= 3) {
+      model_->indices.push_back(model_->indices[model_->indices.size() - k]);
       model_->indices.push_back(model_->indices[model_->indices.size() - 2]);
     }
     
     // if no smoothing group or the vertex hasn't been seen, create a new one
-    if (!smoothGroup || vertexMap->find(triplet) == vertexMap->end()) {
+    int index = static_cast<int>(model_->vertices.size());
+    int shared = smoothGroup ? vertexTable_.insert(smoothGroup, v, vt, vn, index) : index;
+    model_->indices.push_back(shared);
+    if (shared == index) {
       ObjVertex vert = {
-        v_[v],
-        (vt < 0) ? Vec2() : vt_[vt],
-        (vn < 0) ? Vec3() : vn_[vn] };
-      int index = static_cast<int>(model_->vertices.size());
-      model_->indices.push_back(index);
+        (v < 0 || v >= static_cast<int>(v_.size())) ? Vec3() : v_[v],
+        (vt < 0 || vt >= static_cast<int>(vt_.size())) ? Vec2() : vt_[vt],
+        (vn < 0 || vn >= static_cast<int>(vn_.size())) ? Vec3() : vn_[vn] };
       model_->vertices.push_back(vert);
-      (*vertexMap)[triplet] = index;
-    } else {
-      model_->indices.push_back((*vertexMap)[triplet]);
     }
   }
   
-  if (useFaceNormal) {
+  if (useFaceNormal && numVerts >= 3) {
     int indicesAdded = 3 + 3 * (numVerts - 3);
     int n = static_cast<int>(model_->indices.size());
     Vec3 a = model_->vertices[model_->indices[n - indicesAdded]].position;
@@ -144,4 +601,126 @@ void ObjLoader::parseFace(std::istringstream& iss)
       model_->vertices[ model_->indices[i]].normal += normal;
     }
   }
-}
\ No newline at end of file
+}
+
+void cgl::transformVertices(const Mat4& M, ObjVertex* vertices, size_t n, unsigned threads)
+{
+  transformPoints(M, &vertices->position, sizeof(ObjVertex),
+                  &vertices->position, sizeof(ObjVertex), n, threads);
+  transformNormals(M, &vertices->normal, sizeof(ObjVertex),
+                   &vertices->normal, sizeof(ObjVertex), n, threads);
+}
+
+void cgl::getPositions(const ObjVertex* vertices, size_t n, Vec3Array* positions)
+{
+  positions->gather(&vertices->position, sizeof(ObjVertex), n);
+}
+
+void cgl::getNormals(const ObjVertex* vertices, size_t n, Vec3Array* normals)
+{
+  normals->gather(&vertices->normal, sizeof(ObjVertex), n);
+}
+
+void cgl::setPositions(const Vec3Array& positions, ObjVertex* vertices)
+{
+  positions.scatter(&vertices->position, sizeof(ObjVertex));
+}
+
+void cgl::setNormals(const Vec3Array& normals, ObjVertex* vertices)
+{
+  normals.scatter(&vertices->normal, sizeof(ObjVertex));
+}
+
+void cgl::compact(const ObjModel& model, CompactModel* compact)
+{
+  size_t n = model.vertices.size();
+  compact->vertices.resize(n);
+  compact->indices = model.indices;
+  compact->min = model.min;
+  compact->max = model.max;
+  compact->textured = model.textured;
+  
+  QuantizationError error = { 0.0f, 0.0f, 0.0f };
+  Vec3 extent = model.max - model.min;
+  Vec3 scale(extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+             extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+             extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+  
+  // gather blocks of attributes into arrays for the packing kernels, then
+  // decode the packed values again to measure the error
+  const size_t block = 256;
+  float positions[3 * block], texCoords[2 * block], decoded[3 * block];
+  uint16_t packedPositions[3 * block], packedTexCoords[2 * block];
+  Vec3 normals[block], decodedNormals[block];
+  uint32_t packedNormals[block];
+  
+  for (size_t begin = 0; begin < n; begin += block) {
+    size_t count = std::min(block, n - begin);
+    const ObjVertex* src = &model.vertices[begin];
+    CompactVertex* dst = &compact->vertices[begin];
+    
+    for (size_t i = 0; i < count; ++i) {
+      Vec3 p = (src[i].position - model.min) * scale;
+      positions[3 * i] = p.x;
+      positions[3 * i + 1] = p.y;
+      positions[3 * i + 2] = p.z;
+      texCoords[2 * i] = src[i].texCoord.x;
+      texCoords[2 * i + 1] = src[i].texCoord.y;
+      normals[i] = src[i].normal;
+    }
+    
+    packUnorm16(positions, packedPositions, 3 * count);
+    packHalf(texCoords, packedTexCoords, 2 * count);
+    packOctahedral(normals, packedNormals, count);
+    
+    for (size_t i = 0; i < count; ++i) {
+      dst[i].position[0] = packedPositions[3 * i];
+      dst[i].position[1] = packedPositions[3 * i + 1];
+      dst[i].position[2] = packedPositions[3 * i + 2];
+      dst[i].padding = 0;
+      dst[i].texCoord[0] = packedTexCoords[2 * i];
+      dst[i].texCoord[1] = packedTexCoords[2 * i + 1];
+      dst[i].normal = packedNormals[i];
+    }
+    
+    unpackUnorm16(packedPositions, decoded, 3 * count);
+    for (size_t i = 0; i < count; ++i) {
+      Vec3 p = model.min + Vec3(decoded[3 * i], decoded[3 * i + 1], decoded[3 * i + 2]) * extent;
+      Vec3 d = p - src[i].position;
+      error.position = std::max(error.position,
+                                std::max(std::fabs(d.x), std::max(std::fabs(d.y), std::fabs(d.z))));
+    }
+    
+    unpackHalf(packedTexCoords, decoded, 2 * count);
+    for (size_t i = 0; i < 2 * count; ++i)
+      error.texCoord = std::max(error.texCoord, std::fabs(decoded[i] - texCoords[i]));
+    
+    unpackOctahedral(packedNormals, decodedNormals, count);
+    for (size_t i = 0; i < count; ++i) {
+      // normals of unreferenced vertices are zero
+      float length = normals[i].length();
+      if (length > 0.0f) {
+        float c = std::min(1.0f, normals[i].dot(decodedNormals[i]) / length);
+        error.normalDegrees = std::max(error.normalDegrees, std::acos(c) * 57.2957795f);
+      }
+    }
+  }
+  
+  compact->error = error;
+}
+
+Vec3 cgl::decodePosition(const CompactModel& model, const CompactVertex& v)
+{
+  Vec3 t(unpackUnorm16(v.position[0]), unpackUnorm16(v.position[1]), unpackUnorm16(v.position[2]));
+  return model.min + t * (model.max - model.min);
+}
+
+Vec2 cgl::decodeTexCoord(const CompactVertex& v)
+{
+  return Vec2(unpackHalf(v.texCoord[0]), unpackHalf(v.texCoord[1]));
+}
+
+Vec3 cgl::decodeNormal(const CompactVertex& v)
+{
+  return unpackOctahedral(v.normal);
+}
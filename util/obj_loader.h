@@ -1,9 +1,11 @@
 #ifndef CGL_OBJ_LOADER_H_
 #define CGL_OBJ_LOADER_H_
 
+#include <stdint.h>
+#include <functional>
 #include <vector>
-#include <map>
 #include "math/cgl_math.h"
+#include "math/vector_array.h"
 
 namespace cgl
 {
@@ -24,14 +26,176 @@ namespace cgl
     bool textured;
   };
   
+  /// Vertex with quantized attributes (16 bytes instead of 32): the position
+  /// as unorm16 within the model bounds, the texture coordinate as half
+  /// floats and the normal octahedral-encoded (see math/vertex_packing.h).
+  /// In GL the position is a normalized GL_UNSIGNED_SHORT attribute that the
+  /// shader maps back with min + position * (max - min).
+  struct CompactVertex
+  {
+    uint16_t position[3];
+    uint16_t padding;
+    uint16_t texCoord[2];
+    uint32_t normal;
+  };
+  
+  /// Largest differences between the attributes of an ObjModel and those
+  /// decoded from its compact version.
+  struct QuantizationError
+  {
+    float position;      // per component, in model units
+    float texCoord;      // per component
+    float normalDegrees; // angle between the normals
+  };
+  
+  struct CompactModel
+  {
+    std::vector<CompactVertex> vertices;
+    std::vector<int> indices;
+    cgl::Vec3 min;
+    cgl::Vec3 max;
+    bool textured;
+    QuantizationError error;
+  };
+  
+  /// Quantizes the vertices of model into compact, recording the error.
+  void compact(const ObjModel& model, CompactModel* compact);
+  
+  /// Returns the position of v in model units.
+  cgl::Vec3 decodePosition(const CompactModel& model, const CompactVertex& v);
+  
+  /// Returns the texture coordinate of v.
+  cgl::Vec2 decodeTexCoord(const CompactVertex& v);
+  
+  /// Returns the unit normal of v.
+  cgl::Vec3 decodeNormal(const CompactVertex& v);
+  
+  /// Transforms the positions (as points) and normals (by the inverse-transpose)
+  /// of n vertices in place. Large arrays are split across threads threads
+  /// (0 = one per hardware thread).
+  void transformVertices(const cgl::Mat4& M, ObjVertex* vertices, size_t n, unsigned threads = 1);
+  
+  /// Copies the positions of n vertices into a structure-of-arrays container.
+  void getPositions(const ObjVertex* vertices, size_t n, cgl::Vec3Array* positions);
+  
+  /// Copies the normals of n vertices into a structure-of-arrays container.
+  void getNormals(const ObjVertex* vertices, size_t n, cgl::Vec3Array* normals);
+  
+  /// Writes positions back into the interleaved vertices (positions.size() of them).
+  void setPositions(const cgl::Vec3Array& positions, ObjVertex* vertices);
+  
+  /// Writes normals back into the interleaved vertices (normals.size() of them).
+  void setNormals(const cgl::Vec3Array& normals, ObjVertex* vertices);
+  
   // ObjPart : name, indices, material
   // ObjMaterial : textures, color properties
   
+  class MappedFile;
+  class MeshCache;
+  
+  /// Settings of ObjLoader::stream().
+  struct ObjStreamOptions
+  {
+    /// Most vertices in a chunk (the default keeps the indices below 2^16).
+    size_t maxVertices;
+    
+    /// Most indices in a chunk.
+    size_t maxIndices;
+    
+    /// Most bytes the loader may allocate, or 0 for no limit (see stream()).
+    size_t memoryLimit;
+    
+    /// Threads that tokenize the text (0 = one per hardware thread).
+    unsigned threads;
+    
+    ObjStreamOptions() : maxVertices(65536), maxIndices(3 * 65536), memoryLimit(0), threads(1) {}
+  };
+  
+  /// Open-addressing hash table from (smoothing group, v, vt, vn) index
+  /// tuples to output vertex indices, which ObjLoader uses to share vertices
+  /// between face corners.
+  class ObjVertexTable
+  {
+  public:
+    ObjVertexTable();
+    
+    /// Removes all entries and makes room for about expected of them.
+    void clear(size_t expected = 0);
+    
+    /// Returns the index stored for the tuple, or stores index for it and
+    /// returns index if there is none.
+    int insert(int group, int v, int vt, int vn, int index);
+    
+    /// Returns the number of entries.
+    size_t size() const { return size_; }
+    
+    /// Returns the bytes allocated for the table.
+    size_t memoryUsage() const { return slots_.capacity() * sizeof(Slot); }
+    
+  private:
+    // index < 0 marks an empty slot
+    struct Slot
+    {
+      int group;
+      int v;
+      int vt;
+      int vn;
+      int index;
+    };
+    
+    std::vector<Slot> slots_;
+    size_t size_;
+    
+    void resize(size_t capacity);
+  };
+  
   class ObjLoader
   {
   public:
     
-    void load(const char* fileName, ObjModel* model);
+    /// Loads a Wavefront OBJ file. The file is memory-mapped and parsed in
+    /// place, without copying lines. Returns false if it cannot be read.
+    ///
+    /// The text is tokenized in chunks split at line ends, up to threads of
+    /// them at once (0 = one per hardware thread), and the chunks are merged
+    /// in file order, so the model is the same for any number of threads.
+    bool load(const char* fileName, ObjModel* model, unsigned threads = 1);
+    
+    /// Loads the file and quantizes it with compact().
+    bool load(const char* fileName, CompactModel* model, unsigned threads = 1);
+    
+    /// Parses OBJ text in [begin, end) into model.
+    void parse(const char* begin, const char* end, ObjModel* model, unsigned threads = 1);
+    
+    /// Reads a file in chunks of at most options.maxVertices vertices and
+    /// options.maxIndices indices (unless a single face is larger), and
+    /// passes each chunk to callback as soon as it is full, while the rest
+    /// of the file is still being read. Each chunk is a self-contained
+    /// ObjModel: its indices refer to its own vertices and its bounds are
+    /// those of its vertices, so vertices on the border of two chunks appear
+    /// in both. Normals computed from faces without vn only average the
+    /// faces within the chunk.
+    ///
+    /// Only the v, vt and vn records and one chunk are kept in memory, and
+    /// the text already read is released. Returns false if the file cannot
+    /// be read, callback returns false, or the memory allocated by the
+    /// loader exceeds options.memoryLimit; the chunks passed so far are
+    /// still valid.
+    bool stream(const char* fileName, const std::function<bool(const ObjModel&)>& callback,
+                const ObjStreamOptions& options = ObjStreamOptions());
+    
+    /// Loads a file like load(), through a binary cache next to it (fileName
+    /// + ".cglmesh", see mesh_cache.h). If the cache was written from the
+    /// current contents of the file, the mesh is copied from it without
+    /// parsing; otherwise the file is parsed and the cache written again.
+    /// Returns false if the file cannot be read; failing to write the cache
+    /// is not an error.
+    bool loadCached(const char* fileName, ObjModel* model, unsigned threads = 1);
+    
+    /// Like loadCached() above, but opens the cache file as a view of the
+    /// mesh instead of copying it. Returns false if the file cannot be read
+    /// or the cache cannot be written.
+    bool loadCached(const char* fileName, MeshCache* cache, unsigned threads = 1);
     
   private:
     ObjModel* model_;
@@ -48,17 +212,42 @@ namespace cgl
     // Current smoothing group number.
     int smoothGroup;
     
-    // Each smoothing group owns a set of indices to obj vertices in the output
-    // model. This way, input vertices will be duplicated if they are in
-    // separate smoothing groups, which is necessary for unique normals.
-    std::map<int, std::map<std::string, int> > vertexMaps;
-    
     // Each input triplet in the obj file maps to an index for a vertex in the
-    // output model. This maps stores the mapping for the current smoothGroup.
-    std::map<std::string, int>* vertexMap;
+    // output model, per smoothing group. This way, input vertices will be
+    // duplicated if they are in separate smoothing groups, which is necessary
+    // for unique normals.
+    ObjVertexTable vertexTable_;
+    
+    // A face corner: 1-based indices (0 = absent). Bits 1, 2 and 4 of
+    // relative flag indices that still need the offset of their chunk.
+    struct Corner
+    {
+      int v;
+      int vt;
+      int vn;
+      unsigned char relative;
+    };
+    
+    struct Chunk;
+    
+    // Callback and settings of stream(), or NULL when loading a whole model.
+    struct Stream
+    {
+      const std::function<bool(const ObjModel&)>* callback;
+      const ObjStreamOptions* options;
+      size_t vertices;       // vertices expected in a chunk
+    };
+    
+    const Stream* stream_;
     
-    void parseLine(std::string& line);
-    void parseFace(std::istringstream& iss);
+    bool updateCache(const char* fileName, MeshCache* cache, ObjModel* model, bool* parsed,
+                     unsigned threads);
+    bool read(const char* begin, const char* end, unsigned threads, MappedFile* file);
+    bool flush();
+    static void parseChunk(const char* begin, const char* end, Chunk* chunk);
+    static void parseLine(const char* p, const char* end, Chunk* chunk);
+    bool merge(Chunk& chunk);
+    void addFace(const Corner* corners, int numVerts);
   };
   
 }
@@ -0,0 +1,397 @@
+#include "raycast.h"
+#include <algorithm>
+
+using namespace cgl;
+using namespace cgl::simd;
+
+namespace
+{
+  // The leaf triangle arrays are padded so that every leaf can be loaded in
+  // whole registers; the lanes past the end of a leaf are masked off.
+  const int padding = FloatN::width - 1;
+
+  // Ray prepared for slab tests. Zero direction components are replaced by a
+  // tiny value so that the reciprocals stay finite and 0 * inf never yields
+  // NaN for rays that start on a slab plane.
+  struct SlabRay
+  {
+    float origin[3];
+    float direction[3];
+    float inverse[3];
+
+    explicit SlabRay(const Ray& ray)
+    {
+      for (int c = 0; c < 3; ++c) {
+        origin[c] = ray.origin[c];
+        direction[c] = ray.direction[c];
+        inverse[c] = 1.0f / (direction[c] != 0.0f ? direction[c] : 1e-30f);
+      }
+    }
+  };
+
+  template <typename P> struct Triangles
+  {
+    P v0[3];
+    P e1[3];
+    P e2[3];
+  };
+
+  template <typename P> struct Rays
+  {
+    P origin[3];
+    P direction[3];
+  };
+
+  // Moller-Trumbore for every pair of lanes of rays and triangles (one side
+  // is usually broadcast). Returns a bit mask of the lanes that hit at
+  // 0 < t < tMax; t, u and v are valid only in those lanes.
+  template <typename P>
+  int intersect(const Rays<P>& r, const Triangles<P>& tri, P tMax, P* t, P* u, P* v)
+  {
+    const P* d = r.direction;
+    const P* e1 = tri.e1;
+    const P* e2 = tri.e2;
+    P p[3] = { d[1] * e2[2] - d[2] * e2[1],
+               d[2] * e2[0] - d[0] * e2[2],
+               d[0] * e2[1] - d[1] * e2[0] };
+    P det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+    P inv = P(1.0f) / det;
+    P s[3] = { r.origin[0] - tri.v0[0], r.origin[1] - tri.v0[1], r.origin[2] - tri.v0[2] };
+    P q[3] = { s[1] * e1[2] - s[2] * e1[1],
+               s[2] * e1[0] - s[0] * e1[2],
+               s[0] * e1[1] - s[1] * e1[0] };
+    *u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv;
+    *v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inv;
+    *t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv;
+
+    // parallel rays (det == 0) miss; if det is so small that its reciprocal
+    // overflows, t is infinite or NaN and fails the last test
+    const P zero(0.0f);
+    int mask = lessMask(zero, det) | lessMask(det, zero);
+    mask &= ~(lessMask(*u, zero) | lessMask(*v, zero) | lessMask(P(1.0f), *u + *v));
+    mask &= lessMask(zero, *t) & lessMask(*t, tMax);
+    return mask;
+  }
+
+  // Bit mask of the first n lanes of a register of width W.
+  template <typename P> int laneMask(size_t n)
+  {
+    return n >= size_t(P::width) ? (1 << P::width) - 1 : (1 << n) - 1;
+  }
+
+  // Everything the traversal reads, gathered from the caster.
+  struct Scene
+  {
+    const BvhNode* nodes;
+    const uint32_t* triangles;
+    const float* v0[3];
+    const float* e1[3];
+    const float* e2[3];
+
+    // Loads the triangles starting at leaf position j into the lanes of P.
+    template <typename P> Triangles<P> load(size_t j) const
+    {
+      Triangles<P> tri;
+      for (int c = 0; c < 3; ++c) {
+        tri.v0[c] = P::load(v0[c] + j);
+        tri.e1[c] = P::load(e1[c] + j);
+        tri.e2[c] = P::load(e2[c] + j);
+      }
+      return tri;
+    }
+
+    // Copies triangle j into every lane of P.
+    template <typename P> Triangles<P> broadcast(size_t j) const
+    {
+      Triangles<P> tri;
+      for (int c = 0; c < 3; ++c) {
+        tri.v0[c] = P(v0[c][j]);
+        tri.e1[c] = P(e1[c][j]);
+        tri.e2[c] = P(e2[c][j]);
+      }
+      return tri;
+    }
+  };
+
+  Scene makeScene(const Bvh& bvh, const Vec3Array& v0, const Vec3Array& e1, const Vec3Array& e2)
+  {
+    Scene scene;
+    scene.nodes = &bvh.nodes()[0];
+    scene.triangles = &bvh.triangles()[0];
+    for (int c = 0; c < 3; ++c) {
+      scene.v0[c] = v0.component(c);
+      scene.e1[c] = e1.component(c);
+      scene.e2[c] = e2.component(c);
+    }
+    return scene;
+  }
+
+  bool intersectsNode(const BvhNode& node, const SlabRay& ray, float tMax)
+  {
+    float tNear = 0.0f;
+    float tFar = tMax;
+    for (int c = 0; c < 3; ++c) {
+      float t0 = (node.min[c] - ray.origin[c]) * ray.inverse[c];
+      float t1 = (node.max[c] - ray.origin[c]) * ray.inverse[c];
+      tNear = std::max(tNear, std::min(t0, t1));
+      tFar = std::min(tFar, std::max(t0, t1));
+    }
+    return tNear <= tFar;
+  }
+
+  // Tests one ray against the triangles of a leaf, FloatN triangles at a
+  // time. Returns true if the ray hit any of them.
+  bool intersectLeaf(const Scene& scene, const BvhNode& node, const Rays<FloatN>& ray, RayHit* hit)
+  {
+    const int W = FloatN::width;
+    bool found = false;
+    size_t end = node.offset + node.count;
+    for (size_t j = node.offset; j < end; j += W) {
+      FloatN t, u, v;
+      int mask = intersect(ray, scene.load<FloatN>(j), FloatN(hit->t), &t, &u, &v);
+      mask &= laneMask<FloatN>(end - j);
+      if (mask == 0)
+        continue;
+
+      float ts[W], us[W], vs[W];
+      t.store(ts);
+      u.store(us);
+      v.store(vs);
+      for (int k = 0; k < W; ++k) {
+        if ((mask >> k & 1) && ts[k] < hit->t) {
+          hit->t = ts[k];
+          hit->u = us[k];
+          hit->v = vs[k];
+          hit->triangle = static_cast<int>(scene.triangles[j + k]);
+        }
+      }
+      found = true;
+    }
+    return found;
+  }
+
+  RayHit trace(const Scene& scene, const Ray& ray, RayQuery query, float maxDistance)
+  {
+    RayHit hit = { maxDistance, -1, 0.0f, 0.0f };
+    SlabRay slab(ray);
+    Rays<FloatN> lanes;
+    for (int c = 0; c < 3; ++c) {
+      lanes.origin[c] = FloatN(slab.origin[c]);
+      lanes.direction[c] = FloatN(slab.direction[c]);
+    }
+
+    // near child first, so that nearest-hit queries can skip the far child
+    // once its entry distance is beyond the closest hit
+    uint32_t stack[Bvh::maxDepth];
+    int top = 0;
+    uint32_t i = 0;
+    for (;;) {
+      const BvhNode& node = scene.nodes[i];
+      if (intersectsNode(node, slab, hit.t)) {
+        if (!node.isLeaf()) {
+          bool flip = slab.direction[node.axis] < 0.0f;
+          stack[top++] = flip ? i + 1 : node.offset;
+          i = flip ? node.offset : i + 1;
+          continue;
+        }
+        if (intersectLeaf(scene, node, lanes, &hit) && query == ANY_HIT)
+          break;
+      }
+      if (top == 0)
+        break;
+      i = stack[--top];
+    }
+    return hit;
+  }
+
+  // Traces up to FloatN::width rays together, one ray per lane: each node is
+  // visited once for the packet if any of its active rays enters it.
+  void tracePacket(const Scene& scene, const Ray* rays, size_t count, RayHit* hits,
+                   RayQuery query, float maxDistance)
+  {
+    typedef FloatN P;
+    const int W = P::width;
+
+    // lanes past count repeat the last ray and stay inactive
+    float origin[3][W], direction[3][W], inverse[3][W];
+    for (int k = 0; k < W; ++k) {
+      SlabRay slab(rays[std::min(size_t(k), count - 1)]);
+      for (int c = 0; c < 3; ++c) {
+        origin[c][k] = slab.origin[c];
+        direction[c][k] = slab.direction[c];
+        inverse[c][k] = slab.inverse[c];
+      }
+    }
+    Rays<P> lanes;
+    P inv[3];
+    for (int c = 0; c < 3; ++c) {
+      lanes.origin[c] = P::load(origin[c]);
+      lanes.direction[c] = P::load(direction[c]);
+      inv[c] = P::load(inverse[c]);
+    }
+
+    float tBest[W], uBest[W], vBest[W];
+    int triangle[W];
+    for (int k = 0; k < W; ++k) {
+      tBest[k] = maxDistance;
+      uBest[k] = vBest[k] = 0.0f;
+      triangle[k] = -1;
+    }
+    P tMax = P::load(tBest);
+    int active = laneMask<P>(count);
+
+    // the children are ordered by the first ray; the packet is assumed to be
+    // coherent enough that the others agree
+    uint32_t stack[Bvh::maxDepth];
+    int top = 0;
+    uint32_t i = 0;
+    for (;;) {
+      const BvhNode& node = scene.nodes[i];
+      P tNear(0.0f);
+      P tFar = tMax;
+      for (int c = 0; c < 3; ++c) {
+        P t0 = (P(node.min[c]) - lanes.origin[c]) * inv[c];
+        P t1 = (P(node.max[c]) - lanes.origin[c]) * inv[c];
+        tNear = max(tNear, min(t0, t1));
+        tFar = min(tFar, max(t0, t1));
+      }
+      if (active & ~lessMask(tFar, tNear)) {
+        if (!node.isLeaf()) {
+          bool flip = direction[node.axis][0] < 0.0f;
+          stack[top++] = flip ? i + 1 : node.offset;
+          i = flip ? node.offset : i + 1;
+          continue;
+        }
+        for (size_t j = node.offset; j < node.offset + node.count; ++j) {
+          P t, u, v;
+          int mask = intersect(lanes, scene.broadcast<P>(j), tMax, &t, &u, &v) & active;
+          if (mask == 0)
+            continue;
+
+          float ts[W], us[W], vs[W];
+          t.store(ts);
+          u.store(us);
+          v.store(vs);
+          for (int k = 0; k < W; ++k) {
+            if (mask >> k & 1) {
+              tBest[k] = ts[k];
+              uBest[k] = us[k];
+              vBest[k] = vs[k];
+              triangle[k] = static_cast<int>(scene.triangles[j]);
+            }
+          }
+          tMax = P::load(tBest);
+          if (query == ANY_HIT) {
+            active &= ~mask;
+            if (active == 0)
+              break;
+          }
+        }
+        if (active == 0)
+          break;
+      }
+      if (top == 0)
+        break;
+      i = stack[--top];
+    }
+
+    for (size_t k = 0; k < count; ++k) {
+      RayHit hit = { tBest[k], triangle[k], uBest[k], vBest[k] };
+      hits[k] = hit;
+    }
+  }
+}
+
+void RayCaster::build(const ObjModel& model, unsigned threads)
+{
+  build(model.vertices.empty() ? NULL : &model.vertices[0].position, sizeof(ObjVertex),
+        model.indices.empty() ? NULL : &model.indices[0], model.indices.size() / 3, threads);
+}
+
+void RayCaster::build(const void* positions, size_t stride, const int* indices,
+                      size_t triangleCount, unsigned threads)
+{
+  bvh_.build(positions, stride, indices, triangleCount, threads);
+  copyTriangles(positions, stride, indices);
+}
+
+void RayCaster::refit(const ObjModel& model)
+{
+  refit(model.vertices.empty() ? NULL : &model.vertices[0].position, sizeof(ObjVertex),
+        model.indices.empty() ? NULL : &model.indices[0]);
+}
+
+void RayCaster::refit(const void* positions, size_t stride, const int* indices)
+{
+  bvh_.refit(positions, stride, indices);
+  copyTriangles(positions, stride, indices);
+}
+
+void RayCaster::copyTriangles(const void* positions, size_t stride, const int* indices)
+{
+  const std::vector<uint32_t>& triangles = bvh_.triangles();
+  size_t count = triangles.size();
+  v0_.resize(count + padding);
+  e1_.resize(count + padding);
+  e2_.resize(count + padding);
+
+  const char* p = static_cast<const char*>(positions);
+  for (int c = 0; c < 3; ++c) {
+    float* v0 = v0_.component(c);
+    float* e1 = e1_.component(c);
+    float* e2 = e2_.component(c);
+    for (size_t j = 0; j < count; ++j) {
+      const int* index = indices + 3 * triangles[j];
+      float a = reinterpret_cast<const float*>(p + stride * index[0])[c];
+      float b = reinterpret_cast<const float*>(p + stride * index[1])[c];
+      float d = reinterpret_cast<const float*>(p + stride * index[2])[c];
+      v0[j] = a;
+      e1[j] = b - a;
+      e2[j] = d - a;
+    }
+    for (size_t j = count; j < count + padding; ++j)
+      v0[j] = e1[j] = e2[j] = 0.0f;
+  }
+}
+
+RayHit RayCaster::cast(const Ray& ray, RayQuery query, float maxDistance) const
+{
+  if (bvh_.empty()) {
+    RayHit miss = { maxDistance, -1, 0.0f, 0.0f };
+    return miss;
+  }
+  return trace(makeScene(bvh_, v0_, e1_, e2_), ray, query, maxDistance);
+}
+
+void RayCaster::cast(const Ray* rays, size_t n, RayHit* hits, RayQuery query, float maxDistance) const
+{
+  if (bvh_.empty()) {
+    RayHit miss = { maxDistance, -1, 0.0f, 0.0f };
+    std::fill(hits, hits + n, miss);
+    return;
+  }
+  Scene scene = makeScene(bvh_, v0_, e1_, e2_);
+  for (size_t i = 0; i < n; i += packetSize)
+    tracePacket(scene, rays + i, std::min(size_t(packetSize), n - i), hits + i, query, maxDistance);
+}
+
+Vec3 cgl::unproject(const Mat4& inverseViewProjection, const Vec3& ndc)
+{
+  Vec4 p = inverseViewProjection * Vec4(ndc.x, ndc.y, ndc.z, 1.0f);
+  return Vec3(p.x / p.w, p.y / p.w, p.z / p.w);
+}
+
+Ray cgl::pickRay(const Mat4& viewProjection, float x, float y, float width, float height)
+{
+  Mat4 inverse = viewProjection.inverse();
+  float ndcX = 2.0f * x / width - 1.0f;
+  float ndcY = 1.0f - 2.0f * y / height;
+  Vec3 near = unproject(inverse, Vec3(ndcX, ndcY, -1.0f));
+  Vec3 far = unproject(inverse, Vec3(ndcX, ndcY, 1.0f));
+  return Ray(near, (far - near).normal());
+}
+
+Ray cgl::pickRay(const Camera& camera, float x, float y, float width, float height)
+{
+  return pickRay(camera.projection() * camera.view(), x, y, width, height);
+}
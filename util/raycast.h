@@ -0,0 +1,115 @@
+#ifndef CGL_RAYCAST_H_
+#define CGL_RAYCAST_H_
+
+#include <limits>
+#include "math/cgl_math.h"
+#include "math/simd_float.h"
+#include "bvh.h"
+#include "camera.h"
+#include "obj_loader.h"
+
+namespace cgl
+{
+
+  /// Half-line origin + t * direction for t >= 0. The direction need not be
+  /// unit length; hit distances are then in multiples of it.
+  struct Ray
+  {
+    cgl::Vec3 origin;
+    cgl::Vec3 direction;
+
+    Ray() {}
+    Ray(const cgl::Vec3& origin, const cgl::Vec3& direction) : origin(origin), direction(direction) {}
+
+    /// Returns the point at distance t along the ray.
+    cgl::Vec3 at(float t) const { return origin + direction * t; }
+  };
+
+  /// Result of a ray query.
+  struct RayHit
+  {
+    /// Distance along the ray to the hit.
+    float t;
+
+    /// Index of the triangle that was hit (into the indices / 3), or -1.
+    int triangle;
+
+    /// Barycentric coordinates of the hit: the point is
+    /// (1 - u - v) * p0 + u * p1 + v * p2.
+    float u;
+    float v;
+
+    bool hit() const { return triangle >= 0; }
+  };
+
+  /// What a ray query looks for.
+  enum RayQuery
+  {
+    NEAREST_HIT,  // the closest triangle along the ray (picking)
+    ANY_HIT       // any triangle; stops at the first one found (shadow probes)
+  };
+
+  /// Maps a point in normalized device coordinates ([-1, 1] on each axis)
+  /// back to world coordinates.
+  cgl::Vec3 unproject(const cgl::Mat4& inverseViewProjection, const cgl::Vec3& ndc);
+
+  /// Returns the world-space ray through the window point (x, y), given in
+  /// pixels from the top-left corner of a width x height viewport. The ray
+  /// starts on the near plane and has unit direction.
+  Ray pickRay(const cgl::Mat4& viewProjection, float x, float y, float width, float height);
+
+  /// Returns the world-space ray through a window point of the camera.
+  Ray pickRay(const Camera& camera, float x, float y, float width, float height);
+
+  /// Casts rays against the triangles of a mesh. The triangles are copied
+  /// into the caster (in BVH leaf order, structure-of-arrays) so that leaves
+  /// are tested with the vectorized Moller-Trumbore kernel; call refit()
+  /// after moving the vertices, or build() after changing the indices.
+  class RayCaster
+  {
+  public:
+
+    /// Number of rays traced together by the packet version of cast().
+    static const int packetSize = cgl::simd::FloatN::width;
+
+    /// Builds the BVH over the triangles of model (see Bvh::build()).
+    void build(const ObjModel& model, unsigned threads = 0);
+
+    /// Builds the BVH over indexed triangles (see Bvh::build()).
+    void build(const void* positions, size_t stride, const int* indices,
+               size_t triangleCount, unsigned threads = 0);
+
+    /// Updates the triangles and the BVH bounds after the vertices moved.
+    void refit(const ObjModel& model);
+
+    /// Updates the triangles and the BVH bounds after the positions moved.
+    void refit(const void* positions, size_t stride, const int* indices);
+
+    /// Casts one ray. Hits further than maxDistance are ignored.
+    RayHit cast(const Ray& ray, RayQuery query = NEAREST_HIT,
+                float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+    /// Casts n rays, tracing packetSize of them at a time through the BVH
+    /// together. This pays off when consecutive rays are coherent (e.g. a
+    /// small tile of pixels), since each packet visits the union of the nodes
+    /// its rays would visit.
+    void cast(const Ray* rays, size_t n, RayHit* hits, RayQuery query = NEAREST_HIT,
+              float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+    /// Returns the hierarchy.
+    const Bvh& bvh() const { return bvh_; }
+
+  private:
+    Bvh bvh_;
+
+    // Triangle vertex 0 and the edges to vertices 1 and 2, in leaf order.
+    cgl::Vec3Array v0_;
+    cgl::Vec3Array e1_;
+    cgl::Vec3Array e2_;
+
+    void copyTriangles(const void* positions, size_t stride, const int* indices);
+  };
+
+}
+
+#endif
@@ -0,0 +1,358 @@
+#include "spatial_hash.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include "math/parallel.h"
+
+using namespace cgl;
+
+const uint32_t SpatialHashGrid::none;
+
+namespace
+{
+  // Set in a location that indexes insertions_ rather than entries_.
+  const uint32_t inserted = 0x80000000u;
+
+  // Smallest number of buckets in the table.
+  const size_t minBuckets = 64;
+
+  // Below this many points, rebuild() runs serially.
+  const size_t parallelThreshold = 16384;
+
+  size_t roundUpToPowerOfTwo(size_t n)
+  {
+    size_t p = 1;
+    while (p < n)
+      p <<= 1;
+    return p;
+  }
+}
+
+SpatialHashGrid::SpatialHashGrid(float cellSize)
+  : cellSize_(cellSize), invCellSize_(1.0f / cellSize), threads_(1)
+{
+  clear();
+}
+
+int32_t SpatialHashGrid::cell(float v) const
+{
+  // clamped so that the conversion is defined for huge values and NaN;
+  // rounding down by hand avoids a call to floor() without SSE4.1
+  float c = v * invCellSize_;
+  c = c > -1073741824.0f ? c : -1073741824.0f;
+  c = c < 1073741824.0f ? c : 1073741824.0f;
+  int32_t i = static_cast<int32_t>(c);
+  return c < static_cast<float>(i) ? i - 1 : i;
+}
+
+uint32_t SpatialHashGrid::bucket(int32_t x, int32_t y, int32_t z) const
+{
+  // Teschner et al., "Optimized Spatial Hashing for Collision Detection of
+  // Deformable Objects"
+  uint32_t h = static_cast<uint32_t>(x) * 73856093u ^ static_cast<uint32_t>(y) * 19349663u ^
+    static_cast<uint32_t>(z) * 83492791u;
+  return h & bucketMask_;
+}
+
+void SpatialHashGrid::build(const Vec3* points, size_t n, unsigned threads)
+{
+  points_.assign(points, points + n);
+  locations_.assign(n, 0);
+  freeIds_.clear();
+  size_ = n;
+  threads_ = threads;
+  rebuild(threads);
+}
+
+void SpatialHashGrid::rebuild(unsigned threads)
+{
+  if (threads == 0)
+    threads = hardwareThreads();
+
+  std::vector<uint32_t> ids;
+  ids.reserve(size_);
+  for (size_t id = 0; id < locations_.size(); ++id)
+    if (locations_[id] != none)
+      ids.push_back(static_cast<uint32_t>(id));
+
+  size_t n = ids.size();
+  size_t bucketCount = roundUpToPowerOfTwo(std::max(n, minBuckets));
+  bucketMask_ = static_cast<uint32_t>(bucketCount - 1);
+
+  std::vector<uint32_t> buckets(n);
+  parallelFor(n, threads, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const Vec3& p = points_[ids[i]];
+      buckets[i] = bucket(cell(p.x), cell(p.y), cell(p.z));
+    }
+  });
+
+  // counting sort by bucket; slot b + 1 counts bucket b
+  std::vector<uint32_t> starts(bucketCount + 1, 0);
+  std::vector<Entry> entries(n);
+  if (threads == 1 || n < parallelThreshold) {
+    for (size_t i = 0; i < n; ++i)
+      ++starts[buckets[i] + 1];
+    for (size_t b = 0; b < bucketCount; ++b)
+      starts[b + 1] += starts[b];
+    std::vector<uint32_t> next(starts.begin(), starts.end() - 1);
+    for (size_t i = 0; i < n; ++i) {
+      Entry e = { points_[ids[i]], ids[i] };
+      entries[next[buckets[i]]++] = e;
+    }
+  } else {
+    std::unique_ptr<std::atomic<uint32_t>[]> next(new std::atomic<uint32_t>[bucketCount]);
+    parallelFor(bucketCount, threads, [&](size_t begin, size_t end) {
+      for (size_t b = begin; b < end; ++b)
+        next[b].store(0, std::memory_order_relaxed);
+    });
+    parallelFor(n, threads, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i)
+        next[buckets[i]].fetch_add(1, std::memory_order_relaxed);
+    });
+    for (size_t b = 0; b < bucketCount; ++b) {
+      starts[b + 1] = starts[b] + next[b].load(std::memory_order_relaxed);
+      next[b].store(starts[b], std::memory_order_relaxed);
+    }
+    parallelFor(n, threads, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        Entry e = { points_[ids[i]], ids[i] };
+        entries[next[buckets[i]].fetch_add(1, std::memory_order_relaxed)] = e;
+      }
+    });
+
+    // the threads filled the buckets in any order; sort them by id so that
+    // the result does not depend on the thread count
+    parallelFor(bucketCount, threads, [&](size_t begin, size_t end) {
+      for (size_t b = begin; b < end; ++b) {
+        if (starts[b + 1] - starts[b] > 1) {
+          std::sort(entries.begin() + starts[b], entries.begin() + starts[b + 1],
+                    [](const Entry& x, const Entry& y) { return x.id < y.id; });
+        }
+      }
+    });
+  }
+
+  parallelFor(n, threads, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+      locations_[entries[i].id] = static_cast<uint32_t>(i);
+  });
+
+  bucketStarts_.swap(starts);
+  entries_.swap(entries);
+  insertionHeads_.assign(bucketCount, none);
+  insertions_.clear();
+  removed_ = 0;
+}
+
+void SpatialHashGrid::rebuildIfNeeded()
+{
+  // rebuilding after a number of changes proportional to the size keeps the
+  // amortized cost of insert() and remove() constant
+  if (insertions_.size() + removed_ > entries_.size() / 2 + 1024)
+    rebuild(threads_);
+}
+
+uint32_t SpatialHashGrid::insert(const Vec3& point)
+{
+  uint32_t id;
+  if (freeIds_.empty()) {
+    id = static_cast<uint32_t>(points_.size());
+    points_.push_back(point);
+    locations_.push_back(none);
+  } else {
+    // the entry of the removed point has id none, so it cannot be mistaken
+    // for the new one
+    id = freeIds_.back();
+    freeIds_.pop_back();
+    points_[id] = point;
+  }
+  uint32_t b = bucket(cell(point.x), cell(point.y), cell(point.z));
+  Insertion insertion = { { point, id }, insertionHeads_[b] };
+  insertionHeads_[b] = static_cast<uint32_t>(insertions_.size());
+  locations_[id] = inserted | static_cast<uint32_t>(insertions_.size());
+  insertions_.push_back(insertion);
+  ++size_;
+  rebuildIfNeeded();
+  return id;
+}
+
+bool SpatialHashGrid::remove(uint32_t id)
+{
+  if (!contains(id))
+    return false;
+  uint32_t location = locations_[id];
+  if (location & inserted)
+    insertions_[location & ~inserted].entry.id = none;
+  else
+    entries_[location].id = none;
+  locations_[id] = none;
+  freeIds_.push_back(id);
+  --size_;
+  ++removed_;
+  rebuildIfNeeded();
+  return true;
+}
+
+void SpatialHashGrid::clear()
+{
+  points_.clear();
+  locations_.clear();
+  freeIds_.clear();
+  bucketStarts_.assign(minBuckets + 1, 0);
+  entries_.clear();
+  insertionHeads_.assign(minBuckets, none);
+  insertions_.clear();
+  bucketMask_ = static_cast<uint32_t>(minBuckets - 1);
+  size_ = 0;
+  removed_ = 0;
+}
+
+template <typename F> void SpatialHashGrid::forEachInCell(int32_t x, int32_t y, int32_t z, F fn) const
+{
+  // other cells can share the bucket, so check the cell of each entry
+  uint32_t b = bucket(x, y, z);
+  for (uint32_t i = bucketStarts_[b]; i < bucketStarts_[b + 1]; ++i) {
+    const Entry& e = entries_[i];
+    if (e.id != none && cell(e.position.x) == x && cell(e.position.y) == y && cell(e.position.z) == z)
+      fn(e);
+  }
+  if (insertions_.empty())
+    return;
+  for (uint32_t i = insertionHeads_[b]; i != none; i = insertions_[i].next) {
+    const Entry& e = insertions_[i].entry;
+    if (e.id != none && cell(e.position.x) == x && cell(e.position.y) == y && cell(e.position.z) == z)
+      fn(e);
+  }
+}
+
+template <typename F> void SpatialHashGrid::forEach(F fn) const
+{
+  for (size_t i = 0; i < entries_.size(); ++i)
+    if (entries_[i].id != none)
+      fn(entries_[i]);
+  for (size_t i = 0; i < insertions_.size(); ++i)
+    if (insertions_[i].entry.id != none)
+      fn(insertions_[i].entry);
+}
+
+template <typename F>
+void SpatialHashGrid::forEachInCells(const int32_t* lo, const int32_t* hi, F fn) const
+{
+  if (hi[0] < lo[0] || hi[1] < lo[1] || hi[2] < lo[2])
+    return;
+  double cells = (double(hi[0]) - lo[0] + 1) * (double(hi[1]) - lo[1] + 1) * (double(hi[2]) - lo[2] + 1);
+  if (cells > bucketMask_ + 1.0) {
+    forEach(fn);
+    return;
+  }
+  for (int32_t x = lo[0]; x <= hi[0]; ++x)
+    for (int32_t y = lo[1]; y <= hi[1]; ++y)
+      for (int32_t z = lo[2]; z <= hi[2]; ++z)
+        forEachInCell(x, y, z, fn);
+}
+
+size_t SpatialHashGrid::queryRadius(const Vec3& center, float radius, uint32_t* ids, size_t capacity) const
+{
+  int32_t lo[3] = { cell(center.x - radius), cell(center.y - radius), cell(center.z - radius) };
+  int32_t hi[3] = { cell(center.x + radius), cell(center.y + radius), cell(center.z + radius) };
+  float radiusSquared = radius * radius;
+  size_t found = 0;
+  forEachInCells(lo, hi, [&](const Entry& e) {
+    if ((e.position - center).lengthSquared() <= radiusSquared) {
+      if (found < capacity)
+        ids[found] = e.id;
+      ++found;
+    }
+  });
+  return found;
+}
+
+size_t SpatialHashGrid::queryBox(const Vec3& min, const Vec3& max, uint32_t* ids, size_t capacity) const
+{
+  int32_t lo[3] = { cell(min.x), cell(min.y), cell(min.z) };
+  int32_t hi[3] = { cell(max.x), cell(max.y), cell(max.z) };
+  size_t found = 0;
+  forEachInCells(lo, hi, [&](const Entry& e) {
+    const Vec3& p = e.position;
+    if (p.x >= min.x && p.y >= min.y && p.z >= min.z && p.x <= max.x && p.y <= max.y && p.z <= max.z) {
+      if (found < capacity)
+        ids[found] = e.id;
+      ++found;
+    }
+  });
+  return found;
+}
+
+size_t SpatialHashGrid::queryNearest(const Vec3& point, size_t k, Neighbor* neighbors,
+                                     float maxDistance) const
+{
+  if (k == 0 || size_ == 0)
+    return 0;
+
+  // neighbors[0, found) is a max-heap by distance; once it holds k points,
+  // only closer points are considered
+  size_t found = 0;
+  float limit = maxDistance * maxDistance;
+  auto consider = [&](const Entry& e) {
+    float d = (e.position - point).lengthSquared();
+    if (d > limit || (found == k && d >= limit))
+      return;
+    if (found == k)
+      std::pop_heap(neighbors, neighbors + found--);
+    Neighbor n = { e.id, d };
+    neighbors[found++] = n;
+    std::push_heap(neighbors, neighbors + found);
+    if (found == k)
+      limit = neighbors[0].distanceSquared;
+  };
+
+  // search shells of cells around the cell of point, at increasing
+  // Chebyshev distance r, until the heap is full and the nearest unsearched
+  // cell is farther away than its top
+  int32_t c[3] = { cell(point.x), cell(point.y), cell(point.z) };
+  for (int32_t r = 0;; ++r) {
+    double side = 2.0 * r + 1;
+    if (side * side * side > bucketMask_ + 1.0) {
+      // the shells are larger than the table: visit the points outside the
+      // searched cube directly
+      int32_t inner = r - 1;
+      forEach([&](const Entry& e) {
+        int32_t x = cell(e.position.x), y = cell(e.position.y), z = cell(e.position.z);
+        if (std::abs(x - c[0]) > inner || std::abs(y - c[1]) > inner || std::abs(z - c[2]) > inner)
+          consider(e);
+      });
+      break;
+    }
+
+    for (int32_t x = -r; x <= r; ++x) {
+      for (int32_t y = -r; y <= r; ++y) {
+        if (x == -r || x == r || y == -r || y == r) {
+          for (int32_t z = -r; z <= r; ++z)
+            forEachInCell(c[0] + x, c[1] + y, c[2] + z, consider);
+        } else {
+          forEachInCell(c[0] + x, c[1] + y, c[2] - r, consider);
+          if (r > 0)
+            forEachInCell(c[0] + x, c[1] + y, c[2] + r, consider);
+        }
+      }
+    }
+
+    // distance from point to the outside of the searched cube, measured in
+    // cells the way cell() computes them and slightly shortened, so that
+    // rounding cannot make it exceed the distance to an unsearched point
+    float bound = std::numeric_limits<float>::infinity();
+    for (int axis = 0; axis < 3; ++axis) {
+      float p = (&point.x)[axis] * invCellSize_;
+      bound = std::min(bound, p - static_cast<float>(c[axis] - r));
+      bound = std::min(bound, static_cast<float>(c[axis] + r + 1) - p);
+    }
+    bound = std::max(bound, 0.0f) * cellSize_ * 0.9999f;
+    if (bound * bound >= limit)
+      break;
+  }
+
+  std::sort_heap(neighbors, neighbors + found);
+  return found;
+}
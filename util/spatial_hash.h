@@ -0,0 +1,147 @@
+#ifndef CGL_SPATIAL_HASH_H_
+#define CGL_SPATIAL_HASH_H_
+
+#include <stdint.h>
+#include <limits>
+#include <vector>
+#include "math/cgl_math.h"
+
+namespace cgl
+{
+
+  /// Uniform grid over points, for radius, box and nearest-neighbour queries.
+  /// Space is divided into cubic cells of a fixed size, and the cells are
+  /// hashed into a table of buckets, so only occupied cells cost memory.
+  ///
+  /// build() sorts the points by bucket into one array, which keeps the
+  /// points of a cell together in memory. insert() and remove() work in
+  /// place; inserted points go into per-bucket lists until the next rebuild,
+  /// which happens automatically once they (or the removed points) make up a
+  /// large part of the grid, on the threads given to the last build(). Point
+  /// ids stay the same across rebuilds; the id of a removed point is reused
+  /// by a later insert(), so memory follows size() rather than the number of
+  /// points ever inserted.
+  ///
+  /// The queries write into caller-provided buffers and do not allocate, so
+  /// several threads may query the same grid at once.
+  class SpatialHashGrid
+  {
+  public:
+
+    /// Id returned for no point.
+    static const uint32_t none = 0xffffffff;
+
+    /// Result of a nearest-neighbour query.
+    struct Neighbor
+    {
+      uint32_t id;
+      float distanceSquared;
+
+      bool operator<(const Neighbor& n) const { return distanceSquared < n.distanceSquared; }
+    };
+
+    /// Creates an empty grid with cells of the given edge length. Queries
+    /// are fastest when the cells are about the size of a typical query
+    /// radius.
+    explicit SpatialHashGrid(float cellSize = 1.0f);
+
+    /// Replaces the contents with n points, which get the ids 0 to n - 1.
+    /// Uses up to threads threads (0 = one per hardware thread).
+    void build(const cgl::Vec3* points, size_t n, unsigned threads = 0);
+
+    /// Adds a point and returns its id, which is the id of a removed point
+    /// if there is one.
+    uint32_t insert(const cgl::Vec3& point);
+
+    /// Removes the point with the given id. Returns false if there is none.
+    bool remove(uint32_t id);
+
+    /// Removes all points and resets the ids.
+    void clear();
+
+    /// Rebuilds the bucket array with the current points (see build()).
+    void rebuild(unsigned threads = 0);
+
+    /// Finds the points within radius of center (inclusive). Writes the ids
+    /// of up to capacity of them to ids and returns how many were found,
+    /// which may be more than capacity.
+    size_t queryRadius(const cgl::Vec3& center, float radius, uint32_t* ids, size_t capacity) const;
+
+    /// Finds the points inside the box [min, max] (inclusive). Writes the
+    /// ids of up to capacity of them to ids and returns how many were found,
+    /// which may be more than capacity.
+    size_t queryBox(const cgl::Vec3& min, const cgl::Vec3& max, uint32_t* ids, size_t capacity) const;
+
+    /// Finds the k points nearest to point, no farther than maxDistance, and
+    /// writes them to neighbors ordered by distance. Returns how many were
+    /// found (less than k if the grid has fewer points in range). Ties are
+    /// broken arbitrarily.
+    size_t queryNearest(const cgl::Vec3& point, size_t k, Neighbor* neighbors,
+                        float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+    /// Returns the position of the point with the given id.
+    const cgl::Vec3& position(uint32_t id) const { return points_[id]; }
+
+    /// Returns true if a point with the given id is in the grid.
+    bool contains(uint32_t id) const { return id < locations_.size() && locations_[id] != none; }
+
+    /// Returns the number of points.
+    size_t size() const { return size_; }
+
+    /// Returns the edge length of the cells.
+    float cellSize() const { return cellSize_; }
+
+  private:
+    // A point in a bucket; removed points keep their entry with id = none
+    // until the next rebuild.
+    struct Entry
+    {
+      cgl::Vec3 position;
+      uint32_t id;
+    };
+
+    // Entry of an inserted point, linked to the previous one of its bucket.
+    struct Insertion
+    {
+      Entry entry;
+      uint32_t next;
+    };
+
+    float cellSize_;
+    float invCellSize_;
+
+    // Position and location of each point, by id. A location is an index
+    // into entries_, or into insertions_ with the inserted bit set, or none
+    // for removed ids, which are kept in freeIds_ for reuse.
+    std::vector<cgl::Vec3> points_;
+    std::vector<uint32_t> locations_;
+    std::vector<uint32_t> freeIds_;
+
+    // The entries of bucket b are entries_[bucketStarts_[b] ..
+    // bucketStarts_[b + 1]), followed by the list starting at
+    // insertions_[insertionHeads_[b]].
+    std::vector<uint32_t> bucketStarts_;
+    std::vector<Entry> entries_;
+    std::vector<uint32_t> insertionHeads_;
+    std::vector<Insertion> insertions_;
+    uint32_t bucketMask_;
+
+    size_t size_;
+    size_t removed_;
+    unsigned threads_;      // of the last build(), for automatic rebuilds
+
+    int32_t cell(float v) const;
+    uint32_t bucket(int32_t x, int32_t y, int32_t z) const;
+    void rebuildIfNeeded();
+
+    // Calls fn(entry) for the points in the cells [lo, hi] (per axis), or
+    // for all points if that range has more cells than the table has
+    // buckets. Points outside the range may be passed in the latter case.
+    template <typename F> void forEachInCells(const int32_t* lo, const int32_t* hi, F fn) const;
+    template <typename F> void forEachInCell(int32_t x, int32_t y, int32_t z, F fn) const;
+    template <typename F> void forEach(F fn) const;
+  };
+
+}
+
+#endif
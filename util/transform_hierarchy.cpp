@@ -0,0 +1,162 @@
+#include "transform_hierarchy.h"
+#include <algorithm>
+#include <atomic>
+#include "math/parallel.h"
+
+using namespace cgl;
+
+const uint32_t TransformHierarchy::none;
+
+TransformHierarchy::TransformHierarchy() : sorted_(true), anyDirty_(false)
+{}
+
+uint32_t TransformHierarchy::add(uint32_t parent, const Mat4& local)
+{
+  uint32_t id = static_cast<uint32_t>(parents_.size());
+  parents_.push_back(parent);
+  positions_.push_back(id);
+  locals_.push_back(local);
+  worlds_.push_back(local);
+  dirty_.push_back(1);
+  sorted_ = false;
+  anyDirty_ = true;
+  return id;
+}
+
+bool TransformHierarchy::setParent(uint32_t node, uint32_t parent)
+{
+  for (uint32_t p = parent; p != none; p = parents_[p])
+    if (p == node)
+      return false;
+
+  parents_[node] = parent;
+  dirty_[positions_[node]] = 1;
+  sorted_ = false;
+  anyDirty_ = true;
+  return true;
+}
+
+void TransformHierarchy::setLocal(uint32_t node, const Mat4& local)
+{
+  uint32_t position = positions_[node];
+  locals_[position] = local;
+  dirty_[position] = 1;
+  anyDirty_ = true;
+}
+
+size_t TransformHierarchy::update(unsigned threads)
+{
+  if (!sorted_)
+    sort();
+  if (!anyDirty_)
+    return 0;
+
+  if (threads == 0)
+    threads = hardwareThreads();
+
+  // the roots make up level 0
+  const uint32_t* parents = parentPositions_.data();
+  const Mat4* locals = locals_.data();
+  Mat4* worlds = worlds_.data();
+  uint8_t* dirty = dirty_.data();
+  size_t updated = 0;
+  for (size_t i = 0; i < levelStarts_[1]; ++i) {
+    if (dirty[i]) {
+      worlds[i] = locals[i];
+      ++updated;
+    }
+  }
+
+  // a node is recomputed if it or its parent is dirty; the parent's flag is
+  // final once its level is done, so each level only reads the one before
+  std::atomic<size_t> count(updated);
+  for (size_t l = 1; l + 1 < levelStarts_.size(); ++l) {
+    size_t begin = levelStarts_[l];
+    parallelFor(levelStarts_[l + 1] - begin, threads, [=, &count](size_t first, size_t last) {
+      size_t n = 0;
+      for (size_t i = begin + first; i < begin + last; ++i) {
+        uint32_t p = parents[i];
+        if (dirty[i] | dirty[p]) {
+          worlds[i] = worlds[p] * locals[i];
+          dirty[i] = 1;
+          ++n;
+        }
+      }
+      count += n;
+    });
+  }
+
+  std::fill(dirty_.begin(), dirty_.end(), 0);
+  anyDirty_ = false;
+  return count;
+}
+
+void TransformHierarchy::clear()
+{
+  parents_.clear();
+  positions_.clear();
+  parentPositions_.clear();
+  locals_.clear();
+  worlds_.clear();
+  dirty_.clear();
+  levelStarts_.clear();
+  sorted_ = true;
+  anyDirty_ = false;
+}
+
+void TransformHierarchy::sort()
+{
+  size_t n = parents_.size();
+
+  // children of each node by id, in id order; slot 0 holds the roots and
+  // slot id + 1 the children of id
+  std::vector<uint32_t> childStarts(n + 2, 0);
+  for (size_t id = 0; id < n; ++id)
+    ++childStarts[parents_[id] == none ? 1 : parents_[id] + 2];
+  for (size_t i = 1; i < childStarts.size(); ++i)
+    childStarts[i] += childStarts[i - 1];
+  std::vector<uint32_t> children(n);
+  std::vector<uint32_t> next(childStarts.begin(), childStarts.end() - 1);
+  for (size_t id = 0; id < n; ++id) {
+    uint32_t slot = parents_[id] == none ? 0 : parents_[id] + 1;
+    children[next[slot]++] = static_cast<uint32_t>(id);
+  }
+
+  // breadth-first order: the roots (the children of slot 0), then level by
+  // level the children of each node in turn, so siblings stay together
+  std::vector<uint32_t> order(children.begin(), children.begin() + childStarts[1]);
+  order.reserve(n);
+  levelStarts_.assign(1, 0);
+  for (size_t begin = 0; begin < order.size();) {
+    size_t end = order.size();
+    for (size_t i = begin; i < end; ++i) {
+      uint32_t id = order[i];
+      order.insert(order.end(), children.begin() + childStarts[id + 1],
+                   children.begin() + childStarts[id + 2]);
+    }
+    levelStarts_.push_back(static_cast<uint32_t>(end));
+    begin = end;
+  }
+
+  std::vector<uint32_t> parentPositions(n);
+  std::vector<Mat4> locals(n), worlds(n);
+  std::vector<uint8_t> dirty(n);
+  for (size_t i = 0; i < n; ++i) {
+    uint32_t position = positions_[order[i]];
+    locals[i] = locals_[position];
+    worlds[i] = worlds_[position];
+    dirty[i] = dirty_[position];
+  }
+  for (size_t i = 0; i < n; ++i)
+    positions_[order[i]] = static_cast<uint32_t>(i);
+  for (size_t i = 0; i < n; ++i) {
+    uint32_t parent = parents_[order[i]];
+    parentPositions[i] = parent == none ? none : positions_[parent];
+  }
+
+  parentPositions_.swap(parentPositions);
+  locals_.swap(locals);
+  worlds_.swap(worlds);
+  dirty_.swap(dirty);
+  sorted_ = true;
+}
@@ -0,0 +1,92 @@
+#ifndef CGL_TRANSFORM_HIERARCHY_H_
+#define CGL_TRANSFORM_HIERARCHY_H_
+
+#include <stdint.h>
+#include <vector>
+#include "math/cgl_math.h"
+
+namespace cgl
+{
+
+  /// Parent/child hierarchy of transforms. Each node has a local transform
+  /// relative to its parent, and update() computes the world transforms
+  /// (parent world * local) of the nodes whose local transform, or that of
+  /// an ancestor, changed since the last update.
+  ///
+  /// Nodes are identified by the ids returned from add(). Internally they are
+  /// stored in breadth-first order, so that every level of the hierarchy is a
+  /// contiguous range whose parents all lie in the previous ranges; update()
+  /// processes one level at a time and splits large levels across threads.
+  class TransformHierarchy
+  {
+  public:
+
+    /// Parent of the root nodes.
+    static const uint32_t none = 0xffffffff;
+
+    TransformHierarchy();
+
+    /// Adds a node below parent (none for a new root) and returns its id.
+    /// Ids are assigned consecutively starting at 0.
+    uint32_t add(uint32_t parent, const cgl::Mat4& local = cgl::Mat4());
+
+    /// Moves node (with its subtree) below parent, or makes it a root if
+    /// parent is none. Returns false and changes nothing if parent is in the
+    /// subtree of node.
+    bool setParent(uint32_t node, uint32_t parent);
+
+    /// Returns the parent of node, or none for a root.
+    uint32_t parent(uint32_t node) const { return parents_[node]; }
+
+    /// Assigns the transform of node relative to its parent.
+    void setLocal(uint32_t node, const cgl::Mat4& local);
+
+    /// Returns the transform of node relative to its parent.
+    const cgl::Mat4& local(uint32_t node) const { return locals_[positions_[node]]; }
+
+    /// Returns the world transform of node as of the last update().
+    const cgl::Mat4& world(uint32_t node) const { return worlds_[positions_[node]]; }
+
+    /// Recomputes the world transforms that are out of date, using up to
+    /// threads threads (0 = one per hardware thread) for large levels.
+    /// Returns the number of world transforms computed.
+    size_t update(unsigned threads = 0);
+
+    /// Returns the number of nodes.
+    size_t size() const { return parents_.size(); }
+
+    /// Returns the number of levels (the depth of the deepest node + 1) as
+    /// of the last update().
+    size_t levels() const { return levelStarts_.empty() ? 0 : levelStarts_.size() - 1; }
+
+    /// Removes all nodes.
+    void clear();
+
+  private:
+    // Parent id and storage position of each node, by id.
+    std::vector<uint32_t> parents_;
+    std::vector<uint32_t> positions_;
+
+    // Per node in storage order: breadth-first after sort(), with nodes added
+    // since then appended at the end. The parent positions are only valid
+    // while sorted.
+    std::vector<uint32_t> parentPositions_;
+    std::vector<cgl::Mat4> locals_;
+    std::vector<cgl::Mat4> worlds_;
+    std::vector<uint8_t> dirty_;
+
+    // Level l is stored in [levelStarts_[l], levelStarts_[l + 1]).
+    std::vector<uint32_t> levelStarts_;
+
+    // False when nodes were added or moved since the last sort().
+    bool sorted_;
+
+    // True when some node has its dirty flag set.
+    bool anyDirty_;
+
+    void sort();
+  };
+
+}
+
+#endif